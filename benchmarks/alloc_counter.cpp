@@ -0,0 +1,56 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions to count allocations. The array and nothrow forms forward to these by default.
+static std::atomic<size_t> g_allocationCount = 0;
+
+static void* allocate(size_t size, size_t alignment)
+{
+	g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0)
+		size = 1;
+	void* p;
+	if (alignment <= alignof(std::max_align_t))
+		p = std::malloc(size);
+	else
+	{
+#ifdef _MSC_VER
+		p = _aligned_malloc(size, alignment);
+#else
+		p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+	if (!p)
+		throw std::bad_alloc {};
+	return p;
+}
+
+static void deallocate(void* p, size_t alignment)
+{
+#ifdef _MSC_VER
+	if (alignment > alignof(std::max_align_t))
+	{
+		_aligned_free(p);
+		return;
+	}
+#endif
+	std::free(p);
+}
+
+void* operator new(size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+void operator delete(void* p) noexcept { deallocate(p, alignof(std::max_align_t)); }
+void operator delete(void* p, size_t) noexcept { deallocate(p, alignof(std::max_align_t)); }
+void operator delete(void* p, std::align_val_t alignment) noexcept { deallocate(p, static_cast<size_t>(alignment)); }
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept { deallocate(p, static_cast<size_t>(alignment)); }
+
+namespace bezierfit::bench {
+	// Declared in common.hpp
+	size_t get_allocation_count() { return g_allocationCount.load(std::memory_order_relaxed); }
+}
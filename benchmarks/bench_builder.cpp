@@ -0,0 +1,94 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :spline_builder;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+using bench::Dataset;
+
+// Feeds a whole stroke through CurveBuilder::AddPoint, as live input would
+static void BM_CurveBuilderAddPoint(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	CurveBuilder builder { 2.f, 1.f };
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		builder.Clear();
+		for (auto& p : points)
+			benchmark::DoNotOptimize(builder.AddPoint(p));
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_CurveBuilderAddPoint, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_small_sizes);
+BENCHMARK_CAPTURE(BM_CurveBuilderAddPoint, handwriting, Dataset::Handwriting)->Apply(bench::apply_small_sizes);
+BENCHMARK_CAPTURE(BM_CurveBuilderAddPoint, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_small_sizes);
+
+static void BM_SplineBuilderAdd(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	SplineBuilder builder { 2.f, 1.f, 16 };
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		builder.Clear();
+		for (auto& p : points)
+			benchmark::DoNotOptimize(builder.Add(p));
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_SplineBuilderAdd, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_small_sizes);
+BENCHMARK_CAPTURE(BM_SplineBuilderAdd, handwriting, Dataset::Handwriting)->Apply(bench::apply_small_sizes);
+BENCHMARK_CAPTURE(BM_SplineBuilderAdd, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_small_sizes);
+
+// Same as BM_CurveBuilderAddPoint with the online simplifier in front of the fit (second argument: tolerance in 1/100 units)
+static void BM_CurveBuilderAddPointSimplified(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	CurveBuilder builder { 2.f, 1.f };
+	CurveBuilder::StreamingOptions options;
+	options.simplifyTolerance = static_cast<FLOAT>(state.range(1)) / 100;
+	builder.SetStreamingOptions(options);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		builder.Clear();
+		for (auto& p : points)
+			benchmark::DoNotOptimize(builder.AddPoint(p));
+		benchmark::DoNotOptimize(builder.Flush());
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(builder.Curves().size());
+}
+BENCHMARK_CAPTURE(BM_CurveBuilderAddPointSimplified, noisy_circle, Dataset::NoisyCircle)->ArgsProduct({ { 4096, 65536 }, { 0, 10, 50 } })->ArgNames({ "points", "tolerance" });
+BENCHMARK_CAPTURE(BM_CurveBuilderAddPointSimplified, handwriting, Dataset::Handwriting)->ArgsProduct({ { 4096, 65536 }, { 0, 10, 50 } })->ArgNames({ "points", "tolerance" });
+
+// BM_SplineBuilderAdd with the hierarchy brought up to date every 16 points, as a renderer would once per frame
+static void BM_SplineBuilderAddWithBvh(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	SplineBuilder builder { 2.f, 1.f, 16 };
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		builder.Clear();
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			benchmark::DoNotOptimize(builder.Add(points[i]));
+			if (i % 16 == 15)
+				benchmark::DoNotOptimize(builder.GetBvh().GetBounds());
+		}
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_SplineBuilderAddWithBvh, handwriting, Dataset::Handwriting)->Apply(bench::apply_small_sizes);
+BENCHMARK_CAPTURE(BM_SplineBuilderAddWithBvh, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_small_sizes);
@@ -0,0 +1,123 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :curve_set;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+using bench::Dataset;
+
+namespace {
+	constexpr size_t POINTS_PER_STROKE = 256;
+
+	// All datasets with the given number of points each, cut into strokes of POINTS_PER_STROKE points and fitted
+	BatchResult make_batch(size_t numPoints)
+	{
+		std::vector<std::vector<VECTOR>> strokes;
+		for (auto dataset : { Dataset::NoisyCircle, Dataset::Handwriting, Dataset::LongPolyline })
+		{
+			auto points = bench::generate_points(dataset, numPoints);
+			for (size_t first = 0; first < points.size(); first += POINTS_PER_STROKE)
+				strokes.emplace_back(points.begin() + first, points.begin() + std::min(points.size(), first + POINTS_PER_STROKE));
+		}
+		return fit_batch(strokes, 1.f);
+	}
+
+	CurveSetEncoding get_encoding(const benchmark::State& state)
+	{
+		return state.range(1) ? CurveSetEncoding::Quantized16 : CurveSetEncoding::Float;
+	}
+
+	void apply_curve_set_args(benchmark::internal::Benchmark* b)
+	{
+		b->ArgsProduct({ { 4096, 65536 }, { 0, 1 } })->ArgNames({ "points", "quantized" });
+	}
+}
+
+// items_per_second counts curves; bytes_per_curve is the size of the curve set divided by the number of curves
+// (an std::array<VECTOR, 4> per curve takes 4 * sizeof(VECTOR))
+static void BM_CurveSetWrite(benchmark::State& state)
+{
+	BatchResult batch = make_batch(state.range(0));
+	CurveSetWriter writer { get_encoding(state) };
+	std::pmr::vector<std::byte> data;
+	writer.AddBatch(batch);
+	writer.Write(data);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		writer.Clear();
+		writer.AddBatch(batch);
+		writer.Write(data);
+		benchmark::DoNotOptimize(data.data());
+	}
+	bench::set_counters(state, batch.curves.size(), bench::get_allocation_count() - allocations);
+	state.counters["bytes_per_curve"] = static_cast<double>(data.size()) / batch.curves.size();
+}
+BENCHMARK(BM_CurveSetWrite)->Apply(apply_curve_set_args);
+
+// Opening the data in place and reading every curve, as after mapping a file. max_error is the largest deviation of a
+// control point from the written one.
+static void BM_CurveSetRead(benchmark::State& state)
+{
+	BatchResult batch = make_batch(state.range(0));
+	CurveSetWriter writer { get_encoding(state) };
+	writer.AddBatch(batch);
+	std::pmr::vector<std::byte> data;
+	writer.Write(data);
+	std::pmr::vector<CubicBezier> curves;
+	curves.reserve(batch.curves.size());
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		CurveSetView view { data };
+		for (size_t stroke = 0; stroke < view.GetStrokeCount(); stroke++)
+		{
+			view.ReadStroke(stroke, curves);
+			benchmark::DoNotOptimize(curves.data());
+		}
+	}
+	bench::set_counters(state, batch.curves.size(), bench::get_allocation_count() - allocations);
+
+	BatchResult read = CurveSetView { data }.ToBatchResult();
+	double error = 0;
+	for (size_t i = 0; i < batch.curves.size(); i++)
+	{
+		for (int j = 0; j < 4; j++)
+			error = std::max(error, static_cast<double>(glm::distance(batch.curves[i][j], read.curves[i][j])));
+	}
+	state.counters["max_error"] = error;
+}
+BENCHMARK(BM_CurveSetRead)->Apply(apply_curve_set_args);
+
+// Unquantized point chains are used where they are, without copying
+static void BM_CurveSetReadInPlace(benchmark::State& state)
+{
+	BatchResult batch = make_batch(state.range(0));
+	CurveSetWriter writer;
+	writer.AddBatch(batch);
+	std::pmr::vector<std::byte> data;
+	writer.Write(data);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		CurveSetView view { data };
+		VECTOR sum { 0 };
+		for (size_t stroke = 0; stroke < view.GetStrokeCount(); stroke++)
+		{
+			for (auto& p : view.GetPoints(stroke))
+				sum += p;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	bench::set_counters(state, batch.curves.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK(BM_CurveSetReadInPlace)->Arg(4096)->Arg(65536)->ArgName("points");
@@ -0,0 +1,60 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :fit_context;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+using bench::Dataset;
+
+// fit() as used by most callers: RDP reduction followed by the curve fit
+static void BM_Fit(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(fit(points, 1.f));
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_Fit, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Fit, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Fit, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Fit, zigzag, Dataset::Zigzag)->Apply(bench::apply_small_sizes);
+
+// The curve fit alone on a reused context, in both iteration modes (second argument: 0 = ThreePass, 1 = Fused)
+static void BM_FitContext(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	FitContext context {};
+	context.SetIterationMode(static_cast<CurveFitBase::IterationMode>(state.range(1)));
+	context.Fit(points, 1.f);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(context.Fit(points, 1.f).data());
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+	state.counters["iterations"] = benchmark::Counter(static_cast<double>(context.GetStats().iterations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_CAPTURE(BM_FitContext, noisy_circle, Dataset::NoisyCircle)->ArgsProduct({ { 256, 4096, 65536 }, { 0, 1 } })->ArgNames({ "points", "fused" });
+BENCHMARK_CAPTURE(BM_FitContext, handwriting, Dataset::Handwriting)->ArgsProduct({ { 256, 4096, 65536 }, { 0, 1 } })->ArgNames({ "points", "fused" });
+BENCHMARK_CAPTURE(BM_FitContext, long_polyline, Dataset::LongPolyline)->ArgsProduct({ { 256, 4096, 65536 }, { 0, 1 } })->ArgNames({ "points", "fused" });
+
+static void BM_Reduce(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(reduce(points));
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_Reduce, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Reduce, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Reduce, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Reduce, zigzag, Dataset::Zigzag)->Apply(bench::apply_small_sizes);
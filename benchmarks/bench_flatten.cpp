@@ -0,0 +1,110 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :curve_flattener;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+using bench::Dataset;
+
+namespace {
+	// Tolerance of the polylines in 1/100 units, given as the second argument
+	FLOAT get_tolerance(const benchmark::State& state) { return static_cast<FLOAT>(state.range(1)) / 100; }
+
+	std::vector<CubicBezier> make_curves(Dataset dataset, size_t numPoints)
+	{
+		std::vector<CubicBezier> curves;
+		for (auto& c : fit(bench::generate_points(dataset, numPoints), 1.f))
+			curves.push_back(CubicBezier(c[0], c[1], c[2], c[3]));
+		return curves;
+	}
+
+	void apply_flatten_args(benchmark::internal::Benchmark* b)
+	{
+		b->ArgsProduct({ { 4096, 65536 }, { 1, 10, 100 } })->ArgNames({ "points", "tolerance" });
+	}
+}
+
+// items_per_second counts curves; vertices is the size of the polyline
+static void BM_CurveFlattener(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	CurveFlattener flattener { get_tolerance(state) };
+	std::pmr::vector<VECTOR> polyline;
+	flattener.Flatten(curves, polyline);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		flattener.Flatten(curves, polyline);
+		benchmark::DoNotOptimize(polyline.data());
+	}
+	bench::set_counters(state, curves.size(), bench::get_allocation_count() - allocations);
+	state.counters["vertices"] = static_cast<double>(polyline.size());
+}
+BENCHMARK_CAPTURE(BM_CurveFlattener, handwriting, Dataset::Handwriting)->Apply(apply_flatten_args);
+BENCHMARK_CAPTURE(BM_CurveFlattener, long_polyline, Dataset::LongPolyline)->Apply(apply_flatten_args);
+
+// The previous approach for comparison: the same number of samples on every curve, enough that the tightest curve is within
+// the tolerance (a uniform subdivision of a curve into n segments deviates by at most 3/4 * max|p[i] - 2 * p[i + 1] + p[i + 2]| / n^2)
+static void BM_FlattenUniform(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	FLOAT tolerance = get_tolerance(state);
+	int segments = 1;
+	for (auto& c : curves)
+	{
+		FLOAT dd = std::max(glm::length(c.p0 - c.p1 * FLOAT(2) + c.p2), glm::length(c.p1 - c.p2 * FLOAT(2) + c.p3));
+		segments = std::max(segments, static_cast<int>(std::ceil(std::sqrt(FLOAT(0.75) * dd / tolerance))));
+	}
+	std::pmr::vector<VECTOR> polyline;
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		polyline.clear();
+		polyline.push_back(curves.front().p0);
+		for (auto& c : curves)
+		{
+			ForwardDifferencer walk { c, segments };
+			for (int i = 1; i <= segments; i++)
+			{
+				walk.Next();
+				polyline.push_back(walk.Get());
+			}
+		}
+		benchmark::DoNotOptimize(polyline.data());
+	}
+	bench::set_counters(state, curves.size(), bench::get_allocation_count() - allocations);
+	state.counters["vertices"] = static_cast<double>(polyline.size());
+}
+BENCHMARK_CAPTURE(BM_FlattenUniform, handwriting, Dataset::Handwriting)->Apply(apply_flatten_args);
+BENCHMARK_CAPTURE(BM_FlattenUniform, long_polyline, Dataset::LongPolyline)->Apply(apply_flatten_args);
+
+// Strokes of a batch into one buffer with an offset table
+static void BM_CurveFlattenerBatch(benchmark::State& state)
+{
+	std::vector<std::vector<VECTOR>> strokes;
+	for (auto dataset : { Dataset::NoisyCircle, Dataset::Handwriting, Dataset::LongPolyline })
+		strokes.push_back(bench::generate_points(dataset, state.range(0)));
+	BatchResult batch = fit_batch(strokes, 1.f);
+	CurveFlattener flattener { get_tolerance(state) };
+	std::pmr::vector<VECTOR> vertices;
+	std::pmr::vector<size_t> offsets;
+	flattener.Flatten(batch, vertices, offsets);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		flattener.Flatten(batch, vertices, offsets);
+		benchmark::DoNotOptimize(vertices.data());
+	}
+	bench::set_counters(state, batch.curves.size(), bench::get_allocation_count() - allocations);
+	state.counters["vertices"] = static_cast<double>(vertices.size());
+}
+BENCHMARK(BM_CurveFlattenerBatch)->Apply(apply_flatten_args);
@@ -0,0 +1,152 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :preprocess_pipeline;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+using bench::Dataset;
+
+static void BM_Linearize(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(CurvePreprocess::Linearize(points, 2.f).data());
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_Linearize, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Linearize, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_Linearize, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+namespace {
+	// Input devices often report the same position several times, so every fourth point is repeated
+	std::vector<VECTOR> generate_with_duplicates(Dataset dataset, size_t numPoints)
+	{
+		auto unique = bench::generate_points(dataset, numPoints);
+		std::vector<VECTOR> points;
+		for (size_t i = 0; i < unique.size(); i++)
+		{
+			points.push_back(unique[i]);
+			if (i % 4 == 0)
+				points.push_back(unique[i]);
+		}
+		return points;
+	}
+
+	const FitOptions PIPELINE_OPTIONS { .reduceTolerance = 0.03f, .linearizeDistance = 2.f, .removeDuplicates = true };
+}
+
+static void BM_RemoveDuplicates(benchmark::State& state, Dataset dataset)
+{
+	auto points = generate_with_duplicates(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(CurvePreprocess::RemoveDuplicates(points).data());
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_RemoveDuplicates, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_RemoveDuplicates, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+// RdpReduce into reused buffers, i.e. without the allocations that reduce() makes
+static void BM_RdpReduce(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	std::pmr::vector<VECTOR> reduced;
+	std::pmr::vector<CurvePreprocess::RdpRange> stack;
+	CurvePreprocess::RdpReduce(points, 0.03f, reduced, stack);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		CurvePreprocess::RdpReduce(points, 0.03f, reduced, stack);
+		benchmark::DoNotOptimize(reduced.data());
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_RdpReduce, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_RdpReduce, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_RdpReduce, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_RdpReduce, zigzag, Dataset::Zigzag)->Apply(bench::apply_small_sizes);
+BENCHMARK_CAPTURE(BM_RdpReduce, spiral, Dataset::Spiral)->Apply(bench::apply_sizes);
+
+// Same tolerance as BM_RdpReduce, applied as an area the way FitOptions does for Reducer::Visvalingam
+static void BM_VisvalingamReduce(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	std::pmr::vector<VECTOR> reduced;
+	std::pmr::vector<CurvePreprocess::VisvalingamNode> nodes;
+	std::pmr::vector<int> heap;
+	CurvePreprocess::VisvalingamReduce(points, 0.03f * 0.03f, reduced, nodes, heap);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		CurvePreprocess::VisvalingamReduce(points, 0.03f * 0.03f, reduced, nodes, heap);
+		benchmark::DoNotOptimize(reduced.data());
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_VisvalingamReduce, noisy_circle, Dataset::NoisyCircle)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_VisvalingamReduce, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_VisvalingamReduce, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_VisvalingamReduce, zigzag, Dataset::Zigzag)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_VisvalingamReduce, spiral, Dataset::Spiral)->Apply(bench::apply_sizes);
+
+// RemoveDuplicates, Linearize and RdpReduce chained as separate calls, for comparison with BM_PreprocessPipeline
+static void BM_PreprocessChained(benchmark::State& state, Dataset dataset)
+{
+	auto points = generate_with_duplicates(dataset, state.range(0));
+	std::pmr::vector<VECTOR> linearized;
+	std::pmr::vector<VECTOR> reduced;
+	std::pmr::vector<CurvePreprocess::RdpRange> stack;
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		auto unique = CurvePreprocess::RemoveDuplicates(points);
+		CurvePreprocess::Linearize(unique, PIPELINE_OPTIONS.linearizeDistance, linearized);
+		CurvePreprocess::RdpReduce(linearized, PIPELINE_OPTIONS.reduceTolerance, reduced, stack);
+		benchmark::DoNotOptimize(reduced.data());
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_PreprocessChained, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_PreprocessChained, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+static void BM_PreprocessPipeline(benchmark::State& state, Dataset dataset)
+{
+	auto points = generate_with_duplicates(dataset, state.range(0));
+	PreprocessPipeline pipeline { PIPELINE_OPTIONS };
+	std::pmr::vector<VECTOR> reduced;
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		pipeline.Run(points, reduced);
+		benchmark::DoNotOptimize(reduced.data());
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_PreprocessPipeline, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_PreprocessPipeline, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+// Points pushed one at a time as they would arrive from an input device
+static void BM_PreprocessPipelinePush(benchmark::State& state, Dataset dataset)
+{
+	auto points = generate_with_duplicates(dataset, state.range(0));
+	PreprocessPipeline pipeline { PIPELINE_OPTIONS };
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (auto& p : points)
+			pipeline.Push(p);
+		benchmark::DoNotOptimize(pipeline.Finish().data());
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_PreprocessPipelinePush, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
@@ -0,0 +1,159 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :curve_bvh;
+
+#include "common.hpp"
+
+#include <random>
+
+using namespace bezierfit;
+using bench::Dataset;
+
+namespace {
+	constexpr int QUERIES_PER_ITERATION = 1024;
+
+	std::vector<CubicBezier> make_curves(Dataset dataset, size_t numPoints)
+	{
+		std::vector<CubicBezier> curves;
+		for (auto& c : fit(bench::generate_points(dataset, numPoints), 1.f))
+			curves.push_back(CubicBezier(c[0], c[1], c[2], c[3]));
+		return curves;
+	}
+
+	// Points spread uniformly over the bounds of the curves, with a fixed seed
+	std::vector<VECTOR> make_queries(const BoundingBox& bounds)
+	{
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<FLOAT> dist(0, 1);
+		std::vector<VECTOR> queries(QUERIES_PER_ITERATION);
+		for (auto& q : queries)
+		{
+			for (int i = 0; i < DIMENSION; i++)
+				q[i] = bounds.min[i] + (bounds.max[i] - bounds.min[i]) * dist(rng);
+		}
+		return queries;
+	}
+}
+
+// Testing every curve, for comparison with BM_CurveBvhProject
+static void BM_ProjectAllCurves(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	auto queries = make_queries(CurveBvh { curves }.GetBounds());
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (auto& q : queries)
+		{
+			FLOAT best = std::numeric_limits<FLOAT>::infinity();
+			for (auto& curve : curves)
+			{
+				FLOAT t;
+				best = std::min(best, curve.Project(q, t));
+			}
+			benchmark::DoNotOptimize(best);
+		}
+	}
+	bench::set_counters(state, queries.size(), bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(curves.size());
+}
+BENCHMARK_CAPTURE(BM_ProjectAllCurves, handwriting, Dataset::Handwriting)->Apply(bench::apply_small_sizes);
+
+static void BM_CurveBvhProject(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	CurveBvh bvh { curves };
+	auto queries = make_queries(bvh.GetBounds());
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (auto& q : queries)
+			benchmark::DoNotOptimize(bvh.Project(curves, q));
+	}
+	bench::set_counters(state, queries.size(), bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(curves.size());
+}
+BENCHMARK_CAPTURE(BM_CurveBvhProject, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_CurveBvhProject, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+// Queries along the input stroke, offset from it, so consecutive points are close to the same curve
+static void BM_CurveBvhProjectMany(benchmark::State& state, Dataset dataset)
+{
+	auto points = bench::generate_points(dataset, state.range(0));
+	auto curves = make_curves(dataset, state.range(0));
+	CurveBvh bvh { curves };
+	for (auto& p : points)
+		p += VECTOR(FLOAT(3));
+	std::vector<CurveBvh::Projection> out(points.size());
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		bvh.ProjectMany(curves, points, out);
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	bench::set_counters(state, points.size(), bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(curves.size());
+}
+BENCHMARK_CAPTURE(BM_CurveBvhProjectMany, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_CurveBvhProjectMany, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+static void BM_CurveBvhBuild(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	CurveBvh bvh { curves };
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		bvh.Build(curves);
+		benchmark::DoNotOptimize(bvh.GetBounds());
+	}
+	bench::set_counters(state, curves.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_CurveBvhBuild, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+
+// Culling against a viewport of a quarter of the width and height of the curves, moved across them
+static void BM_CurveBvhQuery(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	CurveBvh bvh { curves };
+	BoundingBox bounds = bvh.GetBounds();
+	VECTOR size = (bounds.max - bounds.min) * FLOAT(0.25);
+	auto corners = make_queries({ bounds.min, bounds.max - size });
+	std::pmr::vector<int> visible;
+	visible.reserve(curves.size());
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (auto& corner : corners)
+		{
+			bvh.Query({ corner, corner + size }, visible);
+			benchmark::DoNotOptimize(visible.data());
+		}
+	}
+	bench::set_counters(state, corners.size(), bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(curves.size());
+}
+BENCHMARK_CAPTURE(BM_CurveBvhQuery, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_CurveBvhQuery, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+static void BM_CurveGetBounds(benchmark::State& state, Dataset dataset)
+{
+	auto curves = make_curves(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (auto& curve : curves)
+			benchmark::DoNotOptimize(curve.GetBounds());
+	}
+	bench::set_counters(state, curves.size(), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_CurveGetBounds, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
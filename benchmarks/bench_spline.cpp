@@ -0,0 +1,204 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+import :spline;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+using bench::Dataset;
+
+namespace {
+	constexpr int SAMPLES_PER_CURVE = 32;
+	constexpr int SAMPLES_PER_ITERATION = 4096;
+
+	// Spline through the curves fitted to the dataset
+	Spline make_spline(Dataset dataset, size_t numPoints, Spline::ArcLengthMode mode = Spline::ArcLengthMode::Table)
+	{
+		std::vector<CubicBezier> curves;
+		for (auto& c : fit(bench::generate_points(dataset, numPoints), 1.f))
+			curves.push_back(CubicBezier(c[0], c[1], c[2], c[3]));
+		return Spline { curves, SAMPLES_PER_CURVE, mode };
+	}
+}
+
+// Samples evenly spaced positions along the whole spline
+static void BM_SplineSample(benchmark::State& state, Dataset dataset)
+{
+	auto spline = make_spline(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (int i = 0; i < SAMPLES_PER_ITERATION; i++)
+			benchmark::DoNotOptimize(spline.Sample(static_cast<FLOAT>(i) / (SAMPLES_PER_ITERATION - 1)));
+	}
+	bench::set_counters(state, SAMPLES_PER_ITERATION, bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(spline.Curves().size());
+}
+BENCHMARK_CAPTURE(BM_SplineSample, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_SplineSample, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+static void BM_SplineGetSamplePosition(benchmark::State& state, Dataset dataset)
+{
+	auto spline = make_spline(dataset, state.range(0));
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (int i = 0; i < SAMPLES_PER_ITERATION; i++)
+			benchmark::DoNotOptimize(spline.GetSamplePosition(static_cast<FLOAT>(i) / (SAMPLES_PER_ITERATION - 1)));
+	}
+	bench::set_counters(state, SAMPLES_PER_ITERATION, bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(spline.Curves().size());
+}
+BENCHMARK_CAPTURE(BM_SplineGetSamplePosition, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_SplineGetSamplePosition, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+// Same positions as BM_SplineSample, evaluated with a single call
+static void BM_SplineSampleMany(benchmark::State& state, Dataset dataset)
+{
+	auto spline = make_spline(dataset, state.range(0));
+	std::vector<FLOAT> u(SAMPLES_PER_ITERATION);
+	for (int i = 0; i < SAMPLES_PER_ITERATION; i++)
+		u[i] = static_cast<FLOAT>(i) / (SAMPLES_PER_ITERATION - 1);
+	std::vector<VECTOR> out(SAMPLES_PER_ITERATION);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		spline.SampleMany(u, out);
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	bench::set_counters(state, SAMPLES_PER_ITERATION, bench::get_allocation_count() - allocations);
+	state.counters["curves"] = static_cast<double>(spline.Curves().size());
+}
+BENCHMARK_CAPTURE(BM_SplineSampleMany, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_SplineSampleMany, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+static void BM_SplineTangentMany(benchmark::State& state, Dataset dataset)
+{
+	auto spline = make_spline(dataset, state.range(0));
+	std::vector<FLOAT> u(SAMPLES_PER_ITERATION);
+	for (int i = 0; i < SAMPLES_PER_ITERATION; i++)
+		u[i] = static_cast<FLOAT>(i) / (SAMPLES_PER_ITERATION - 1);
+	std::vector<VECTOR> out(SAMPLES_PER_ITERATION);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		spline.TangentMany(u, out);
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	bench::set_counters(state, SAMPLES_PER_ITERATION, bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_SplineTangentMany, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+
+static void BM_SplineSampleUniform(benchmark::State& state, Dataset dataset)
+{
+	auto spline = make_spline(dataset, state.range(0));
+	std::vector<VECTOR> out(SAMPLES_PER_ITERATION);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		spline.SampleUniform(out);
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	bench::set_counters(state, SAMPLES_PER_ITERATION, bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_SplineSampleUniform, handwriting, Dataset::Handwriting)->Apply(bench::apply_sizes);
+BENCHMARK_CAPTURE(BM_SplineSampleUniform, long_polyline, Dataset::LongPolyline)->Apply(bench::apply_sizes);
+
+// Both arc length modes (second argument: 0 = Table, 1 = Quadrature). table_bytes is the memory used for the arc lengths,
+// spacing_error the largest relative deviation of the distance between consecutive samples from the ideal spacing, measured with
+// enough samples per curve that the chords are close to the arcs.
+static void BM_SplineArcLengthMode(benchmark::State& state, Dataset dataset)
+{
+	auto spline = make_spline(dataset, state.range(0), state.range(1) ? Spline::ArcLengthMode::Quadrature : Spline::ArcLengthMode::Table);
+	std::vector<VECTOR> out(SAMPLES_PER_ITERATION);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		spline.SampleUniform(out);
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	bench::set_counters(state, SAMPLES_PER_ITERATION, bench::get_allocation_count() - allocations);
+
+	std::vector<VECTOR> dense(spline.Curves().size() * 64);
+	spline.SampleUniform(dense);
+	double spacing = spline.Length() / (dense.size() - 1);
+	double error = 0;
+	for (size_t i = 1; i < dense.size(); i++)
+		error = std::max(error, std::abs(glm::distance(dense[i - 1], dense[i]) - spacing) / spacing);
+	state.counters["table_bytes"] = static_cast<double>(spline.Curves().size() * spline.GetSamplesPerCurve() * sizeof(FLOAT));
+	state.counters["spacing_error"] = error;
+}
+BENCHMARK_CAPTURE(BM_SplineArcLengthMode, handwriting, Dataset::Handwriting)->ArgsProduct({ { 256, 4096, 65536 }, { 0, 1 } })->ArgNames({ "points", "quadrature" });
+BENCHMARK_CAPTURE(BM_SplineArcLengthMode, long_polyline, Dataset::LongPolyline)->ArgsProduct({ { 256, 4096, 65536 }, { 0, 1 } })->ArgNames({ "points", "quadrature" });
+
+// Building the arc length tables (ArcLengthMode::Table) with the given number of samples per curve; items_per_second counts samples
+static void BM_SplineBuild(benchmark::State& state, Dataset dataset)
+{
+	std::vector<CubicBezier> curves;
+	for (auto& c : fit(bench::generate_points(dataset, 4096), 1.f))
+		curves.push_back(CubicBezier(c[0], c[1], c[2], c[3]));
+	int samplesPerCurve = static_cast<int>(state.range(0));
+	Spline spline { curves, samplesPerCurve };
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		spline.Clear();
+		for (auto& curve : curves)
+			spline.Add(curve);
+		benchmark::DoNotOptimize(spline.Length());
+	}
+	bench::set_counters(state, curves.size() * samplesPerCurve, bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_SplineBuild, handwriting, Dataset::Handwriting)->Arg(32)->Arg(1024)->ArgName("samples");
+
+// Evaluating every curve at the given number of evenly spaced parameters (second argument): 0 = CubicBezier::Sample,
+// 1 = PowerBasis::Sample, 2 = ForwardDifferencer
+static void BM_CurveSampleUniform(benchmark::State& state, Dataset dataset)
+{
+	std::vector<CubicBezier> curves;
+	for (auto& c : fit(bench::generate_points(dataset, 4096), 1.f))
+		curves.push_back(CubicBezier(c[0], c[1], c[2], c[3]));
+	int steps = static_cast<int>(state.range(0));
+	int method = static_cast<int>(state.range(1));
+	std::vector<VECTOR> out(steps + 1);
+	size_t allocations = bench::get_allocation_count();
+	for (auto _ : state)
+	{
+		for (auto& curve : curves)
+		{
+			if (method == 0)
+			{
+				for (int i = 0; i <= steps; i++)
+					out[i] = curve.Sample(static_cast<FLOAT>(i) / steps);
+			}
+			else if (method == 1)
+			{
+				PowerBasis basis { curve };
+				for (int i = 0; i <= steps; i++)
+					out[i] = basis.Sample(static_cast<FLOAT>(i) / steps);
+			}
+			else
+			{
+				ForwardDifferencer walk { curve, steps };
+				for (int i = 0; i <= steps; i++, walk.Next())
+					out[i] = walk.Get();
+			}
+			benchmark::DoNotOptimize(out.data());
+			benchmark::ClobberMemory();
+		}
+	}
+	bench::set_counters(state, curves.size() * (steps + 1), bench::get_allocation_count() - allocations);
+}
+BENCHMARK_CAPTURE(BM_CurveSampleUniform, handwriting, Dataset::Handwriting)->ArgsProduct({ { 32, 1024 }, { 0, 1, 2 } })->ArgNames({ "steps", "method" });
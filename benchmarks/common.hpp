@@ -0,0 +1,37 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BEZIERFIT_BENCHMARKS_COMMON_HPP
+#define BEZIERFIT_BENCHMARKS_COMMON_HPP
+
+// Declarations shared by the benchmarks. The benchmarks are implementation units of the bezierfit module, so they reach the
+// engines directly, whether the module exports them or not. Include this after the module declaration, with
+// <benchmark/benchmark.h> in the global module fragment.
+
+namespace bezierfit::bench {
+	// Synthetic inputs. Every dataset is generated from a fixed seed, so results are comparable between runs and machines.
+	enum class Dataset : uint8_t
+	{
+		NoisyCircle = 0, // Circles of radius 100 with up to 0.5 units of jitter
+		Handwriting,     // Cursive-like loops with uneven point spacing, similar to pen input
+		LongPolyline,    // Smooth random walk
+		Zigzag,          // Alternates between two parallel lines on every point; worst case for RdpReduce
+		Spiral,          // Inward spiral; RdpReduce splits off only a few points per level, so it takes quadratic time
+	};
+
+	std::vector<VECTOR> generate_points(Dataset dataset, size_t numPoints);
+
+	// Number of calls to the global operator new since the start of the program. It is defined next to the replaced operator new
+	// outside of the module (see alloc_counter.cpp), so it belongs to the global module.
+	extern "C++" size_t get_allocation_count();
+
+	// Reports the throughput in points per second (items_per_second) and the average number of allocations per iteration
+	void set_counters(benchmark::State& state, size_t pointsPerIteration, size_t allocations);
+
+	// Input sizes used by most benchmarks; the quadratic ones are limited to the small sizes
+	void apply_sizes(benchmark::internal::Benchmark* b);
+	void apply_small_sizes(benchmark::internal::Benchmark* b);
+};
+
+#endif
@@ -0,0 +1,117 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <benchmark/benchmark.h>
+
+module bezierfit;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	// std::minstd_rand produces the same sequence everywhere, unlike the standard distributions
+	class Random
+	{
+	public:
+		explicit Random(uint32_t seed) : _engine(seed) {}
+		// Uniform value in [-1, 1]
+		float Next() { return static_cast<float>(_engine() - std::minstd_rand::min()) / static_cast<float>(std::minstd_rand::max() - std::minstd_rand::min()) * 2.f - 1.f; }
+	private:
+		std::minstd_rand _engine;
+	};
+
+	constexpr float PI = 3.14159265358979f;
+
+	// The datasets are planar; any further components are left at zero
+	VECTOR make_point(float x, float y)
+	{
+		VECTOR p(0);
+		p[0] = x;
+		p[1] = y;
+		return p;
+	}
+}
+
+std::vector<VECTOR> bench::generate_points(Dataset dataset, size_t numPoints)
+{
+	std::vector<VECTOR> points;
+	points.reserve(numPoints);
+	Random random { 1234 + static_cast<uint32_t>(dataset) };
+	switch (dataset)
+	{
+	case Dataset::NoisyCircle:
+	{
+		// One revolution per 512 points
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			float a = static_cast<float>(i) * (2.f * PI / 512.f);
+			points.push_back(make_point(std::cos(a) * 100.f + random.Next() * 0.5f, std::sin(a) * 100.f + random.Next() * 0.5f));
+		}
+		break;
+	}
+	case Dataset::Handwriting:
+	{
+		float t = 0;
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			// Pen speed varies, so the spacing between the points does too
+			t += 0.03f + 0.02f * std::sin(t * 0.7f) + random.Next() * 0.005f;
+			float x = t * 6.f + std::sin(t * 2.f) * 10.f;
+			float y = std::cos(t * 2.f) * 14.f + std::sin(t * 0.35f) * 6.f;
+			points.push_back(make_point(x + random.Next() * 0.1f, y + random.Next() * 0.1f));
+		}
+		break;
+	}
+	case Dataset::LongPolyline:
+	{
+		VECTOR p = make_point(0.f, 0.f);
+		float heading = 0;
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			points.push_back(p);
+			heading += random.Next() * 0.15f;
+			float step = 1.5f + random.Next();
+			p += make_point(std::cos(heading) * step, std::sin(heading) * step);
+		}
+		break;
+	}
+	case Dataset::Zigzag:
+	{
+		for (size_t i = 0; i < numPoints; i++)
+			points.push_back(make_point(static_cast<float>(i), (i % 2) ? 10.f : 0.f));
+		break;
+	}
+	case Dataset::Spiral:
+	{
+		// One revolution per 256 points, with the radius shrinking from 1000 to 0
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			float a = static_cast<float>(i) * (2.f * PI / 256.f);
+			float r = 1000.f * (1.f - static_cast<float>(i) / static_cast<float>(numPoints));
+			points.push_back(make_point(std::cos(a) * r, std::sin(a) * r));
+		}
+		break;
+	}
+	}
+	return points;
+}
+
+void bench::set_counters(benchmark::State& state, size_t pointsPerIteration, size_t allocations)
+{
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * pointsPerIteration));
+	state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+void bench::apply_sizes(benchmark::internal::Benchmark* b)
+{
+	b->ArgName("points")->Arg(256)->Arg(4096)->Arg(65536);
+}
+
+void bench::apply_small_sizes(benchmark::internal::Benchmark* b)
+{
+	b->ArgName("points")->Arg(256)->Arg(1024)->Arg(4096);
+}
@@ -5,3 +5,16 @@
 export module bezierfit;
 
 export import :core;
+export import :cubic_bezier;
+export import :curve_bvh;
+export import :curve_flattener;
+export import :curve_set;
+export import :point_buffer;
+export import :curve_preprocess;
+export import :preprocess_pipeline;
+export import :online_simplifier;
+export import :curve_fit;
+export import :fit_context;
+export import :curve_builder;
+export import :spline;
+export import :spline_builder;
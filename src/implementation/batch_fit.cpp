@@ -0,0 +1,118 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :fit_context;
+import :preprocess_pipeline;
+import :thread_pool;
+
+using namespace bezierfit;
+
+namespace {
+	// Location of the curves of a stroke inside the buffer of the worker that fitted it
+	struct StrokeSlot
+	{
+		unsigned int worker = 0;
+		size_t begin = 0;
+		size_t count = 0;
+	};
+
+	// Every worker allocates from its own pool so that workers don't contend on the global allocator
+	struct WorkerState
+	{
+		std::pmr::unsynchronized_pool_resource pool;
+		FitContext context{ &pool };
+		PreprocessPipeline pipeline{ {}, &pool };
+		std::pmr::vector<VECTOR> reduced{ &pool };
+		std::vector<std::array<VECTOR, 4>> curves;
+	};
+
+	template<typename TGetStroke>
+	BatchResult fit_strokes(size_t numStrokes, const TGetStroke& getStroke, const FitOptions& options, unsigned int threadCount)
+	{
+		if (options.maxError < EPSILON)
+			throw std::invalid_argument("maxError cannot be negative/zero/less than epsilon value");
+
+		BatchResult result;
+		result.offsets.resize(numStrokes + 1, 0);
+		if (numStrokes == 0)
+			return result;
+
+		// Hand out the longest strokes first so that a long stroke picked up late can't stall the batch
+		std::vector<size_t> order(numStrokes);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&getStroke](size_t a, size_t b) { return getStroke(a).size() > getStroke(b).size(); });
+
+		auto& pool = ThreadPool::GetShared();
+		unsigned int numThreads = threadCount == 0 ? pool.GetThreadCount() : std::min(threadCount, pool.GetThreadCount());
+		numThreads = static_cast<unsigned int>(std::min<size_t>(numThreads, numStrokes));
+
+		std::vector<WorkerState> workers(numThreads);
+		for (auto& state : workers)
+			state.pipeline.SetOptions(options);
+		std::vector<StrokeSlot> slots(numStrokes);
+		std::atomic<size_t> next = 0;
+		pool.Run([&](unsigned int workerIndex) {
+			auto& state = workers[workerIndex];
+			for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < numStrokes; i = next.fetch_add(1, std::memory_order_relaxed))
+			{
+				size_t strokeIndex = order[i];
+				auto stroke = getStroke(strokeIndex);
+				auto& slot = slots[strokeIndex];
+				slot.worker = workerIndex;
+				slot.begin = state.curves.size();
+				if (stroke.empty())
+					continue;
+				state.pipeline.Run(stroke, state.reduced);
+				for (auto& bc : state.context.Fit(state.reduced, options.maxError))
+					state.curves.push_back({ bc.p0, bc.p1, bc.p2, bc.p3 });
+				slot.count = state.curves.size() - slot.begin;
+			}
+		}, numThreads);
+
+		// Stitch the per-worker buffers into one contiguous buffer in stroke order
+		for (size_t i = 0; i < numStrokes; i++)
+			result.offsets[i + 1] = result.offsets[i] + slots[i].count;
+		result.curves.resize(result.offsets.back());
+		for (size_t i = 0; i < numStrokes; i++)
+		{
+			auto& slot = slots[i];
+			auto& curves = workers[slot.worker].curves;
+			std::copy_n(curves.begin() + slot.begin, slot.count, result.curves.begin() + result.offsets[i]);
+		}
+		return result;
+	}
+}
+
+BatchResult bezierfit::fit_batch(std::span<const std::vector<VECTOR>> strokes, FLOAT maxError, unsigned int threadCount)
+{
+	return fit_batch(strokes, FitOptions { maxError }, threadCount);
+}
+
+BatchResult bezierfit::fit_batch(std::span<const std::vector<VECTOR>> strokes, const FitOptions& options, unsigned int threadCount)
+{
+	return fit_strokes(strokes.size(), [strokes](size_t i) { return std::span<const VECTOR>{strokes[i]}; }, options, threadCount);
+}
+
+BatchResult bezierfit::fit_batch(std::span<const VECTOR> points, std::span<const size_t> offsets, FLOAT maxError, unsigned int threadCount)
+{
+	return fit_batch(points, offsets, FitOptions { maxError }, threadCount);
+}
+
+BatchResult bezierfit::fit_batch(std::span<const VECTOR> points, std::span<const size_t> offsets, const FitOptions& options, unsigned int threadCount)
+{
+	if (offsets.empty())
+		throw std::invalid_argument("offsets must contain at least one entry");
+	if (offsets.back() > points.size())
+		throw std::out_of_range("Last offset " + std::to_string(offsets.back()) + " is out of range (there are " + std::to_string(points.size()) + " points)");
+	for (size_t i = 1; i < offsets.size(); i++)
+	{
+		if (offsets[i] < offsets[i - 1])
+			throw std::invalid_argument("offsets must be in ascending order");
+	}
+	return fit_strokes(offsets.size() - 1, [points, offsets](size_t i) { return points.subspan(offsets[i], offsets[i + 1] - offsets[i]); }, options, threadCount);
+}
@@ -25,50 +25,388 @@ import :cubic_bezier;
 
 using namespace bezierfit;
 
-CubicBezier::CubicBezier(const VECTOR& p0, const VECTOR& p1, const VECTOR& p2, const VECTOR& p3)
+namespace {
+	// The projection is computed in double precision, since the coefficients of the quintic span a large range
+	using Quintic = std::array<double, 6>;
+
+	// Intervals narrower than this are not subdivided any further
+	constexpr int MAX_SUBDIVISION_DEPTH = 24;
+	constexpr int MAX_NEWTON_ITERS = 64;
+	constexpr double NEWTON_TOLERANCE = 1e-10;
+
+	// Part [a ... b] of the parameter range, with the Bernstein coefficients of the quintic on it
+	struct BernsteinInterval
+	{
+		double a;
+		double b;
+		Quintic coeffs;
+		int depth;
+	};
+
+	double eval_power(const Quintic& c, double t)
+	{
+		return ((((c[5] * t + c[4]) * t + c[3]) * t + c[2]) * t + c[1]) * t + c[0];
+	}
+
+	double eval_power_derivative(const Quintic& c, double t)
+	{
+		return (((5 * c[5] * t + 4 * c[4]) * t + 3 * c[3]) * t + 2 * c[2]) * t + c[1];
+	}
+
+	// Upper bound of the number of roots in the interval (Descartes' rule of signs for the Bernstein basis)
+	int count_sign_changes(const Quintic& c)
+	{
+		int changes = 0;
+		double prev = 0;
+		for (double v : c)
+		{
+			if (v == 0)
+				continue;
+			if (prev != 0 && (v < 0) != (prev < 0))
+				++changes;
+			prev = v;
+		}
+		return changes;
+	}
+
+	// de Casteljau subdivision at the center of the interval
+	void split(const Quintic& c, Quintic& left, Quintic& right)
+	{
+		Quintic tmp = c;
+		for (int i = 0; i < 6; i++)
+		{
+			left[i] = tmp[0];
+			right[5 - i] = tmp[5 - i];
+			for (int j = 0; j < 5 - i; j++)
+				tmp[j] = (tmp[j] + tmp[j + 1]) * 0.5;
+		}
+	}
+
+	// Root of f within [a ... b], where f(a) and f(b) have opposite signs. Newton steps that leave the bracket or don't
+	// at least halve the previous step are replaced by bisection, so the bracket keeps shrinking.
+	double refine_root(const Quintic& f, double a, double b, double fa)
+	{
+		double x = (a + b) * 0.5;
+		double prevStep = b - a;
+		for (int i = 0; i < MAX_NEWTON_ITERS; i++)
+		{
+			double fx = eval_power(f, x);
+			if (fx == 0)
+				return x;
+			if ((fx < 0) == (fa < 0))
+			{
+				a = x;
+				fa = fx;
+			}
+			else
+				b = x;
+			double df = eval_power_derivative(f, x);
+			double next = df != 0 ? x - fx / df : a;
+			if (next <= a || next >= b || std::abs(next - x) > prevStep * 0.5)
+				next = (a + b) * 0.5;
+			prevStep = std::abs(next - x);
+			if (prevStep < NEWTON_TOLERANCE || b - a < NEWTON_TOLERANCE)
+				return next;
+			x = next;
+		}
+		return x;
+	}
+}
+
+template<typename T, int N>
+bool BasicBoundingBox<T, N>::IsEmpty() const { return glm::any(glm::greaterThan(min, max)); }
+
+template<typename T, int N>
+void BasicBoundingBox<T, N>::Include(const Vector& p)
+{
+	min = glm::min(min, p);
+	max = glm::max(max, p);
+}
+
+template<typename T, int N>
+void BasicBoundingBox<T, N>::Include(const BasicBoundingBox& other)
+{
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+template<typename T, int N>
+bool BasicBoundingBox<T, N>::Intersects(const BasicBoundingBox& other) const
+{
+	return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+}
+
+template<typename T, int N>
+glm::vec<N, T> BasicBoundingBox<T, N>::GetCenter() const { return (min + max) * T(0.5); }
+
+template<typename T, int N>
+T BasicBoundingBox<T, N>::GetDistanceSquared(const Vector& p) const
+{
+	Vector d = glm::max(glm::max(min - p, p - max), Vector(0));
+	return glm::dot(d, d);
+}
+
+template<typename T, int N>
+BasicCubicBezier<T, N>::BasicCubicBezier(const Vector& p0, const Vector& p1, const Vector& p2, const Vector& p3)
 	: p0(p0), p1(p1), p2(p2), p3(p3)
 {
 }
 
-VECTOR CubicBezier::Sample(FLOAT t) const
+template<typename T, int N>
+glm::vec<N, T> BasicCubicBezier<T, N>::Sample(T t) const
 {
-	FLOAT ti = 1.0 - t;
-	FLOAT t0 = ti * ti * ti;
-	FLOAT t1 = 3.0 * ti * ti * t;
-	FLOAT t2 = 3.0 * ti * t * t;
-	FLOAT t3 = t * t * t;
+	T ti = 1 - t;
+	T t0 = ti * ti * ti;
+	T t1 = 3 * ti * ti * t;
+	T t2 = 3 * ti * t * t;
+	T t3 = t * t * t;
 	return (t0 * p0) + (t1 * p1) + (t2 * p2) + (t3 * p3);
 }
 
-VECTOR CubicBezier::Derivative(FLOAT t) const
+template<typename T, int N>
+glm::vec<N, T> BasicCubicBezier<T, N>::Derivative(T t) const
 {
-	FLOAT ti = 1.0 - t;
-	FLOAT tp0 = 3.0 * ti * ti;
-	FLOAT tp1 = 6.0 * t * ti;
-	FLOAT tp2 = 3.0 * t * t;
+	T ti = 1 - t;
+	T tp0 = 3 * ti * ti;
+	T tp1 = 6 * t * ti;
+	T tp2 = 3 * t * t;
 	return (tp0 * (p1 - p0)) + (tp1 * (p2 - p1)) + (tp2 * (p3 - p2));
 }
 
-VECTOR CubicBezier::Tangent(FLOAT t) const
+template<typename T, int N>
+glm::vec<N, T> BasicCubicBezier<T, N>::Tangent(T t) const
+{
+	return BasicVectorHelper<T, N>::Normalize(Derivative(t));
+}
+
+template<typename T, int N>
+BasicBoundingBox<T, N> BasicCubicBezier<T, N>::GetControlBounds() const
+{
+	BoundingBox bounds;
+	bounds.min = glm::min(glm::min(p0, p1), glm::min(p2, p3));
+	bounds.max = glm::max(glm::max(p0, p1), glm::max(p2, p3));
+	return bounds;
+}
+
+template<typename T, int N>
+BasicBoundingBox<T, N> BasicCubicBezier<T, N>::GetBounds() const
 {
-	return VectorHelper::Normalize(Derivative(t));
+	BoundingBox bounds;
+	bounds.Include(p0);
+	bounds.Include(p3);
+	// Half of the derivative per component: a * t^2 + b * t + c. Its roots in (0 ... 1) are the extremes of that component.
+	Vector a = p3 - p0 + (p1 - p2) * T(3);
+	Vector b = (p0 - p1 * T(2) + p2) * T(2);
+	Vector c = p1 - p0;
+	auto include = [&](T t) {
+		if (t > 0 && t < 1)
+			bounds.Include(Sample(t));
+	};
+	for (int i = 0; i < N; i++)
+	{
+		// The control points of this component don't extend past its end points, so neither does the curve
+		if (std::min(p1[i], p2[i]) >= bounds.min[i] && std::max(p1[i], p2[i]) <= bounds.max[i])
+			continue;
+		if (a[i] == 0)
+		{
+			if (b[i] != 0)
+				include(-c[i] / b[i]);
+			continue;
+		}
+		T disc = b[i] * b[i] - 4 * a[i] * c[i];
+		if (disc < 0)
+			continue;
+		// Computes the smaller root from the larger one to avoid cancellation
+		T q = T(-0.5) * (b[i] + std::copysign(std::sqrt(disc), b[i]));
+		include(q / a[i]);
+		if (q != 0)
+			include(c[i] / q);
+	}
+	return bounds;
+}
+
+template<typename T, int N>
+T BasicCubicBezier<T, N>::Project(const Vector& p, T& t) const
+{
+	using DVECTOR = glm::vec<N, double>;
+
+	// Power basis of the curve relative to p: B(t) - p = ((a * t + b) * t + c) * t + d
+	DVECTOR d = DVECTOR(p0) - DVECTOR(p);
+	DVECTOR c = (DVECTOR(p1) - DVECTOR(p0)) * 3.0;
+	DVECTOR b = (DVECTOR(p2) - DVECTOR(p1) * 2.0 + DVECTOR(p0)) * 3.0;
+	DVECTOR a = DVECTOR(p3) - DVECTOR(p0) + (DVECTOR(p1) - DVECTOR(p2)) * 3.0;
+
+	// (B(t) - p) . B'(t), half the derivative of the squared distance
+	Quintic f {
+		glm::dot(c, d),
+		glm::dot(c, c) + 2 * glm::dot(b, d),
+		3 * glm::dot(b, c) + 3 * glm::dot(a, d),
+		4 * glm::dot(a, c) + 2 * glm::dot(b, b),
+		5 * glm::dot(a, b),
+		3 * glm::dot(a, a),
+	};
+
+	auto getDistanceSquared = [&](double u) {
+		DVECTOR v = ((a * u + b) * u + c) * u + d;
+		return glm::dot(v, v);
+	};
+	double bestT = 0;
+	double bestDistSq = getDistanceSquared(0);
+	auto consider = [&](double u) {
+		double distSq = getDistanceSquared(u);
+		if (distSq < bestDistSq)
+		{
+			bestDistSq = distSq;
+			bestT = u;
+		}
+	};
+	consider(1);
+
+	// Bernstein coefficients on [0 ... 1]: b_i = sum over j <= i of binomial(i, j) / binomial(5, j) * f_j
+	constexpr double BINOMIAL[6][6] = {
+		{ 1 }, { 1, 1 }, { 1, 2, 1 }, { 1, 3, 3, 1 }, { 1, 4, 6, 4, 1 }, { 1, 5, 10, 10, 5, 1 },
+	};
+	Quintic bernstein {};
+	for (int i = 0; i < 6; i++)
+	{
+		for (int j = 0; j <= i; j++)
+			bernstein[i] += BINOMIAL[i][j] / BINOMIAL[5][j] * f[j];
+	}
+
+	// Every subdivision replaces an interval with two, so the stack never holds more than one per level
+	std::array<BernsteinInterval, MAX_SUBDIVISION_DEPTH + 2> stack;
+	int size = 0;
+	stack[size++] = { 0, 1, bernstein, 0 };
+	while (size > 0)
+	{
+		BernsteinInterval interval = stack[--size];
+		int changes = count_sign_changes(interval.coeffs);
+		if (changes == 0)
+			continue;
+		// The first and last coefficients are the values at the ends of the interval
+		double fa = interval.coeffs.front();
+		double fb = interval.coeffs.back();
+		if (fa == 0)
+			consider(interval.a);
+		if (fb == 0)
+			consider(interval.b);
+		if (changes == 1 && fa != 0 && fb != 0)
+			consider(refine_root(f, interval.a, interval.b, fa));
+		else if (interval.depth == MAX_SUBDIVISION_DEPTH)
+			consider((interval.a + interval.b) * 0.5);
+		else
+		{
+			double mid = (interval.a + interval.b) * 0.5;
+			BernsteinInterval left { interval.a, mid, {}, interval.depth + 1 };
+			BernsteinInterval right { mid, interval.b, {}, interval.depth + 1 };
+			split(interval.coeffs, left.coeffs, right.coeffs);
+			stack[size++] = right;
+			stack[size++] = left;
+		}
+	}
+	t = static_cast<T>(bestT);
+	return static_cast<T>(std::sqrt(bestDistSq));
 }
 
-std::string CubicBezier::ToString() const
+template<typename T, int N>
+std::string BasicCubicBezier<T, N>::ToString() const
 {
 	std::ostringstream oss;
-	oss << "CubicBezier: (<" << std::fixed << std::setprecision(3) << p0.x << ", " << p0.y << "> <"
-		<< p1.x << ", " << p1.y << "> <" << p2.x << ", " << p2.y << "> <" << p3.x << ", " << p3.y << ">)";
+	oss << "CubicBezier: (" << std::fixed << std::setprecision(3);
+	for (const Vector* p : { &p0, &p1, &p2, &p3 })
+	{
+		oss << (p == &p0 ? "<" : " <");
+		for (int i = 0; i < N; i++)
+			oss << (i == 0 ? "" : ", ") << (*p)[i];
+		oss << ">";
+	}
+	oss << ")";
 	return oss.str();
 }
 
 // Equality members
-bool CubicBezier::operator==(const CubicBezier& other) const
+template<typename T, int N>
+bool BasicCubicBezier<T, N>::operator==(const BasicCubicBezier& other) const
 {
 	return p0 == other.p0 && p1 == other.p1 && p2 == other.p2 && p3 == other.p3;
 }
 
-bool CubicBezier::operator!=(const CubicBezier& other) const
+template<typename T, int N>
+bool BasicCubicBezier<T, N>::operator!=(const BasicCubicBezier& other) const
 {
 	return !(*this == other);
 }
+
+template<typename T, int N>
+BasicPowerBasis<T, N>::BasicPowerBasis(const BasicCubicBezier<T, N>& curve)
+	: a(curve.p3 - curve.p0 + (curve.p1 - curve.p2) * T(3)),
+	  b((curve.p0 - curve.p1 * T(2) + curve.p2) * T(3)),
+	  c((curve.p1 - curve.p0) * T(3)),
+	  d(curve.p0)
+{
+}
+
+template<typename T, int N>
+glm::vec<N, T> BasicPowerBasis<T, N>::Sample(T t) const
+{
+	return ((a * t + b) * t + c) * t + d;
+}
+
+template<typename T, int N>
+glm::vec<N, T> BasicPowerBasis<T, N>::Derivative(T t) const
+{
+	return (a * (T(3) * t) + b * T(2)) * t + c;
+}
+
+template<typename T, int N>
+BasicForwardDifferencer<T, N>::BasicForwardDifferencer(const BasicCubicBezier<T, N>& curve, int steps)
+{
+	if (steps < 1)
+		throw std::invalid_argument("steps must be at least 1");
+	DVECTOR p0 { curve.p0 }, p1 { curve.p1 }, p2 { curve.p2 }, p3 { curve.p3 };
+	DVECTOR a = p3 - p0 + (p1 - p2) * 3.0;
+	DVECTOR b = (p0 - p1 * 2.0 + p2) * 3.0;
+	DVECTOR c = (p1 - p0) * 3.0;
+	double h = 1.0 / steps;
+	// First, second and third differences of the polynomial at t = 0 for the step h
+	DVECTOR ah3 = a * (h * h * h);
+	DVECTOR bh2 = b * (h * h);
+	_point = p0;
+	_d1 = ah3 + bh2 + c * h;
+	_d2 = ah3 * 6.0 + bh2 * 2.0;
+	_d3 = ah3 * 6.0;
+}
+
+template<typename T, int N>
+glm::vec<N, T> BasicForwardDifferencer<T, N>::Get() const { return Vector(_point); }
+
+template<typename T, int N>
+void BasicForwardDifferencer<T, N>::Next()
+{
+	_point += _d1;
+	_d1 += _d2;
+	_d2 += _d3;
+}
+
+template struct bezierfit::BasicBoundingBox<float, 2>;
+template struct bezierfit::BasicBoundingBox<float, 3>;
+template struct bezierfit::BasicBoundingBox<double, 2>;
+template struct bezierfit::BasicBoundingBox<double, 3>;
+template class bezierfit::BasicCubicBezier<float, 2>;
+template class bezierfit::BasicCubicBezier<float, 3>;
+template class bezierfit::BasicCubicBezier<double, 2>;
+template class bezierfit::BasicCubicBezier<double, 3>;
+template struct bezierfit::BasicPowerBasis<float, 2>;
+template struct bezierfit::BasicPowerBasis<float, 3>;
+template struct bezierfit::BasicPowerBasis<double, 2>;
+template struct bezierfit::BasicPowerBasis<double, 3>;
+template class bezierfit::BasicForwardDifferencer<float, 2>;
+template class bezierfit::BasicForwardDifferencer<float, 3>;
+template class bezierfit::BasicForwardDifferencer<double, 2>;
+template class bezierfit::BasicForwardDifferencer<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template struct bezierfit::BasicBoundingBox<FLOAT, 4>;
+template class bezierfit::BasicCubicBezier<FLOAT, 4>;
+template struct bezierfit::BasicPowerBasis<FLOAT, 4>;
+template class bezierfit::BasicForwardDifferencer<FLOAT, 4>;
+#endif
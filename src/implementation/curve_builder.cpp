@@ -26,42 +26,166 @@ import :curve_builder;
 
 using namespace bezierfit;
 
-const CurveBuilder::AddPointResult bezierfit::CurveBuilder::AddPointResult::NO_CHANGE {};
+template<typename T, int N>
+const typename BasicCurveBuilder<T, N>::AddPointResult BasicCurveBuilder<T, N>::AddPointResult::NO_CHANGE {};
 
-bool  CurveBuilder::AddPointResult::WasChanged() const { return data != 0; }
-int CurveBuilder::AddPointResult::FirstChangedIndex() const { return std::abs(data) - 1; }
-bool CurveBuilder::AddPointResult::WasAdded() const { return data < 0; }
+template<typename T, int N>
+bool  BasicCurveBuilder<T, N>::AddPointResult::WasChanged() const { return data != 0; }
+template<typename T, int N>
+int BasicCurveBuilder<T, N>::AddPointResult::FirstChangedIndex() const { return std::abs(data) - 1; }
+template<typename T, int N>
+bool BasicCurveBuilder<T, N>::AddPointResult::WasAdded() const { return data < 0; }
 
-CurveBuilder::AddPointResult::AddPointResult(int firstChangedIndex, bool curveAdded)
+template<typename T, int N>
+BasicCurveBuilder<T, N>::AddPointResult::AddPointResult(int firstChangedIndex, bool curveAdded)
 	: data((firstChangedIndex + 1)* (curveAdded ? -1 : 1))
 {
 	assert(firstChangedIndex >= 0 && firstChangedIndex != std::numeric_limits<int>::max());
 }
 
-CurveBuilder::CurveBuilder(FLOAT linDist, FLOAT error)
-	:_linDist(linDist), _totalLength(0.0f), _first(0), _tanL(VECTOR{ 0.0f, 0.0f })
+template<typename T, int N>
+BasicCurveBuilder<T, N>::BasicCurveBuilder(T linDist, T error, std::pmr::memory_resource* resource)
+	:Base(resource), _linDist(linDist), _totalLength(0.0f), _first(0), _tanL(Vector(0)), _points(resource), _result(resource), _simplifier(0, OnlineSimplifier::DEFAULT_MAX_LOOKAHEAD, resource)
 {
 	_squaredError = error * error;
 }
 
-CurveBuilder::AddPointResult CurveBuilder::AddPoint(const VECTOR& p)
+template<typename T, int N>
+void BasicCurveBuilder<T, N>::StreamingStats::Reset() { *this = {}; }
+template<typename T, int N>
+size_t BasicCurveBuilder<T, N>::StreamingStats::GetCallCount() const { return _count; }
+template<typename T, int N>
+size_t BasicCurveBuilder<T, N>::StreamingStats::GetForcedSplitCount() const { return _forcedSplits; }
+
+template<typename T, int N>
+size_t BasicCurveBuilder<T, N>::StreamingStats::GetMaxRefitPoints() const { return _maxRefitPoints; }
+
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::StreamingStats::Duration BasicCurveBuilder<T, N>::StreamingStats::GetPercentile(double p) const
+{
+	if (p < 0 || p > 1)
+		throw std::invalid_argument("p must be between 0 and 1");
+	if (_count == 0)
+		return Duration { 0 };
+	size_t rank = std::max<size_t>(static_cast<size_t>(std::ceil(p * _count)), 1);
+	size_t total = 0;
+	for (int i = 0; i < static_cast<int>(_buckets.size()); i++)
+	{
+		total += _buckets[i];
+		if (total >= rank)
+			return std::min(Duration { static_cast<Duration::rep>(GetBucketUpperBound(i)) }, _max);
+	}
+	return _max;
+}
+
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::StreamingStats::Duration BasicCurveBuilder<T, N>::StreamingStats::GetP50() const { return GetPercentile(0.5); }
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::StreamingStats::Duration BasicCurveBuilder<T, N>::StreamingStats::GetP99() const { return GetPercentile(0.99); }
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::StreamingStats::Duration BasicCurveBuilder<T, N>::StreamingStats::GetMax() const { return _max; }
+
+template<typename T, int N>
+void BasicCurveBuilder<T, N>::StreamingStats::Record(Duration latency)
+{
+	uint64_t ns = static_cast<uint64_t>(std::max<Duration::rep>(latency.count(), 0));
+	++_buckets[GetBucket(ns)];
+	++_count;
+	_max = std::max(_max, Duration { static_cast<Duration::rep>(ns) });
+}
+
+template<typename T, int N>
+int BasicCurveBuilder<T, N>::StreamingStats::GetBucket(uint64_t ns)
+{
+	// Values below SUB_BUCKETS get a bucket each, above that every power of two is split into SUB_BUCKETS linear buckets
+	if (ns < SUB_BUCKETS)
+		return static_cast<int>(ns);
+	int exponent = std::bit_width(ns) - 1;
+	int shift = exponent - SUB_BUCKET_BITS;
+	return (shift + 1) * SUB_BUCKETS + static_cast<int>((ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+template<typename T, int N>
+uint64_t BasicCurveBuilder<T, N>::StreamingStats::GetBucketUpperBound(int bucket)
+{
+	if (bucket < SUB_BUCKETS)
+		return bucket;
+	int shift = bucket / SUB_BUCKETS - 1;
+	uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+	return lower + ((uint64_t { 1 } << shift) - 1);
+}
+
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::AddPointResult BasicCurveBuilder<T, N>::AddPoint(const Vector& p)
+{
+	if (!_streamingStats && _streaming.timeBudget.count() == 0)
+		return AddSimplified(p);
+	_callStart = std::chrono::steady_clock::now();
+	_overBudget = false;
+	AddPointResult res = AddSimplified(p);
+	if (_streamingStats)
+		_streamingStats->Record(std::chrono::steady_clock::now() - _callStart);
+	return res;
+}
+
+template<typename T, int N>
+const typename BasicCurveBuilder<T, N>::StreamingOptions& BasicCurveBuilder<T, N>::GetStreamingOptions() const { return _streaming; }
+
+template<typename T, int N>
+void BasicCurveBuilder<T, N>::SetStreamingOptions(const StreamingOptions& options)
+{
+	if (options.maxSegmentPoints != 0 && options.maxSegmentPoints < 3)
+		throw std::invalid_argument("maxSegmentPoints must be 0 or at least 3");
+	if (options.timeBudget.count() < 0)
+		throw std::invalid_argument("timeBudget cannot be negative");
+	_simplifier = OnlineSimplifier { options.simplifyTolerance, options.simplifyLookahead, _points.get_allocator().resource() };
+	_streaming = options;
+}
+
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::AddPointResult BasicCurveBuilder<T, N>::Flush()
+{
+	Vector kept;
+	if (_streaming.simplifyTolerance == 0 || !_simplifier.Finish(kept))
+		return AddPointResult::NO_CHANGE;
+	_callStart = std::chrono::steady_clock::now();
+	_overBudget = false;
+	return AddInterpolated(kept);
+}
+
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::AddPointResult BasicCurveBuilder<T, N>::AddSimplified(const Vector& p)
 {
-	VECTOR prev = _prev;
-	std::vector<VECTOR>& pts = _pts;
+	if (_streaming.simplifyTolerance == 0)
+		return AddInterpolated(p);
+	Vector kept;
+	if (!_simplifier.Add(p, kept))
+		return AddPointResult::NO_CHANGE;
+	return AddInterpolated(kept);
+}
+
+template<typename T, int N>
+void BasicCurveBuilder<T, N>::SetStreamingStats(StreamingStats* stats) { _streamingStats = stats; }
+
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::AddPointResult BasicCurveBuilder<T, N>::AddInterpolated(const Vector& p)
+{
+	Vector prev = _prev;
+	std::pmr::vector<Vector>& pts = _points;
 	int count = static_cast<int>(pts.size());
 	if (count != 0)
 	{
-		FLOAT td = VectorHelper::Distance(prev, p);
-		FLOAT md = _linDist;
+		T td = BasicVectorHelper<T, N>::Distance(prev, p);
+		T md = _linDist;
 		if (td > md)
 		{
 			int first = std::numeric_limits<int>::max();
 			bool add = false;
-			FLOAT rd = td - md;
-			VECTOR dir = VectorHelper::Normalize(p - prev);
+			T rd = td - md;
+			Vector dir = BasicVectorHelper<T, N>::Normalize(p - prev);
 			do
 			{
-				VECTOR np = prev + dir * md;
+				Vector np = prev + dir * md;
 				AddPointResult res = AddInternal(np);
 				first = std::min(first, res.FirstChangedIndex());
 				add |= res.WasAdded();
@@ -76,45 +200,52 @@ CurveBuilder::AddPointResult CurveBuilder::AddPoint(const VECTOR& p)
 	else
 	{
 		_prev = p;
-		_pts.push_back(p);
+		_points.push_back(p);
+		_pts = _points;
 		_arclen.push_back(0.0f);
 		return AddPointResult::NO_CHANGE;
 	}
 }
 
-const std::vector<CubicBezier>& CurveBuilder::Curves() const { return _result; }
+template<typename T, int N>
+const std::pmr::vector<BasicCubicBezier<T, N>>& BasicCurveBuilder<T, N>::Curves() const { return _result; }
 
-void CurveBuilder::Clear()
+template<typename T, int N>
+void BasicCurveBuilder<T, N>::Clear()
 {
 	_result.clear();
-	_pts.clear();
+	_points.clear();
+	_simplifier.Reset();
+	_pts = {};
 	_arclen.clear();
 	_u.clear();
 	_totalLength = 0.0f;
 	_first = 0;
-	_tanL = VECTOR{ 0.0f, 0.0f };
-	_prev = VECTOR{ 0.0f, 0.0f };
+	_tanL = Vector(0);
+	_prev = Vector(0);
 }
 
-CurveBuilder::AddPointResult CurveBuilder::AddInternal(const VECTOR& np)
+template<typename T, int N>
+typename BasicCurveBuilder<T, N>::AddPointResult BasicCurveBuilder<T, N>::AddInternal(const Vector& np)
 {
-	std::vector<VECTOR>& pts = _pts;
+	std::pmr::vector<Vector>& pts = _points;
 	int last = static_cast<int>(pts.size());
 	assert(last != 0);
 
 	pts.push_back(np);
+	_pts = pts;
 	_arclen.push_back(_totalLength = _totalLength + _linDist);
 
 	if (last == 1)
 	{
 		assert(_result.empty());
-		VECTOR p0 = pts[0];
-		VECTOR tanL = VectorHelper::Normalize(np - p0);
-		VECTOR tanR = -tanL;
+		Vector p0 = pts[0];
+		Vector tanL = BasicVectorHelper<T, N>::Normalize(np - p0);
+		Vector tanR = -tanL;
 		_tanL = tanL;
-		FLOAT alpha = _linDist / 3;
-		VECTOR p1 = tanL * alpha + p0;
-		VECTOR p2 = tanR * alpha + np;
+		T alpha = _linDist / 3;
+		Vector p1 = tanL * alpha + p0;
+		Vector p2 = tanR * alpha + np;
 		_result.push_back(CubicBezier(p0, p1, p2, np));
 		return AddPointResult(0, true);
 	}
@@ -123,80 +254,101 @@ CurveBuilder::AddPointResult CurveBuilder::AddInternal(const VECTOR& np)
 		int lastCurve = static_cast<int>(_result.size()) - 1;
 		int first = _first;
 
-		VECTOR tanL = lastCurve == 0 ? GetLeftTangent(last) : _tanL;
-		VECTOR tanR = GetRightTangent(first);
+		Vector tanL = lastCurve == 0 ? GetLeftTangent(last) : _tanL;
+		Vector tanR = GetRightTangent(first);
+
+		if (_streamingStats)
+			_streamingStats->_maxRefitPoints = std::max(_streamingStats->_maxRefitPoints, static_cast<size_t>(last - first + 1));
 
 		// Try fitting with the new point
 		int split;
 		CubicBezier curve;
-		if (FitCurve(first, last, tanL, tanR, curve, split))
+		bool fits = FitCurve(first, last, tanL, tanR, curve, split, _u, _stats);
+		if (fits && !ShouldForceSplit(first, last))
 		{
 			_result[lastCurve] = curve;
 			return AddPointResult(lastCurve, false);
 		}
 		else
 		{
+			if (fits)
+			{
+				// Split off the end, so the curve that keeps getting refitted starts out with only a few points
+				split = std::max(first + 1, last - _policy.midTangentPoints);
+				if (_streamingStats)
+					++_streamingStats->_forcedSplits;
+			}
+
 			// Need to split
-			VECTOR tanM1 = GetCenterTangent(first, last, split);
-			VECTOR tanM2 = -tanM1;
+			Vector tanM1 = GetCenterTangent(first, last, split);
+			Vector tanM2 = -tanM1;
 
-			if (first == 0 && split < END_TANGENT_N_PTS)
+			// The points before _first may have been retired, so the first curve is recognized by its index instead
+			if (lastCurve == 0 && split < _policy.endTangentPoints)
 				tanL = GetLeftTangent(split);
 
 			// Do a final pass on the first half of the curve
 			int unused;
-			FitCurve(first, split, tanL, tanM1, curve, unused);
+			FitCurve(first, split, tanL, tanM1, curve, unused, _u, _stats);
 			_result[lastCurve] = curve;
 
 			// Prepare to fit the second half
-			FitCurve(split, last, tanM2, tanR, curve, unused);
+			FitCurve(split, last, tanM2, tanR, curve, unused, _u, _stats);
 			_result.push_back(curve);
 			_first = split;
 			_tanL = tanM2;
+			RetirePoints();
 
 			return AddPointResult(lastCurve, true);
 		}
 	}
 }
 
-bool CurveBuilder::FitCurve(int first, int last, const VECTOR& tanL, const VECTOR& tanR, CubicBezier& curve, int& split)
+template<typename T, int N>
+bool BasicCurveBuilder<T, N>::ShouldForceSplit(int first, int last)
 {
-	std::vector<VECTOR> pts = _pts;
-	int nPts = last - first + 1;
-	if (nPts < 2)
-	{
-		throw new std::logic_error("INTERNAL ERROR: Should always have at least 2 points here");
-	}
-	else if (nPts == 2)
-	{
-		// if we only have 2 points left, estimate the curve using Wu/Barsky
-		VECTOR p0 = pts[first];
-		VECTOR p3 = pts[last];
-		FLOAT alpha = VectorHelper::Distance(p0, p3) / 3;
-		VECTOR p1 = (tanL * alpha) + p0;
-		VECTOR p2 = (tanR * alpha) + p3;
-		curve = CubicBezier(p0, p1, p2, p3);
-		split = 0;
+	if (last - first < 2)
+		return false; // there is no point in between to split at
+	int count = last - first + 1;
+	if (_streaming.maxSegmentPoints > 0 && count > _streaming.maxSegmentPoints)
 		return true;
-	}
-	else
-	{
-		split = 0;
-		ArcLengthParamaterize(first, last); // initially start u with a simple chord-length paramaterization
-		curve = CubicBezier{};
-		for (int i = 0; i < MAX_ITERS + 1; i++)
-		{
-			if (i != 0) Reparameterize(first, last, curve);                                  // use newton's method to find better parameters (except on first run, since we don't have a curve yet)
-			curve = GenerateBezier(first, last, tanL, tanR);                                // generate the curve itself
-			FLOAT error = FindMaxSquaredError(first, last, curve, split);               // calculate error and get split point (point of max error)
-			if (error < _squaredError)  return true;                                         // if we're within error tolerance, awesome!
-		}
+	if (_streaming.timeBudget.count() == 0)
 		return false;
-	}
+	if (!_overBudget)
+		_overBudget = std::chrono::steady_clock::now() - _callStart > _streaming.timeBudget;
+	// A forced split leaves midTangentPoints + 1 points, so until the call ends the last curve is refitted with at most twice as many
+	return _overBudget && count > std::max(3, 2 * _policy.midTangentPoints);
+}
+
+template<typename T, int N>
+void BasicCurveBuilder<T, N>::RetirePoints()
+{
+	// Only drop the retired points once they make up at least half of the buffer, so every point is moved
+	// a constant number of times on average and the buffer stays proportional to the active segment.
+	// The arc lengths keep their values; only differences and ratios of them are used.
+	int active = static_cast<int>(_points.size()) - _first;
+	if (_first == 0 || _first < active)
+		return;
+	_points.erase(_points.begin(), _points.begin() + _first);
+	_arclen.erase(_arclen.begin(), _arclen.begin() + _first);
+	_pts = _points;
+	_first = 0;
 }
 
-std::vector<CubicBezier>::const_iterator CurveBuilder::begin() const { return _result.cbegin(); }
-std::vector<CubicBezier>::const_iterator CurveBuilder::end() const { return _result.cend(); }
+template<typename T, int N>
+typename std::pmr::vector<BasicCubicBezier<T, N>>::const_iterator BasicCurveBuilder<T, N>::begin() const { return _result.cbegin(); }
+template<typename T, int N>
+typename std::pmr::vector<BasicCubicBezier<T, N>>::const_iterator BasicCurveBuilder<T, N>::end() const { return _result.cend(); }
+
+template<typename T, int N>
+typename std::pmr::vector<BasicCubicBezier<T, N>>::iterator BasicCurveBuilder<T, N>::begin() { return _result.begin(); }
+template<typename T, int N>
+typename std::pmr::vector<BasicCubicBezier<T, N>>::iterator BasicCurveBuilder<T, N>::end() { return _result.end(); }
 
-std::vector<CubicBezier>::iterator CurveBuilder::begin() { return _result.begin(); }
-std::vector<CubicBezier>::iterator CurveBuilder::end() { return _result.end(); }
+template class bezierfit::BasicCurveBuilder<float, 2>;
+template class bezierfit::BasicCurveBuilder<float, 3>;
+template class bezierfit::BasicCurveBuilder<double, 2>;
+template class bezierfit::BasicCurveBuilder<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicCurveBuilder<FLOAT, 4>;
+#endif
@@ -0,0 +1,302 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :curve_bvh;
+
+using namespace bezierfit;
+
+namespace {
+	// The nodes are split at the median, so the depth is at most log2 of the number of curves
+	constexpr int MAX_STACK_SIZE = 64;
+
+	struct StackEntry
+	{
+		int node;
+		// Squared distance from the query point to the bounds of the node
+		FLOAT distSq;
+	};
+}
+
+CurveBvh::CurveBvh(std::pmr::memory_resource* resource)
+	: _nodes(resource), _parents(resource), _indices(resource), _curveBounds(resource), _leaves(resource)
+{
+}
+
+CurveBvh::CurveBvh(std::span<const CubicBezier> curves, std::pmr::memory_resource* resource)
+	: CurveBvh(resource)
+{
+	Build(curves);
+}
+
+void CurveBvh::Build(std::span<const CubicBezier> curves)
+{
+	if (curves.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+		throw std::invalid_argument("too many curves");
+	_curveBounds.clear();
+	_curveBounds.reserve(curves.size());
+	for (auto& curve : curves)
+		_curveBounds.push_back(curve.GetBounds());
+	Rebuild();
+}
+
+void CurveBvh::Build(std::span<const std::array<VECTOR, 4>> curves)
+{
+	if (curves.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+		throw std::invalid_argument("too many curves");
+	_curveBounds.clear();
+	_curveBounds.reserve(curves.size());
+	for (auto& c : curves)
+		_curveBounds.push_back(CubicBezier(c[0], c[1], c[2], c[3]).GetBounds());
+	Rebuild();
+}
+
+void CurveBvh::Rebuild()
+{
+	int count = static_cast<int>(_curveBounds.size());
+	_nodes.clear();
+	_parents.clear();
+	_indices.resize(count);
+	_leaves.resize(count);
+	for (int i = 0; i < count; i++)
+		_indices[i] = i;
+	if (count == 0)
+		return;
+	int maxNodes = 2 * ((count + MAX_LEAF_SIZE - 1) / MAX_LEAF_SIZE);
+	_nodes.reserve(maxNodes);
+	_parents.reserve(maxNodes);
+	BuildNode(0, count, -1);
+}
+
+int CurveBvh::BuildNode(int first, int count, int parent)
+{
+	int nodeIndex = static_cast<int>(_nodes.size());
+	_nodes.push_back({ {}, first, count });
+	_parents.push_back(parent);
+	BoundingBox bounds;
+	BoundingBox centers;
+	for (int i = first; i < first + count; i++)
+	{
+		const BoundingBox& curveBounds = _curveBounds[_indices[i]];
+		bounds.Include(curveBounds);
+		centers.Include(curveBounds.GetCenter());
+	}
+	_nodes[nodeIndex].bounds = bounds;
+	if (count <= MAX_LEAF_SIZE)
+	{
+		for (int i = first; i < first + count; i++)
+			_leaves[_indices[i]] = nodeIndex;
+		return nodeIndex;
+	}
+
+	int axis = 0;
+	VECTOR extent = centers.max - centers.min;
+	for (int i = 1; i < DIMENSION; i++)
+	{
+		if (extent[i] > extent[axis])
+			axis = i;
+	}
+	int half = count / 2;
+	auto begin = _indices.begin() + first;
+	std::nth_element(begin, begin + half, begin + count, [&](int a, int b) {
+		return _curveBounds[a].GetCenter()[axis] < _curveBounds[b].GetCenter()[axis];
+	});
+	BuildNode(first, half, nodeIndex);
+	int right = BuildNode(first + half, count - half, nodeIndex);
+	_nodes[nodeIndex].first = right;
+	_nodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+void CurveBvh::Add(const CubicBezier& curve)
+{
+	if (_curveBounds.size() == static_cast<size_t>(std::numeric_limits<int>::max()))
+		throw std::invalid_argument("too many curves");
+	_curveBounds.push_back(curve.GetBounds());
+	// The added curves are tested one by one, so rebuild once they are a noticeable share of all curves. That keeps the
+	// cost of the rebuilds at a constant number of steps per added curve (times the log of the number of curves).
+	int indexed = GetIndexedCount();
+	if (GetCurveCount() - indexed > std::max(MAX_LEAF_SIZE, indexed / 8))
+		Rebuild();
+}
+
+void CurveBvh::Update(int index, const CubicBezier& curve)
+{
+	if (index < 0 || index >= GetCurveCount())
+		throw std::out_of_range("index out of range");
+	_curveBounds[index] = curve.GetBounds();
+	if (index >= GetIndexedCount())
+		return;
+	// Refit the leaf and its ancestors, stopping once a box doesn't change
+	int nodeIndex = _leaves[index];
+	Node& leaf = _nodes[nodeIndex];
+	BoundingBox bounds;
+	for (int i = leaf.first; i < leaf.first + leaf.count; i++)
+		bounds.Include(_curveBounds[_indices[i]]);
+	leaf.bounds = bounds;
+	for (int parent = _parents[nodeIndex]; parent >= 0; parent = _parents[parent])
+	{
+		Node& node = _nodes[parent];
+		bounds = _nodes[parent + 1].bounds;
+		bounds.Include(_nodes[node.first].bounds);
+		if (bounds.min == node.bounds.min && bounds.max == node.bounds.max)
+			break;
+		node.bounds = bounds;
+	}
+}
+
+void CurveBvh::Clear()
+{
+	_nodes.clear();
+	_parents.clear();
+	_indices.clear();
+	_curveBounds.clear();
+	_leaves.clear();
+}
+
+int CurveBvh::GetCurveCount() const { return static_cast<int>(_curveBounds.size()); }
+
+int CurveBvh::GetIndexedCount() const { return static_cast<int>(_indices.size()); }
+
+BoundingBox CurveBvh::GetBounds() const
+{
+	BoundingBox bounds = _nodes.empty() ? BoundingBox {} : _nodes.front().bounds;
+	for (int i = GetIndexedCount(); i < GetCurveCount(); i++)
+		bounds.Include(_curveBounds[i]);
+	return bounds;
+}
+
+const BoundingBox& CurveBvh::GetCurveBounds(int index) const
+{
+	if (index < 0 || index >= GetCurveCount())
+		throw std::out_of_range("index out of range");
+	return _curveBounds[index];
+}
+
+void CurveBvh::Query(const BoundingBox& box, std::pmr::vector<int>& out) const
+{
+	out.clear();
+	if (!_nodes.empty())
+	{
+		std::array<int, MAX_STACK_SIZE> stack;
+		int size = 0;
+		stack[size++] = 0;
+		while (size > 0)
+		{
+			int nodeIndex = stack[--size];
+			const Node& node = _nodes[nodeIndex];
+			if (!node.bounds.Intersects(box))
+				continue;
+			if (node.count == 0)
+			{
+				stack[size++] = node.first;
+				stack[size++] = nodeIndex + 1;
+				continue;
+			}
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				if (_curveBounds[_indices[i]].Intersects(box))
+					out.push_back(_indices[i]);
+			}
+		}
+	}
+	for (int i = GetIndexedCount(); i < GetCurveCount(); i++)
+	{
+		if (_curveBounds[i].Intersects(box))
+			out.push_back(i);
+	}
+}
+
+void CurveBvh::Search(std::span<const CubicBezier> curves, const VECTOR& p, Projection& best) const
+{
+	FLOAT bestDistSq = best.distance * best.distance;
+	for (int i = GetIndexedCount(); i < GetCurveCount(); i++)
+	{
+		if (_curveBounds[i].GetDistanceSquared(p) >= bestDistSq)
+			continue;
+		FLOAT t;
+		FLOAT distance = curves[i].Project(p, t);
+		if (distance < best.distance)
+		{
+			best = { i, t, distance };
+			bestDistSq = distance * distance;
+		}
+	}
+	if (_nodes.empty())
+		return;
+	std::array<StackEntry, MAX_STACK_SIZE> stack;
+	int size = 0;
+	stack[size++] = { 0, _nodes.front().bounds.GetDistanceSquared(p) };
+	while (size > 0)
+	{
+		StackEntry entry = stack[--size];
+		// best may have improved since the node was pushed
+		if (entry.distSq >= bestDistSq)
+			continue;
+		const Node& node = _nodes[entry.node];
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				int index = _indices[i];
+				if (_curveBounds[index].GetDistanceSquared(p) >= bestDistSq)
+					continue;
+				FLOAT t;
+				FLOAT distance = curves[index].Project(p, t);
+				if (distance < best.distance)
+				{
+					best = { index, t, distance };
+					bestDistSq = distance * distance;
+				}
+			}
+			continue;
+		}
+		// Push the nearer child last so it is visited first
+		StackEntry nearChild { entry.node + 1, _nodes[entry.node + 1].bounds.GetDistanceSquared(p) };
+		StackEntry farChild { node.first, _nodes[node.first].bounds.GetDistanceSquared(p) };
+		if (farChild.distSq < nearChild.distSq)
+			std::swap(nearChild, farChild);
+		if (farChild.distSq < bestDistSq)
+			stack[size++] = farChild;
+		if (nearChild.distSq < bestDistSq)
+			stack[size++] = nearChild;
+	}
+}
+
+CurveBvh::Projection CurveBvh::Project(std::span<const CubicBezier> curves, const VECTOR& p, FLOAT maxDistance) const
+{
+	if (curves.size() != _curveBounds.size())
+		throw std::invalid_argument("curves must be the ones the hierarchy was built from");
+	Projection best;
+	best.distance = maxDistance;
+	Search(curves, p, best);
+	return best;
+}
+
+void CurveBvh::ProjectMany(std::span<const CubicBezier> curves, std::span<const VECTOR> points, std::span<Projection> out, FLOAT maxDistance) const
+{
+	if (curves.size() != _curveBounds.size())
+		throw std::invalid_argument("curves must be the ones the hierarchy was built from");
+	if (out.size() < points.size())
+		throw std::out_of_range("out is smaller than points");
+	int previous = -1;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		Projection best;
+		best.distance = maxDistance;
+		if (previous >= 0)
+		{
+			FLOAT t;
+			FLOAT distance = curves[previous].Project(points[i], t);
+			if (distance < maxDistance)
+				best = { previous, t, distance };
+		}
+		Search(curves, points[i], best);
+		out[i] = best;
+		previous = best.curve;
+	}
+}
@@ -22,51 +22,50 @@ module;
 module bezierfit;
 
 import :curve_fit;
+import :fit_context;
 import :curve_preprocess;
+import :preprocess_pipeline;
+import :thread_pool;
 
 using namespace bezierfit;
 
 std::vector<VECTOR> bezierfit::reduce(std::vector<VECTOR> points, FLOAT error)
 {
-	return CurvePreprocess::RdpReduce(points, error);
+	auto reduced = CurvePreprocess::RdpReduce(points, error);
+	return { reduced.begin(), reduced.end() };
+}
+
+std::vector<VECTOR> bezierfit::reduce(std::span<const VECTOR> points, const FitOptions& options)
+{
+	std::pmr::vector<VECTOR> reduced;
+	PreprocessPipeline{ options }.Run(points, reduced);
+	return { reduced.begin(), reduced.end() };
 }
 
 std::pair<VECTOR, VECTOR> bezierfit::calc_four_point_cubic_bezier(const VECTOR& p0, const VECTOR& p1, const VECTOR& p2, const VECTOR& p3)
 {
 	// See https://apoorvaj.io/cubic-bezier-through-four-points/
-	constexpr auto alpha = 0.5f;
-	auto d1 = powf(glm::distance(p1, p0), alpha);
-	auto d2 = powf(glm::distance(p2, p1), alpha);
-	auto d3 = powf(glm::distance(p3, p2), alpha);
+	constexpr FLOAT alpha = 0.5f;
+	FLOAT d1 = std::pow(glm::distance(p1, p0), alpha);
+	FLOAT d2 = std::pow(glm::distance(p2, p1), alpha);
+	FLOAT d3 = std::pow(glm::distance(p3, p2), alpha);
 
 	auto a = d1 * d1;
 	auto b = d2 * d2;
 	auto c = (2.f * d1 * d1) + (3 * d1 * d2) + (d2 * d2);
 	auto d = 3.f * d1 * (d1 + d2);
-	VECTOR t1{
-		(a * p2.x - b * p0.x + c * p1.x) / d,
-		(a * p2.y - b * p0.y + c * p1.y) / d
-	};
+	VECTOR t1 = (a * p2 - b * p0 + c * p1) / d;
 
 	a = d3 * d3;
 	b = d2 * d2;
 	c = (2 * d3 * d3) + (3 * d3 * d2) + (d2 * d2);
 	d = 3 * d3 * (d3 + d2);
-	auto t2 = VECTOR{
-		(a * p1.x - b * p3.x + c * p2.x) / d,
-		(a * p1.y - b * p3.y + c * p2.y) / d
-	};
+	VECTOR t2 = (a * p1 - b * p3 + c * p2) / d;
 	return { t1, t2 };
 }
 
-std::vector<std::array<VECTOR, 4>> bezierfit::fit(std::vector<VECTOR> data, FLOAT maxError)
+static std::vector<std::array<VECTOR, 4>> to_arrays(std::span<const CubicBezier> bezierCurves)
 {
-	if (data.empty())
-		return {};
-	auto reduced = CurvePreprocess::RdpReduce(data, 0.03f);
-
-	CurveFit curveFit{};
-	auto bezierCurves = curveFit.Fit(reduced, maxError);
 	std::vector<std::array<VECTOR, 4>> result;
 	result.resize(bezierCurves.size());
 	for (int i = 0; i < bezierCurves.size(); ++i)
@@ -77,92 +76,272 @@ std::vector<std::array<VECTOR, 4>> bezierfit::fit(std::vector<VECTOR> data, FLOA
 	return result;
 }
 
-bool CurveFitBase::FitCurve(int first, int last, VECTOR tanL, VECTOR tanR, CubicBezier& curve, int& split)
+std::vector<std::array<VECTOR, 4>> bezierfit::fit(std::vector<VECTOR> data, FLOAT maxError)
 {
-	int nPts = last - first + 1;
-	if (nPts < 2)
-	{
-		throw std::invalid_argument("INTERNAL ERROR: Should always have at least 2 points here");
-	}
-	else if (nPts == 2)
-	{
-		// if we only have 2 points left, estimate the curve using Wu/Barsky
-		VECTOR p0 = _pts[first];
-		VECTOR p3 = _pts[last];
-		float alpha = glm::distance(p0, p3) / 3;
-		VECTOR p1 = (tanL * alpha) + p0;
-		VECTOR p2 = (tanR * alpha) + p3;
-		curve = CubicBezier(p0, p1, p2, p3);
-		split = 0;
-		return true;
-	}
-	else
-	{
-		split = 0;
-		ArcLengthParamaterize(first, last); // initially start u with a simple chord-length paramaterization
-		for (int i = 0; i < MAX_ITERS + 1; i++)
-		{
-			if (i != 0)
-				Reparameterize(first, last, curve); // use Newton's method to find better parameters (except on the first run, since we don't have a curve yet)
-			curve = GenerateBezier(first, last, tanL, tanR); // generate the curve itself
-			float error = FindMaxSquaredError(first, last, curve, split); // calculate error and get split point (point of max error)
-			if (error < _squaredError)
-				return true; // if we're within error tolerance, awesome!
-		}
-		return false;
-	}
+	return fit(std::span<const VECTOR> { data }, FitOptions { maxError });
+}
+
+std::vector<std::array<VECTOR, 4>> bezierfit::fit(std::span<const VECTOR> data, const FitOptions& options)
+{
+	if (data.empty())
+		return {};
+	std::pmr::vector<VECTOR> reduced;
+	PreprocessPipeline{ options }.Run(data, reduced);
+
+	FitContext context{};
+	return to_arrays(context.Fit(reduced, options.maxError));
+}
+
+std::vector<std::array<VECTOR, 4>> bezierfit::fit_parallel(std::vector<VECTOR> data, FLOAT maxError, int parallelThreshold, unsigned int threadCount)
+{
+	return fit_parallel(std::span<const VECTOR> { data }, FitOptions { maxError }, parallelThreshold, threadCount);
+}
+
+std::vector<std::array<VECTOR, 4>> bezierfit::fit_parallel(std::span<const VECTOR> data, const FitOptions& options, int parallelThreshold, unsigned int threadCount)
+{
+	if (data.empty())
+		return {};
+	std::pmr::vector<VECTOR> reduced;
+	PreprocessPipeline{ options }.Run(data, reduced);
+
+	CurveFit curveFit{};
+	return to_arrays(curveFit.FitParallel(reduced, options.maxError, parallelThreshold, threadCount));
 }
 
 // Initialize the static member variable NO_CURVES.
-const std::vector<CubicBezier> CurveFit::NO_CURVES;
+template<typename T, int N>
+const std::vector<BasicCubicBezier<T, N>> BasicCurveFit<T, N>::NO_CURVES;
 
-std::vector< CubicBezier> CurveFit::Fit(std::vector<VECTOR> points, FLOAT maxError)
+template<typename T, int N>
+BasicCurveFit<T, N>::BasicCurveFit(std::pmr::memory_resource* resource)
+	: Base(resource), _result(resource)
+{
+}
+
+template<typename T, int N>
+void BasicCurveFit<T, N>::Initialize(std::span<const Vector> points, T maxError)
+{
+	_pts = points;
+	_soa = nullptr;
+	InitializeArcLengths();
+	_squaredError = maxError * maxError;
+}
+
+template<typename T, int N>
+void BasicCurveFit<T, N>::Initialize(const PointBuffer& points, T maxError)
+{
+	_pts = {};
+	_soa = &points;
+	InitializeArcLengths();
+	_squaredError = maxError * maxError;
+}
+
+template<typename T, int N>
+std::vector< BasicCubicBezier<T, N>> BasicCurveFit<T, N>::Fit(std::span<const Vector> points, T maxError)
 {
 	if (maxError < EPSILON)
 		throw std::invalid_argument("maxError cannot be negative/zero/less than epsilon value");
 	if (points.size() < 2)
 		return NO_CURVES; // need at least 2 points to do anything
 
-	CurveFit instance;
-	instance._pts = points;
-	instance.InitializeArcLengths();
-	instance._squaredError = maxError * maxError;
+	BasicCurveFit instance{ _result.get_allocator().resource() };
+	instance.CopySettings(*this);
+	instance.Initialize(points, maxError);
 
 	// Find tangents at ends
-	int last = points.size() - 1;
-	VECTOR tanL = instance.GetLeftTangent(last);
-	VECTOR tanR = instance.GetRightTangent(0);
+	int last = instance.GetPointCount() - 1;
+	Vector tanL = instance.GetLeftTangent(last);
+	Vector tanR = instance.GetRightTangent(0);
 
 	// do the actual fit
-	instance.FitRecursive(0, last, tanL, tanR);
-	return instance._result;
+	instance.FitRecursive(0, last, tanL, tanR, instance._u, instance._result, _stats);
+	return { instance._result.begin(), instance._result.end() };
+}
+
+template<typename T, int N>
+std::vector<BasicCubicBezier<T, N>> BasicCurveFit<T, N>::FitParallel(std::span<const Vector> points, T maxError, int parallelThreshold, unsigned int threadCount)
+{
+	if (maxError < EPSILON)
+		throw std::invalid_argument("maxError cannot be negative/zero/less than epsilon value");
+	if (parallelThreshold < 3)
+		throw std::invalid_argument("parallelThreshold must be at least 3");
+	if (points.size() < 2)
+		return NO_CURVES; // need at least 2 points to do anything
+
+	BasicCurveFit instance{ _result.get_allocator().resource() };
+	instance.CopySettings(*this);
+	instance.Initialize(points, maxError);
+
+	int last = instance.GetPointCount() - 1;
+	Vector tanL = instance.GetLeftTangent(last);
+	Vector tanR = instance.GetRightTangent(0);
+	instance.FitRecursiveParallel(0, last, tanL, tanR, parallelThreshold, threadCount);
+	_stats += instance._stats;
+	return { instance._result.begin(), instance._result.end() };
+}
+
+template<typename T, int N>
+void BasicCurveFit<T, N>::GetSplitTangents(int first, int last, int split, Vector& tanL, Vector& tanR, Vector& tanM1, Vector& tanM2)
+{
+	// first, get mid tangent
+	tanM1 = GetCenterTangent(first, last, split);
+	tanM2 = -tanM1;
+
+	// our end tangents might be based on points outside the new curve (this is possible for mid tangents too
+	// but since we need to maintain C1 continuity, it's too late to do anything about it)
+	if (first == 0 && split < _policy.endTangentPoints)
+		tanL = GetLeftTangent(split);
+	if (last == GetPointCount() - 1 && split > (GetPointCount() - (_policy.endTangentPoints + 1)))
+		tanR = GetRightTangent(split);
 }
 
-void CurveFit::FitRecursive(int first, int last, VECTOR tanL, VECTOR tanR)
+template<typename T, int N>
+void BasicCurveFit<T, N>::FitRecursive(int first, int last, Vector tanL, Vector tanR, std::pmr::vector<T>& u, std::pmr::vector<CubicBezier>& result, FitStats& stats)
 {
 	int split;
 	CubicBezier curve;
-	if (FitCurve(first, last, tanL, tanR, curve, split))
+	if (FitCurve(first, last, tanL, tanR, curve, split, u, stats))
 	{
-		_result.push_back(curve);
+		result.push_back(curve);
 	}
 	else
 	{
 		// If we get here, fitting failed, so we need to recurse
-		// first, get mid tangent
-		VECTOR tanM1 = GetCenterTangent(first, last, split);
-		VECTOR tanM2 = -tanM1;
-
-		// our end tangents might be based on points outside the new curve (this is possible for mid tangents too
-		// but since we need to maintain C1 continuity, it's too late to do anything about it)
-		if (first == 0 && split < END_TANGENT_N_PTS)
-			tanL = GetLeftTangent(split);
-		if (last == _pts.size() - 1 && split > (_pts.size() - (END_TANGENT_N_PTS + 1)))
-			tanR = GetRightTangent(split);
+		Vector tanM1, tanM2;
+		GetSplitTangents(first, last, split, tanL, tanR, tanM1, tanM2);
 
 		// do actual recursion
-		FitRecursive(first, split, tanL, tanM1);
-		FitRecursive(split, last, tanM2, tanR);
+		FitRecursive(first, split, tanL, tanM1, u, result, stats);
+		FitRecursive(split, last, tanM2, tanR, u, result, stats);
+	}
+}
+
+template<typename T, int N>
+void BasicCurveFit<T, N>::FitRecursiveParallel(int first, int last, Vector tanL, Vector tanR, int parallelThreshold, unsigned int threadCount)
+{
+	// A range still waiting to be fitted. Ranges never overlap (apart from their shared end points),
+	// so every range can be fitted independently and the results can be put back in order by their first index.
+	struct Task
+	{
+		int first;
+		int last;
+		Vector tanL;
+		Vector tanR;
+	};
+	struct Fitted
+	{
+		int first;
+		unsigned int worker;
+		size_t begin;
+		size_t count;
+	};
+	// The resource of this instance may not be thread-safe, so the workers allocate from their own pools
+	struct WorkerState
+	{
+		std::pmr::unsynchronized_pool_resource pool;
+		std::pmr::vector<T> u{ &pool };
+		std::pmr::vector<CubicBezier> curves{ &pool };
+		std::vector<Fitted> fitted;
+		FitStats stats;
+	};
+
+	auto& pool = ThreadPool::GetShared();
+	unsigned int numThreads = threadCount == 0 ? pool.GetThreadCount() : std::min(threadCount, pool.GetThreadCount());
+	std::vector<WorkerState> workers(numThreads);
+	std::vector<Task> tasks{ Task{first, last, tanL, tanR} };
+	int pending = 1; // tasks that are either queued or being processed
+	// Set by the first task that throws; the other workers stop taking tasks and the exception is rethrown after the run
+	std::exception_ptr error;
+	bool aborted = false;
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	pool.Run([&](unsigned int workerIndex) {
+		auto& state = workers[workerIndex];
+		for (;;)
+		{
+			Task task;
+			{
+				std::unique_lock lock{ mutex };
+				cv.wait(lock, [&]() { return !tasks.empty() || pending == 0 || aborted; });
+				if (aborted || tasks.empty())
+					return;
+				task = tasks.back();
+				tasks.pop_back();
+			}
+
+			Task children[2];
+			int numChildren = 0;
+			try
+			{
+				size_t begin = state.curves.size();
+				if (task.last - task.first + 1 < parallelThreshold)
+					FitRecursive(task.first, task.last, task.tanL, task.tanR, state.u, state.curves, state.stats);
+				else
+				{
+					int split;
+					CubicBezier curve;
+					if (FitCurve(task.first, task.last, task.tanL, task.tanR, curve, split, state.u, state.stats))
+						state.curves.push_back(curve);
+					else
+					{
+						Vector tanM1, tanM2;
+						GetSplitTangents(task.first, task.last, split, task.tanL, task.tanR, tanM1, tanM2);
+						children[numChildren++] = Task{ task.first, split, task.tanL, tanM1 };
+						children[numChildren++] = Task{ split, task.last, tanM2, task.tanR };
+					}
+				}
+				if (state.curves.size() > begin)
+					state.fitted.push_back(Fitted{ task.first, workerIndex, begin, state.curves.size() - begin });
+
+				bool notify;
+				{
+					std::scoped_lock lock{ mutex };
+					for (int i = 0; i < numChildren; i++)
+						tasks.push_back(children[i]);
+					pending += numChildren - 1;
+					notify = numChildren > 0 || pending == 0;
+				}
+				if (notify)
+					cv.notify_all();
+			}
+			catch (...)
+			{
+				{
+					std::scoped_lock lock{ mutex };
+					if (!error)
+						error = std::current_exception();
+					aborted = true;
+					--pending;
+				}
+				cv.notify_all();
+				return;
+			}
+		}
+	}, numThreads);
+	if (error)
+		std::rethrow_exception(error);
+
+	// Stitch the results back together in the same order the serial recursion would have produced them
+	std::vector<Fitted> fitted;
+	for (auto& state : workers)
+	{
+		fitted.insert(fitted.end(), state.fitted.begin(), state.fitted.end());
+		_stats += state.stats;
+	}
+	std::sort(fitted.begin(), fitted.end(), [](const Fitted& a, const Fitted& b) { return a.first < b.first; });
+	_result.clear();
+	for (auto& f : fitted)
+	{
+		auto& curves = workers[f.worker].curves;
+		_result.insert(_result.end(), curves.begin() + f.begin, curves.begin() + f.begin + f.count);
 	}
 }
 
+template class bezierfit::BasicCurveFit<float, 2>;
+template class bezierfit::BasicCurveFit<float, 3>;
+template class bezierfit::BasicCurveFit<double, 2>;
+template class bezierfit::BasicCurveFit<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicCurveFit<FLOAT, 4>;
+#endif
@@ -22,23 +22,93 @@ module;
 module bezierfit;
 
 import :curve_fit;
+import :fit_kernels;
 
 using namespace bezierfit;
 
-VECTOR CurveFitBase::GetLeftTangent(int last)
+namespace {
+	// Component arrays of the points starting at first
+	template<typename T, int N>
+	typename BasicFitKernels<T, N>::ComponentArrays get_components(const BasicPointBuffer<T, N>& points, int first)
+	{
+		typename BasicFitKernels<T, N>::ComponentArrays components;
+		for (int c = 0; c < N; c++)
+			components[c] = points.Component(c) + first;
+		return components;
+	}
+}
+
+FitStats& FitStats::operator+=(const FitStats& other)
+{
+	segments += other.segments;
+	iterations += other.iterations;
+	iterationsSaved += other.iterationsSaved;
+	errorSplits += other.errorSplits;
+	stagnationSplits += other.stagnationSplits;
+	return *this;
+}
+
+template<typename T, int N>
+BasicCurveFitBase<T, N>::BasicCurveFitBase(std::pmr::memory_resource* resource)
+	: _arclen(resource), _u(resource), _squaredError(0)
+{
+}
+
+template<typename T, int N>
+typename BasicCurveFitBase<T, N>::IterationMode BasicCurveFitBase<T, N>::GetIterationMode() const { return _iterationMode; }
+
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::SetIterationMode(IterationMode mode) { _iterationMode = mode; }
+
+template<typename T, int N>
+const FitPolicy& BasicCurveFitBase<T, N>::GetPolicy() const { return _policy; }
+
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::SetPolicy(const FitPolicy& policy)
+{
+	if (policy.maxIterations < 0)
+		throw std::invalid_argument("maxIterations cannot be negative");
+	if (policy.stagnationThreshold < 0 || policy.splitErrorFactor < 0)
+		throw std::invalid_argument("stagnationThreshold and splitErrorFactor cannot be negative");
+	if (policy.endTangentPoints < 1 || policy.midTangentPoints < 1)
+		throw std::invalid_argument("endTangentPoints and midTangentPoints must be at least 1");
+	_policy = policy;
+}
+
+template<typename T, int N>
+const FitStats& BasicCurveFitBase<T, N>::GetStats() const { return _stats; }
+
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::ResetStats() { _stats = {}; }
+
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::CopySettings(const BasicCurveFitBase& other)
+{
+	_iterationMode = other._iterationMode;
+	_policy = other._policy;
+}
+
+template<typename T, int N>
+glm::vec<N, T> BasicCurveFitBase<T, N>::GetPoint(int i) const { return _soa ? (*_soa)[i] : _pts[i]; }
+
+template<typename T, int N>
+size_t BasicCurveFitBase<T, N>::GetPointCount() const { return _soa ? _soa->Size() : _pts.size(); }
+
+template<typename T, int N>
+glm::vec<N, T> BasicCurveFitBase<T, N>::GetLeftTangent(int last)
 {
-	int count = _pts.size();
-	FLOAT totalLen = _arclen[count - 1];
-	VECTOR p0 = _pts[0];
-	VECTOR tanL = glm::normalize(_pts[1] - p0);
-	VECTOR total = tanL;
-	FLOAT weightTotal = 1;
-	last = std::min(END_TANGENT_N_PTS, last - 1);
+	int count = GetPointCount();
+	T totalLen = _arclen[count - 1];
+	Vector p0 = GetPoint(0);
+	Vector tanL = glm::normalize(GetPoint(1) - p0);
+	Vector total = tanL;
+	T weightTotal = 1;
+	last = std::min(_policy.endTangentPoints, last - 1);
 	for (int i = 2; i <= last; i++)
 	{
-		FLOAT ti = 1 - (_arclen[i] / totalLen);
-		FLOAT weight = ti * ti * ti;
-		VECTOR v = glm::normalize(_pts[i] - p0);
+		T ti = 1 - (_arclen[i] / totalLen);
+		T weight = ti * ti * ti;
+		Vector v = glm::normalize(GetPoint(i) - p0);
 		total += v * weight;
 		weightTotal += weight;
 	}
@@ -47,20 +117,21 @@ VECTOR CurveFitBase::GetLeftTangent(int last)
 	return tanL;
 }
 
-VECTOR CurveFitBase::GetRightTangent(int first)
+template<typename T, int N>
+glm::vec<N, T> BasicCurveFitBase<T, N>::GetRightTangent(int first)
 {
-	int count = _pts.size();
-	FLOAT totalLen = _arclen[count - 1];
-	VECTOR p3 = _pts[count - 1];
-	VECTOR tanR = glm::normalize(_pts[count - 2] - p3);
-	VECTOR total = tanR;
-	FLOAT weightTotal = 1;
-	first = std::max(count - (END_TANGENT_N_PTS + 1), first + 1);
+	int count = GetPointCount();
+	T totalLen = _arclen[count - 1];
+	Vector p3 = GetPoint(count - 1);
+	Vector tanR = glm::normalize(GetPoint(count - 2) - p3);
+	Vector total = tanR;
+	T weightTotal = 1;
+	first = std::max(count - (_policy.endTangentPoints + 1), first + 1);
 	for (int i = count - 3; i >= first; i--)
 	{
-		FLOAT t = _arclen[i] / totalLen;
-		FLOAT weight = t * t * t;
-		VECTOR v = glm::normalize(_pts[i] - p3);
+		T t = _arclen[i] / totalLen;
+		T weight = t * t * t;
+		Vector v = glm::normalize(GetPoint(i) - p3);
 		total += v * weight;
 		weightTotal += weight;
 	}
@@ -69,147 +140,135 @@ VECTOR CurveFitBase::GetRightTangent(int first)
 	return tanR;
 }
 
-VECTOR CurveFitBase::GetCenterTangent(int first, int last, int split)
+template<typename T, int N>
+glm::vec<N, T> BasicCurveFitBase<T, N>::GetCenterTangent(int first, int last, int split)
 {
-	int count = _pts.size();
-	FLOAT splitLen = _arclen[split];
-	VECTOR pSplit = _pts[split];
+	int count = GetPointCount();
+	T splitLen = _arclen[split];
+	Vector pSplit = GetPoint(split);
 
 	// left side
-	FLOAT firstLen = _arclen[first];
-	FLOAT partLen = splitLen - firstLen;
-	VECTOR total = VECTOR(0);
-	FLOAT weightTotal = 0;
-	for (int i = std::max(first, split - MID_TANGENT_N_PTS); i < split; i++)
+	T firstLen = _arclen[first];
+	T partLen = splitLen - firstLen;
+	Vector total = Vector(0);
+	T weightTotal = 0;
+	for (int i = std::max(first, split - _policy.midTangentPoints); i < split; i++)
 	{
-		FLOAT t = (_arclen[i] - firstLen) / partLen;
-		FLOAT weight = t * t * t;
-		VECTOR v = glm::normalize(_pts[i] - pSplit);
+		T t = (_arclen[i] - firstLen) / partLen;
+		T weight = t * t * t;
+		Vector v = glm::normalize(GetPoint(i) - pSplit);
 		total += v * weight;
 		weightTotal += weight;
 	}
-	VECTOR tanL = glm::length(total) > EPSILON && weightTotal > EPSILON ?
+	Vector tanL = glm::length(total) > EPSILON && weightTotal > EPSILON ?
 		glm::normalize(total / weightTotal) :
-		glm::normalize(_pts[split - 1] - pSplit);
+		glm::normalize(GetPoint(split - 1) - pSplit);
 
 	// right side
 	partLen = _arclen[last] - splitLen;
-	int rMax = std::min(last, split + MID_TANGENT_N_PTS);
-	total = VECTOR(0);
+	int rMax = std::min(last, split + _policy.midTangentPoints);
+	total = Vector(0);
 	weightTotal = 0;
 	for (int i = split + 1; i <= rMax; i++)
 	{
-		FLOAT ti = 1 - ((_arclen[i] - splitLen) / partLen);
-		FLOAT weight = ti * ti * ti;
-		VECTOR v = glm::normalize(pSplit - _pts[i]);
+		T ti = 1 - ((_arclen[i] - splitLen) / partLen);
+		T weight = ti * ti * ti;
+		Vector v = glm::normalize(pSplit - GetPoint(i));
 		total += v * weight;
 		weightTotal += weight;
 	}
-	VECTOR tanR = glm::length(total) > EPSILON && weightTotal > EPSILON ?
+	Vector tanR = glm::length(total) > EPSILON && weightTotal > EPSILON ?
 		glm::normalize(total / weightTotal) :
-		glm::normalize(pSplit - _pts[split + 1]);
+		glm::normalize(pSplit - GetPoint(split + 1));
 
 	total = tanL + tanR;
 
 	if (glm::gtx::length2(total) < EPSILON)
 	{
-		tanL = glm::normalize(_pts[split - 1] - pSplit);
-		tanR = glm::normalize(pSplit - _pts[split + 1]);
+		tanL = glm::normalize(GetPoint(split - 1) - pSplit);
+		tanR = glm::normalize(pSplit - GetPoint(split + 1));
 		total = tanL + tanR;
-		return glm::gtx::length2(total) < EPSILON ? tanL : glm::normalize(total / 2.0f);
+		return glm::gtx::length2(total) < EPSILON ? tanL : glm::normalize(total / T(2));
 	}
 	else
 	{
-		return glm::normalize(total / 2.0f);
+		return glm::normalize(total / T(2));
 	}
 }
 
-void CurveFitBase::InitializeArcLengths()
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::InitializeArcLengths()
 {
-	int count = _pts.size();
+	int count = GetPointCount();
 	_arclen.clear();
 	_arclen.push_back(0);
-	FLOAT clen = 0;
-	VECTOR pp = _pts[0];
+	T clen = 0;
+	Vector pp = GetPoint(0);
 	for (int i = 1; i < count; i++)
 	{
-		VECTOR np = _pts[i];
+		Vector np = GetPoint(i);
 		clen += glm::distance(pp, np);
 		_arclen.push_back(clen);
 		pp = np;
 	}
 }
 
-void CurveFitBase::ArcLengthParamaterize(int first, int last)
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::ArcLengthParamaterize(int first, int last, std::pmr::vector<T>& u)
 {
-	int count = _pts.size();
-	_u.clear();
-	FLOAT diff = _arclen[last] - _arclen[first];
-	FLOAT start = _arclen[first];
+	int count = GetPointCount();
+	u.clear();
+	T diff = _arclen[last] - _arclen[first];
+	T start = _arclen[first];
 	int nPts = last - first;
-	_u.push_back(0);
+	u.push_back(0);
 	for (int i = 1; i < nPts; i++)
-		_u.push_back((_arclen[first + i] - start) / diff);
-	_u.push_back(1);
+		u.push_back((_arclen[first + i] - start) / diff);
+	u.push_back(1);
 }
 
 /// <summary>
  /// Generates a bezier curve for the segment using a least-squares approximation.
  /// </summary>
-CubicBezier CurveFitBase::GenerateBezier(int first, int last, VECTOR tanL, VECTOR tanR)
+template<typename T, int N>
+BasicCubicBezier<T, N> BasicCurveFitBase<T, N>::GenerateBezier(int first, int last, Vector tanL, Vector tanR, const std::pmr::vector<T>& u)
 {
-	std::vector<VECTOR>& pts = _pts;
-	std::vector<FLOAT>& u = _u;
 	int nPts = last - first + 1;
-	VECTOR p0 = pts[first], p3 = pts[last]; // first and last points of curve are actual points on data
-	FLOAT c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0; // matrix members -- both C[0,1] and C[1,0] are the same, stored in c01
-	for (int i = 1; i < nPts; i++)
-	{
-		// Calculate cubic bezier multipliers
-		FLOAT t = u[i];
-		FLOAT ti = 1 - t;
-		FLOAT t0 = ti * ti * ti;
-		FLOAT t1 = 3 * ti * ti * t;
-		FLOAT t2 = 3 * ti * t * t;
-		FLOAT t3 = t * t * t;
-
-		// For X matrix; moving this up here since profiling shows it's better up here (maybe a0/a1 not in registers vs only v not in regs)
-		VECTOR s = (p0 * t0) + (p0 * t1) + (p3 * t2) + (p3 * t3); // NOTE: this would be Q(t) if p1=p0 and p2=p3
-		VECTOR v = pts[first + i] - s;
-
-		// C matrix
-		VECTOR a0 = tanL * t1;
-		VECTOR a1 = tanR * t2;
-		c00 += VectorHelper::Dot(a0, a0);
-		c01 += VectorHelper::Dot(a0, a1);
-		c11 += VectorHelper::Dot(a1, a1);
-
-		// X matrix
-		x0 += VectorHelper::Dot(a0, v);
-		x1 += VectorHelper::Dot(a1, v);
-	}
+	Vector p0 = GetPoint(first), p3 = GetPoint(last); // first and last points of curve are actual points on data
+	auto sums = _soa ?
+		Kernels::AccumulateLeastSquares(get_components(*_soa, first + 1), u.data() + 1, nPts - 1, p0, p3, tanL, tanR) :
+		Kernels::AccumulateLeastSquares(_pts.data() + first + 1, u.data() + 1, nPts - 1, p0, p3, tanL, tanR);
+	return GenerateBezier(first, last, tanL, tanR, sums);
+}
+
+template<typename T, int N>
+BasicCubicBezier<T, N> BasicCurveFitBase<T, N>::GenerateBezier(int first, int last, Vector tanL, Vector tanR, const LeastSquaresSums& sums)
+{
+	Vector p0 = GetPoint(first), p3 = GetPoint(last);
+	// matrix members -- both C[0,1] and C[1,0] are the same, stored in c01
+	auto [c00, c01, c11, x0, x1] = sums;
 
 	// determinants of X and C matrices
-	FLOAT det_C0_C1 = c00 * c11 - c01 * c01;
-	FLOAT det_C0_X = c00 * x1 - c01 * x0;
-	FLOAT det_X_C1 = x0 * c11 - x1 * c01;
-	FLOAT alphaL = det_X_C1 / det_C0_C1;
-	FLOAT alphaR = det_C0_X / det_C0_C1;
+	T det_C0_C1 = c00 * c11 - c01 * c01;
+	T det_C0_X = c00 * x1 - c01 * x0;
+	T det_X_C1 = x0 * c11 - x1 * c01;
+	T alphaL = det_X_C1 / det_C0_C1;
+	T alphaR = det_C0_X / det_C0_C1;
 
 	// if alpha is negative, zero, or very small (or we can't trust it since C matrix is small), fall back to Wu/Barsky heuristic
-	FLOAT linDist = VectorHelper::Distance(p0, p3);
-	FLOAT epsilon2 = EPSILON * linDist;
+	T linDist = BasicVectorHelper<T, N>::Distance(p0, p3);
+	T epsilon2 = EPSILON * linDist;
 	if (std::abs(det_C0_C1) < EPSILON || alphaL < epsilon2 || alphaR < epsilon2)
 	{
-		FLOAT alpha = linDist / 3;
-		VECTOR p1 = (tanL * alpha) + p0;
-		VECTOR p2 = (tanR * alpha) + p3;
+		T alpha = linDist / 3;
+		Vector p1 = (tanL * alpha) + p0;
+		Vector p2 = (tanR * alpha) + p3;
 		return CubicBezier(p0, p1, p2, p3);
 	}
 	else
 	{
-		VECTOR p1 = (tanL * alphaL) + p0;
-		VECTOR p2 = (tanR * alphaR) + p3;
+		Vector p1 = (tanL * alphaL) + p0;
+		Vector p2 = (tanR * alphaR) + p3;
 		return CubicBezier(p0, p1, p2, p3);
 	}
 }
@@ -217,69 +276,150 @@ CubicBezier CurveFitBase::GenerateBezier(int first, int last, VECTOR tanL, VECTO
 /// <summary>
  /// Attempts to find a slightly better parameterization for u on the given curve.
  /// </summary>
-void CurveFitBase::Reparameterize(int first, int last, CubicBezier curve)
+template<typename T, int N>
+void BasicCurveFitBase<T, N>::Reparameterize(int first, int last, CubicBezier curve, std::pmr::vector<T>& u)
 {
-	std::vector<VECTOR>& pts = _pts;
-	std::vector<FLOAT>& u = _u;
 	int nPts = last - first;
-	for (int i = 1; i < nPts; i++)
-	{
-		VECTOR p = pts[first + i];
-		FLOAT t = u[i];
-		FLOAT ti = 1 - t;
-
-		// Control vertices for Q'
-		VECTOR qp0 = (curve.p1 - curve.p0) * 3.f;
-		VECTOR qp1 = (curve.p2 - curve.p1) * 3.f;
-		VECTOR qp2 = (curve.p3 - curve.p2) * 3.f;
-
-		// Control vertices for Q''
-		VECTOR qpp0 = (qp1 - qp0) * 2.f;
-		VECTOR qpp1 = (qp2 - qp1) * 2.f;
-
-		// Evaluate Q(t), Q'(t), and Q''(t)
-		VECTOR p0 = curve.Sample(t);
-		VECTOR p1 = ((ti * ti) * qp0) + ((2 * ti * t) * qp1) + ((t * t) * qp2);
-		VECTOR p2 = (ti * qpp0) + (t * qpp1);
-
-		// these are the actual fitting calculations using http://en.wikipedia.org/wiki/Newton%27s_method
-		// We can't just use .X and .Y because Unity uses lower-case "x" and "y".
-		FLOAT num = ((VectorHelper::GetX(p0) - VectorHelper::GetX(p)) * VectorHelper::GetX(p1)) + ((VectorHelper::GetY(p0) - VectorHelper::GetY(p)) * VectorHelper::GetY(p1));
-		FLOAT den = (VectorHelper::GetX(p1) * VectorHelper::GetX(p1)) + (VectorHelper::GetY(p1) * VectorHelper::GetY(p1)) + ((VectorHelper::GetX(p0) - VectorHelper::GetX(p)) * VectorHelper::GetX(p2)) + ((VectorHelper::GetY(p0) - VectorHelper::GetY(p)) * VectorHelper::GetY(p2));
-		FLOAT newU = t - num / den;
-		if (std::abs(den) > EPSILON && newU >= 0 && newU <= 1)
-			u[i] = newU;
-	}
+	if (nPts <= 1)
+		return;
+	if (_soa)
+		Kernels::Reparameterize(get_components(*_soa, first + 1), u.data() + 1, nPts - 1, curve);
+	else
+		Kernels::Reparameterize(_pts.data() + first + 1, u.data() + 1, nPts - 1, curve);
 }
 
 /// <summary>
 /// Computes the maximum squared distance from a point to the curve using the current parameterization.
 /// </summary>
-FLOAT CurveFitBase::FindMaxSquaredError(int first, int last, CubicBezier curve, int& split)
+template<typename T, int N>
+T BasicCurveFitBase<T, N>::FindMaxSquaredError(int first, int last, CubicBezier curve, int& split, const std::pmr::vector<T>& u)
 {
-	std::vector<VECTOR>& pts = _pts;
-	std::vector<FLOAT>& u = _u;
-	int s = (last - first + 1) / 2;
 	int nPts = last - first + 1;
-	FLOAT max = 0;
-	for (int i = 1; i < nPts; i++)
+	int maxIndex = nPts / 2 - 1;
+	T max = _soa ?
+		Kernels::FindMaxSquaredError(get_components(*_soa, first + 1), u.data() + 1, nPts - 1, curve, maxIndex) :
+		Kernels::FindMaxSquaredError(_pts.data() + first + 1, u.data() + 1, nPts - 1, curve, maxIndex);
+	split = GetSplitPoint(first, last, maxIndex);
+	return max;
+}
+
+template<typename T, int N>
+T BasicCurveFitBase<T, N>::FusedIteration(int first, int last, Vector tanL, Vector tanR, CubicBezier curve, int& split, std::pmr::vector<T>& u, LeastSquaresSums& sums)
+{
+	// Only the interior points are visited. The last point has u = 1, so it lies exactly on the curve, keeps its parameter
+	// and contributes nothing to the least-squares sums.
+	int nPts = last - first + 1;
+	int maxIndex = nPts / 2 - 1;
+	T max = _soa ?
+		Kernels::FusedIteration(get_components(*_soa, first + 1), u.data() + 1, nPts - 2, curve, maxIndex, tanL, tanR, sums) :
+		Kernels::FusedIteration(_pts.data() + first + 1, u.data() + 1, nPts - 2, curve, maxIndex, tanL, tanR, sums);
+	split = GetSplitPoint(first, last, maxIndex);
+	return max;
+}
+
+template<typename T, int N>
+bool BasicCurveFitBase<T, N>::FitCurve(int first, int last, Vector tanL, Vector tanR, CubicBezier& curve, int& split, std::pmr::vector<T>& u, FitStats& stats)
+{
+	int nPts = last - first + 1;
+	if (nPts < 2)
 	{
-		VECTOR v0 = pts[first + i];
-		VECTOR v1 = curve.Sample(u[i]);
-		FLOAT d = VectorHelper::DistanceSquared(v0, v1);
-		if (d > max)
+		throw std::invalid_argument("INTERNAL ERROR: Should always have at least 2 points here");
+	}
+	else if (nPts == 2)
+	{
+		// if we only have 2 points left, estimate the curve using Wu/Barsky
+		Vector p0 = GetPoint(first);
+		Vector p3 = GetPoint(last);
+		T alpha = glm::distance(p0, p3) / 3;
+		Vector p1 = (tanL * alpha) + p0;
+		Vector p2 = (tanR * alpha) + p3;
+		curve = CubicBezier(p0, p1, p2, p3);
+		split = 0;
+		return true;
+	}
+	else
+	{
+		split = 0;
+		++stats.segments;
+		ArcLengthParamaterize(first, last, u); // initially start u with a simple chord-length paramaterization
+		T prevError = 0;
+		if (_iterationMode == IterationMode::Fused)
+		{
+			// Same iterations as below, but the error of each curve is measured in the same pass that reparameterizes u
+			// and accumulates the least-squares system for the next curve
+			curve = GenerateBezier(first, last, tanL, tanR, u);
+			for (int i = 0;; i++)
+			{
+				LeastSquaresSums sums;
+				bool reparameterized = i < _policy.maxIterations;
+				T error = reparameterized ?
+					FusedIteration(first, last, tanL, tanR, curve, split, u, sums) :
+					FindMaxSquaredError(first, last, curve, split, u); // no further iteration possible, only the error is needed
+				if (error < _squaredError)
+					return true;
+				if (!ContinueIterating(i, error, prevError, reparameterized, stats))
+					return false;
+				prevError = error;
+				curve = GenerateBezier(first, last, tanL, tanR, sums);
+			}
+		}
+		for (int i = 0;; i++)
 		{
-			max = d;
-			s = i;
+			if (i != 0)
+				Reparameterize(first, last, curve, u); // use Newton's method to find better parameters (except on the first run, since we don't have a curve yet)
+			curve = GenerateBezier(first, last, tanL, tanR, u); // generate the curve itself
+			T error = FindMaxSquaredError(first, last, curve, split, u); // calculate error and get split point (point of max error)
+			if (error < _squaredError)
+				return true; // if we're within error tolerance, awesome!
+			if (!ContinueIterating(i, error, prevError, false, stats))
+				return false;
+			prevError = error;
 		}
 	}
+}
 
+template<typename T, int N>
+bool BasicCurveFitBase<T, N>::ContinueIterating(int iteration, T error, T prevError, bool reparameterized, FitStats& stats) const
+{
+	int remaining = _policy.maxIterations - iteration;
+	if (remaining <= 0)
+		return false;
+	// Only the reparameterizations that are actually skipped count as saved, not one that has already been done
+	int skipped = reparameterized ? remaining - 1 : remaining;
+	if (_policy.splitErrorFactor > 0 && error > _squaredError * _policy.splitErrorFactor * _policy.splitErrorFactor)
+	{
+		// Too far off for a few reparameterizations to make a difference
+		++stats.errorSplits;
+		stats.iterationsSaved += skipped;
+		return false;
+	}
+	if (iteration > 0 && _policy.stagnationThreshold > 0 && prevError - error < prevError * _policy.stagnationThreshold)
+	{
+		// Not improving (or getting worse)
+		++stats.stagnationSplits;
+		stats.iterationsSaved += skipped;
+		return false;
+	}
+	++stats.iterations;
+	return true;
+}
+
+template<typename T, int N>
+int BasicCurveFitBase<T, N>::GetSplitPoint(int first, int last, int maxIndex)
+{
 	// split at the point of maximum error
-	split = s + first;
+	int split = maxIndex + 1 + first;
 	if (split <= first)
 		split = first + 1;
 	if (split >= last)
 		split = last - 1;
-
-	return max;
+	return split;
 }
+
+template class bezierfit::BasicCurveFitBase<float, 2>;
+template class bezierfit::BasicCurveFitBase<float, 3>;
+template class bezierfit::BasicCurveFitBase<double, 2>;
+template class bezierfit::BasicCurveFitBase<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicCurveFitBase<FLOAT, 4>;
+#endif
@@ -0,0 +1,211 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :curve_flattener;
+import :fit_kernels;
+
+using namespace bezierfit;
+
+namespace {
+	// Part of the tolerance used for approximating the cubic curve with quadratic ones, the rest is left for flattening those
+	constexpr FLOAT QUAD_TOLERANCE_SHARE = FLOAT(0.1);
+	// The error of approximating a cubic curve with a single quadratic one is at most sqrt(3) / 36 * |p3 - 3 * p2 + 3 * p1 - p0|
+	constexpr FLOAT QUAD_ERROR_FACTOR = FLOAT(0.048112522432468816);
+	// Quadratic curves whose control polygon spans less than this fraction of a parallelogram are treated as straight
+	constexpr FLOAT STRAIGHT_EPSILON = FLOAT(1e-6);
+	// Number of parameters that are evaluated with one call of the kernel
+	constexpr int SAMPLE_CHUNK_SIZE = 64;
+
+	// Approximations of the integral of the subdivision density of the parabola y = x^2 and of its inverse
+	FLOAT approx_parabola_integral(FLOAT x)
+	{
+		constexpr FLOAT D = FLOAT(0.67);
+		return x / (1 - D + std::sqrt(std::sqrt(D * D * D * D + FLOAT(0.25) * x * x)));
+	}
+
+	FLOAT approx_parabola_inv_integral(FLOAT x)
+	{
+		constexpr FLOAT B = FLOAT(0.39);
+		return x * (1 - B + std::sqrt(B * B + FLOAT(0.25) * x * x));
+	}
+
+	// Magnitude of the cross product, i.e. the area of the parallelogram spanned by a and b
+	FLOAT get_cross_length(const VECTOR& a, const VECTOR& b)
+	{
+		if constexpr (DIMENSION == 2)
+			return std::abs(a.x * b.y - a.y * b.x);
+		else
+		{
+			FLOAT dot = glm::dot(a, b);
+			return std::sqrt(std::max(FLOAT(0), glm::dot(a, a) * glm::dot(b, b) - dot * dot));
+		}
+	}
+}
+
+FLOAT CurveFlattener::QuadParams::GetParameter(FLOAT x) const
+{
+	if (uniform)
+		return x;
+	FLOAT u = approx_parabola_inv_integral(a0 + (a2 - a0) * x);
+	return (u - u0) * uScale;
+}
+
+CurveFlattener::CurveFlattener(FLOAT tolerance, std::pmr::memory_resource* resource)
+	: _tolerance(tolerance), _quads(resource)
+{
+	if (!(tolerance > 0))
+		throw std::invalid_argument("tolerance must be greater than 0");
+	_sqrtTolerance = std::sqrt(tolerance * (1 - QUAD_TOLERANCE_SHARE));
+}
+
+FLOAT CurveFlattener::GetTolerance() const { return _tolerance; }
+
+void CurveFlattener::EstimateQuads(const CubicBezier& curve)
+{
+	// The error of n quadratic curves shrinks with n^3
+	FLOAT error = glm::length(curve.p3 - curve.p0 + (curve.p1 - curve.p2) * FLOAT(3)) * QUAD_ERROR_FACTOR;
+	int count = std::max(1, static_cast<int>(std::ceil(std::cbrt(error / (_tolerance * QUAD_TOLERANCE_SHARE)))));
+	_quads.resize(count);
+
+	PowerBasis basis { curve };
+	FLOAT dt = FLOAT(1) / count;
+	VECTOR q0 = curve.p0;
+	VECTOR d0 = basis.c;
+	for (int i = 0; i < count; i++)
+	{
+		FLOAT t = (i + 1) * dt;
+		VECTOR q2 = i + 1 < count ? basis.Sample(t) : curve.p3;
+		VECTOR d2 = basis.Derivative(t);
+		// Quadratic curve through the ends of the part, with the control point that matches the cubic curve best
+		VECTOR q1 = (q0 + q2) * FLOAT(0.5) + (d0 - d2) * (dt * FLOAT(0.25));
+
+		QuadParams& quad = _quads[i];
+		VECTOR d01 = q1 - q0;
+		VECTOR d12 = q2 - q1;
+		VECTOR dd = d01 - d12;
+		VECTOR chord = q2 - q0;
+		FLOAT ddLengthSq = glm::dot(dd, dd);
+		FLOAT cross = get_cross_length(chord, dd);
+		if (!(cross * cross > STRAIGHT_EPSILON * STRAIGHT_EPSILON * glm::dot(chord, chord) * ddLengthSq))
+		{
+			// Even subdivision into n segments is within the tolerance for |dd| / (4 * n^2) <= tolerance
+			quad = { 0, 0, 0, 1, std::sqrt(std::sqrt(ddLengthSq)), true };
+		}
+		else
+		{
+			// Maps the quadratic curve to the part [x0 ... x2] of the parabola y = x^2 scaled by scale
+			FLOAT invCross = 1 / cross;
+			FLOAT x0 = glm::dot(d01, dd) * invCross;
+			FLOAT x2 = glm::dot(d12, dd) * invCross;
+			// |x2 - x0| = |dd|^2 / cross
+			FLOAT scale = cross * cross / (ddLengthSq * std::sqrt(ddLengthSq));
+			FLOAT a0 = approx_parabola_integral(x0);
+			FLOAT a2 = approx_parabola_integral(x2);
+			FLOAT sqrtScale = std::sqrt(scale);
+			FLOAT weight;
+			if ((x0 < 0) == (x2 < 0))
+				weight = std::abs(a2 - a0) * sqrtScale;
+			else
+			{
+				// The part contains the vertex of the parabola, whose density depends on the tolerance
+				FLOAT xMin = _sqrtTolerance / sqrtScale;
+				weight = _sqrtTolerance * std::abs(a2 - a0) / approx_parabola_integral(xMin);
+			}
+			FLOAT u0 = approx_parabola_inv_integral(a0);
+			FLOAT u2 = approx_parabola_inv_integral(a2);
+			quad = { a0, a2, u0, 1 / (u2 - u0), weight, false };
+		}
+		q0 = q2;
+		d0 = d2;
+	}
+}
+
+int CurveFlattener::GetSegmentCount(FLOAT weight) const
+{
+	return std::max(1, static_cast<int>(std::ceil(FLOAT(0.5) * weight / _sqrtTolerance)));
+}
+
+int CurveFlattener::GetSegmentCount(const CubicBezier& curve)
+{
+	EstimateQuads(curve);
+	int segments = 0;
+	for (auto& quad : _quads)
+		segments += GetSegmentCount(quad.weight);
+	return segments;
+}
+
+void CurveFlattener::AppendCurve(const CubicBezier& curve, std::pmr::vector<VECTOR>& dst)
+{
+	EstimateQuads(curve);
+	int quadCount = static_cast<int>(_quads.size());
+	FLOAT dt = FLOAT(1) / quadCount;
+	std::array<FLOAT, SAMPLE_CHUNK_SIZE> t;
+	int pending = 0;
+	auto flush = [&]() {
+		size_t start = dst.size();
+		dst.resize(start + pending);
+		BasicFitKernels<FLOAT, DIMENSION>::SampleCurve(curve, t.data(), pending, dst.data() + start);
+		pending = 0;
+	};
+	// Every quadratic curve is subdivided on its own, so each segment lies on one of them. Spreading the segments over
+	// all of them by their weights would save a few points, but the estimate doesn't hold for segments across their ends.
+	for (int i = 0; i < quadCount; i++)
+	{
+		const QuadParams& quad = _quads[i];
+		int segments = GetSegmentCount(quad.weight);
+		FLOAT step = FLOAT(1) / segments;
+		for (int j = 1; j < segments; j++)
+		{
+			t[pending++] = (i + quad.GetParameter(j * step)) * dt;
+			if (pending == SAMPLE_CHUNK_SIZE)
+				flush();
+		}
+		t[pending++] = (i + 1) * dt;
+		if (pending == SAMPLE_CHUNK_SIZE)
+			flush();
+	}
+	flush();
+	dst.back() = curve.p3;
+}
+
+void CurveFlattener::Flatten(const CubicBezier& curve, std::pmr::vector<VECTOR>& dst)
+{
+	dst.clear();
+	dst.push_back(curve.p0);
+	AppendCurve(curve, dst);
+}
+
+void CurveFlattener::Flatten(std::span<const CubicBezier> curves, std::pmr::vector<VECTOR>& dst)
+{
+	dst.clear();
+	for (auto& curve : curves)
+	{
+		if (dst.empty() || dst.back() != curve.p0)
+			dst.push_back(curve.p0);
+		AppendCurve(curve, dst);
+	}
+}
+
+void CurveFlattener::Flatten(const BatchResult& batch, std::pmr::vector<VECTOR>& dst, std::pmr::vector<size_t>& dstOffsets)
+{
+	dst.clear();
+	dstOffsets.clear();
+	dstOffsets.push_back(0);
+	for (size_t stroke = 0; stroke + 1 < batch.offsets.size(); stroke++)
+	{
+		size_t first = dst.size();
+		for (size_t i = batch.offsets[stroke]; i < batch.offsets[stroke + 1]; i++)
+		{
+			const auto& c = batch.curves[i];
+			if (dst.size() == first || dst.back() != c[0])
+				dst.push_back(c[0]);
+			AppendCurve(CubicBezier(c[0], c[1], c[2], c[3]), dst);
+		}
+		dstOffsets.push_back(dst.size());
+	}
+}
@@ -24,33 +24,334 @@ module bezierfit;
 import :curve_preprocess;
 
 using namespace bezierfit;
-std::vector<VECTOR> CurvePreprocess::Linearize(const std::vector<VECTOR>& src, FLOAT md)
+
+namespace {
+	template<typename T, int N>
+	void append(std::pmr::vector<glm::vec<N, T>>& dst, const glm::vec<N, T>& p) { dst.push_back(p); }
+	template<typename T, int N>
+	void append(BasicPointBuffer<T, N>& dst, const glm::vec<N, T>& p) { dst.PushBack(p); }
+
+	// Overwrites the front of the vector that is being read
+	template<typename T, int N>
+	struct InPlaceWriter
+	{
+		std::pmr::vector<glm::vec<N, T>>& points;
+		size_t count = 0;
+	};
+	template<typename T, int N>
+	void append(InPlaceWriter<T, N>& dst, const glm::vec<N, T>& p) { dst.points[dst.count++] = p; }
+
+	template<typename T, int N, typename TPoints, typename TDst>
+	void remove_duplicates(const TPoints& pts, size_t count, TDst& dst)
+	{
+		using Vector = glm::vec<N, T>;
+		if (count == 0)
+			return;
+		Vector prev = pts[0];
+		append(dst, prev);
+		for (size_t i = 1; i < count; i++)
+		{
+			Vector cur = pts[i];
+			if (!glm::all(glm::gtc::epsilonEqual(prev, cur, BasicCurvePreprocess<T, N>::EPSILON)))
+			{
+				append(dst, cur);
+				prev = cur;
+			}
+		}
+	}
+
+	// Distance of the point at vec1 from the line through the origin in the direction of vec2, whose length is d_vec2
+	template<typename T, int N>
+	inline T get_line_distance(const glm::vec<N, T>& vec1, const glm::vec<N, T>& vec2, T d_vec2)
+	{
+		if constexpr (N == 2)
+		{
+			T cross_product = vec1.x * vec2.y - vec2.x * vec1.y;
+			return std::abs(cross_product / d_vec2);
+		}
+		else
+			return glm::length(vec1 - vec2 * (glm::dot(vec1, vec2) / (d_vec2 * d_vec2))); // length of the part of vec1 perpendicular to vec2
+	}
+
+	template<typename T, int N, typename TPoints, typename TDst>
+	void rdp_reduce(const TPoints& pointList, size_t count, T epsilon, TDst& dst, std::pmr::vector<typename BasicCurvePreprocess<T, N>::RdpRange>& stack)
+	{
+		using Vector = glm::vec<N, T>;
+		if (count == 0)
+			return;
+		append(dst, pointList[0]);
+		if (count == 1)
+			return;
+
+		// Ranges are processed depth-first with the left half on top of the stack, so every range that is within
+		// tolerance is reached in order and only has to emit its last point.
+		stack.clear();
+		stack.push_back({ 0, static_cast<int>(count) - 1 });
+		while (!stack.empty())
+		{
+			typename BasicCurvePreprocess<T, N>::RdpRange range = stack.back();
+			stack.pop_back();
+
+			// Find the point with the maximum perpendicular distance to the line between the end points of the range
+			Vector lineP1 = pointList[range.first];
+			Vector lineP2 = pointList[range.last];
+			Vector vec2 = lineP2 - lineP1;
+			T d_vec2 = glm::length(vec2);
+			T dmax = 0;
+			int index = range.first;
+			for (int i = range.first + 1; i < range.last; ++i)
+			{
+				Vector vec1 = pointList[i] - lineP1;
+				T d = get_line_distance(vec1, vec2, d_vec2);
+				if (d > dmax)
+				{
+					index = i;
+					dmax = d;
+				}
+			}
+
+			// If max distance is greater than epsilon, simplify both halves
+			if (dmax > epsilon)
+			{
+				stack.push_back({ index, range.last });
+				stack.push_back({ range.first, index });
+			}
+			else
+				append(dst, lineP2);
+		}
+	}
+
+	// Area of the triangle a, b, c
+	template<typename T, int N>
+	inline T get_triangle_area(const glm::vec<N, T>& a, const glm::vec<N, T>& b, const glm::vec<N, T>& c)
+	{
+		glm::vec<N, T> u = b - a;
+		glm::vec<N, T> v = c - a;
+		if constexpr (N == 2)
+			return std::abs(u.x * v.y - u.y * v.x) / 2;
+		else
+		{
+			T uv = glm::dot(u, v);
+			return std::sqrt(std::max(glm::dot(u, u) * glm::dot(v, v) - uv * uv, T(0))) / 2;
+		}
+	}
+
+	// Binary min-heap of point indices ordered by the area of their node. Every node knows its position in the heap, so
+	// the area of a point that is still in the heap can be changed in O(log n).
+	template<typename T, int N>
+	class AreaHeap
+	{
+	public:
+		using VisvalingamNode = typename BasicCurvePreprocess<T, N>::VisvalingamNode;
+
+		AreaHeap(std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap)
+			: _nodes(nodes), _heap(heap)
+		{}
+
+		bool Empty() const { return _heap.empty(); }
+		int Top() const { return _heap.front(); }
+
+		// Turns the contents of the heap vector into a valid heap
+		void Build()
+		{
+			for (int i = 0; i < static_cast<int>(_heap.size()); i++)
+				_nodes[_heap[i]].heapIndex = i;
+			for (int i = static_cast<int>(_heap.size()) / 2 - 1; i >= 0; i--)
+				SiftDown(i);
+		}
+
+		void Pop()
+		{
+			_nodes[_heap.front()].heapIndex = -1;
+			int last = _heap.back();
+			_heap.pop_back();
+			if (_heap.empty())
+				return;
+			Place(0, last);
+			SiftDown(0);
+		}
+
+		void Update(int index, T area)
+		{
+			T prevArea = _nodes[index].area;
+			_nodes[index].area = area;
+			if (area < prevArea)
+				SiftUp(_nodes[index].heapIndex);
+			else
+				SiftDown(_nodes[index].heapIndex);
+		}
+	private:
+		// Ties are broken by index so that the result doesn't depend on the order of the heap
+		bool Less(int a, int b) const { return _nodes[a].area < _nodes[b].area || (_nodes[a].area == _nodes[b].area && a < b); }
+
+		void Place(int pos, int index)
+		{
+			_heap[pos] = index;
+			_nodes[index].heapIndex = pos;
+		}
+
+		void SiftUp(int pos)
+		{
+			int index = _heap[pos];
+			while (pos > 0)
+			{
+				int parent = (pos - 1) / 2;
+				if (!Less(index, _heap[parent]))
+					break;
+				Place(pos, _heap[parent]);
+				pos = parent;
+			}
+			Place(pos, index);
+		}
+
+		void SiftDown(int pos)
+		{
+			int index = _heap[pos];
+			int size = static_cast<int>(_heap.size());
+			for (;;)
+			{
+				int child = pos * 2 + 1;
+				if (child >= size)
+					break;
+				if (child + 1 < size && Less(_heap[child + 1], _heap[child]))
+					++child;
+				if (!Less(_heap[child], index))
+					break;
+				Place(pos, _heap[child]);
+				pos = child;
+			}
+			Place(pos, index);
+		}
+
+		std::pmr::vector<VisvalingamNode>& _nodes;
+		std::pmr::vector<int>& _heap;
+	};
+
+	template<typename T, int N, typename TPoints, typename TDst>
+	void visvalingam_reduce(const TPoints& pointList, size_t count, T minArea, TDst& dst, std::pmr::vector<typename BasicCurvePreprocess<T, N>::VisvalingamNode>& nodes,
+		std::pmr::vector<int>& heap)
+	{
+		int n = static_cast<int>(count);
+		nodes.resize(n);
+		heap.clear();
+		for (int i = 0; i < n; i++)
+			nodes[i] = { i - 1, i + 1, -1, std::numeric_limits<T>::infinity() };
+		// The end points are never removed, so they aren't part of the heap
+		for (int i = 1; i < n - 1; i++)
+		{
+			nodes[i].area = get_triangle_area(pointList[i - 1], pointList[i], pointList[i + 1]);
+			heap.push_back(i);
+		}
+		AreaHeap<T, N> areas { nodes, heap };
+		areas.Build();
+
+		while (!areas.Empty())
+		{
+			int i = areas.Top();
+			T area = nodes[i].area;
+			if (area >= minArea)
+				break;
+			areas.Pop();
+			int prev = nodes[i].prev;
+			int next = nodes[i].next;
+			nodes[prev].next = next;
+			nodes[next].prev = prev;
+			// The neighbors' effective areas can't drop below the area of the removed point, otherwise they could be
+			// removed before points that were more significant than it
+			if (prev > 0)
+				areas.Update(prev, std::max(area, get_triangle_area(pointList[nodes[prev].prev], pointList[prev], pointList[next])));
+			if (next < n - 1)
+				areas.Update(next, std::max(area, get_triangle_area(pointList[prev], pointList[next], pointList[nodes[next].next])));
+		}
+
+		// The remaining points are visited in order, so in place the writes never overtake the reads
+		for (int i = 0; i < n; i = nodes[i].next)
+			append(dst, pointList[i]);
+	}
+}
+
+template<typename T, int N>
+BasicCurvePreprocess<T, N>::Buffers::Buffers(std::pmr::memory_resource* resource)
+	: deduplicated(resource), linearized(resource), reduced(resource), stack(resource), nodes(resource), heap(resource)
+{
+}
+
+template<typename T, int N>
+std::span<const glm::vec<N, T>> BasicCurvePreprocess<T, N>::Preprocess(std::span<const Vector> points, const FitOptions& options, Buffers& buffers)
+{
+	if (options.linearizeDistance < 0)
+		throw std::invalid_argument("linearizeDistance cannot be negative");
+	if (options.linearizeDistance > 0 && options.linearizeDistance <= EPSILON)
+		throw std::invalid_argument("linearizeDistance must be 0 or greater than epsilon");
+	if (options.reduceTolerance < 0)
+		throw std::invalid_argument("reduceTolerance cannot be negative");
+	if (points.empty())
+		return points;
+
+	std::span<const Vector> result = points;
+	if (options.removeDuplicates)
+	{
+		buffers.deduplicated.clear();
+		remove_duplicates<T, N>(result, result.size(), buffers.deduplicated);
+		result = buffers.deduplicated;
+	}
+	if (options.linearizeDistance > 0)
+	{
+		Linearize(result, options.linearizeDistance, buffers.linearized);
+		result = buffers.linearized;
+	}
+	if (options.reduceTolerance > 0)
+	{
+		switch (options.reducer)
+		{
+		case Reducer::Rdp:
+			RdpReduce(result, options.reduceTolerance, buffers.reduced, buffers.stack);
+			break;
+		case Reducer::Visvalingam:
+			VisvalingamReduce(result, options.reduceTolerance * options.reduceTolerance, buffers.reduced, buffers.nodes, buffers.heap);
+			break;
+		}
+		result = buffers.reduced;
+	}
+	return result;
+}
+
+template<typename T, int N>
+std::pmr::vector<glm::vec<N, T>> BasicCurvePreprocess<T, N>::Linearize(std::span<const Vector> src, T md, std::pmr::memory_resource* resource)
+{
+	std::pmr::vector<Vector> dst{ resource };
+	Linearize(src, md, dst);
+	return dst;
+}
+
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::Linearize(std::span<const Vector> src, T md, std::pmr::vector<Vector>& dst)
 {
 	if (src.empty())
 		throw std::invalid_argument("src cannot be empty");
 	if (md <= EPSILON)
 		throw std::invalid_argument("md must be greater than epsilon");
 
-	std::vector<VECTOR> dst;
+	dst.clear();
 	if (src.size() > 0)
 	{
-		VECTOR pp = src[0];
+		Vector pp = src[0];
 		dst.push_back(pp);
-		FLOAT cd = 0;
+		T cd = 0;
 		for (size_t ip = 1; ip < src.size(); ip++)
 		{
-			VECTOR p0 = src[ip - 1];
-			VECTOR p1 = src[ip];
-			FLOAT td = glm::distance(p0, p1);
+			Vector p0 = src[ip - 1];
+			Vector p1 = src[ip];
+			T td = glm::distance(p0, p1);
 			if (cd + td > md)
 			{
-				FLOAT pd = md - cd;
+				T pd = md - cd;
 				dst.push_back(glm::mix(p0, p1, pd / td));
-				FLOAT rd = td - pd;
+				T rd = td - pd;
 				while (rd > md)
 				{
 					rd -= md;
-					VECTOR np = glm::mix(p0, p1, (td - rd) / td);
+					Vector np = glm::mix(p0, p1, (td - rd) / td);
 					if (!glm::all(glm::gtc::epsilonEqual(np, pp, EPSILON)))
 					{
 						dst.push_back(np);
@@ -65,81 +366,99 @@ std::vector<VECTOR> CurvePreprocess::Linearize(const std::vector<VECTOR>& src, F
 			}
 		}
 		// last point
-		VECTOR lp = src.back();
+		Vector lp = src.back();
 		if (!glm::all(glm::gtc::epsilonEqual(pp, lp, EPSILON)))
 			dst.push_back(lp);
 	}
-	return dst;
 }
 
-std::vector<VECTOR> CurvePreprocess::RemoveDuplicates(const std::vector<VECTOR>& pts)
+template<typename T, int N>
+std::pmr::vector<glm::vec<N, T>> BasicCurvePreprocess<T, N>::RemoveDuplicates(std::span<const Vector> pts, std::pmr::memory_resource* resource)
 {
 	if (pts.size() < 2)
-		return pts;
+		return { pts.begin(), pts.end(), resource };
 
-	std::vector<VECTOR> dst;
+	std::pmr::vector<Vector> dst{ resource };
 	dst.reserve(pts.size());
-	dst.push_back(pts[0]);
-	for (size_t i = 1; i < pts.size(); i++)
-	{
-		VECTOR cur = pts[i];
-		VECTOR prev = dst.back();
-		if (!glm::all(glm::gtc::epsilonEqual(prev, cur, EPSILON)))
-		{
-			dst.push_back(cur);
-		}
-	}
+	remove_duplicates<T, N>(pts, pts.size(), dst);
 	return dst;
 }
 
-std::vector<VECTOR> CurvePreprocess::RdpReduce(const std::vector<VECTOR>& pointList, float epsilon)
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::RemoveDuplicates(const PointBuffer& pts, PointBuffer& dst)
 {
-	std::vector<VECTOR> resultList;
-	resultList.reserve(pointList.size() /2);
-
-	// Find the point with the maximum distance
-	float dmax = 0;
-	int index = 0;
-	for (int i = 1; i < pointList.size() - 1; ++i) {
-		float d = PerpendicularDistance(pointList[i], pointList[0], pointList[pointList.size() - 1]);
-		if (d > dmax) {
-			index = i;
-			dmax = d;
-		}
-	}
-	// If max distance is greater than epsilon, recursively simplify
-	if (dmax > epsilon) {
-		std::vector<VECTOR> pre_part, next_part;
-		pre_part.reserve(index +1);
-		for (int i = 0; i <= index; ++i)
-			pre_part.push_back(pointList[i]);
-		next_part.reserve(pointList.size() -index);
-		for (int i = index; i < pointList.size(); ++i)
-			next_part.push_back(pointList[i]);
-		// Recursive call
-		std::vector<VECTOR> resultList1 = RdpReduce(pre_part, epsilon);
-		std::vector<VECTOR> resultList2 = RdpReduce(next_part, epsilon);
-
-		// combine
-		resultList.insert(resultList.end(), resultList1.begin(), resultList1.end());
-		resultList.insert(resultList.end(), resultList2.begin() + 1, resultList2.end());
-	}
-	else {
-		resultList.push_back(pointList[0]);
-		resultList.push_back(pointList[pointList.size() - 1]);
-	}
-	if (resultList.size() == resultList.capacity())
-		resultList.reserve(pointList.size());
+	dst.Clear();
+	dst.Reserve(pts.Size());
+	remove_duplicates<T, N>(pts, pts.Size(), dst);
+}
 
+template<typename T, int N>
+std::pmr::vector<glm::vec<N, T>> BasicCurvePreprocess<T, N>::RdpReduce(std::span<const Vector> pointList, T epsilon, std::pmr::memory_resource* resource)
+{
+	std::pmr::vector<Vector> resultList{ resource };
+	std::pmr::vector<RdpRange> stack{ resource };
+	RdpReduce(pointList, epsilon, resultList, stack);
 	return resultList;
 }
 
-FLOAT CurvePreprocess::PerpendicularDistance(const VECTOR& p, const VECTOR& lineP1, const VECTOR& lineP2)
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::RdpReduce(std::span<const Vector> pointList, T epsilon, std::pmr::vector<Vector>& dst, std::pmr::vector<RdpRange>& stack)
+{
+	dst.clear();
+	rdp_reduce<T, N>(pointList, pointList.size(), epsilon, dst, stack);
+}
+
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::RdpReduce(const PointBuffer& pointList, T epsilon, PointBuffer& dst, std::pmr::vector<RdpRange>& stack)
 {
-	VECTOR vec1 = VECTOR(p.x - lineP1.x, p.y - lineP1.y);
-	VECTOR vec2 = VECTOR(lineP2.x - lineP1.x, lineP2.y - lineP1.y);
-	float d_vec2 = sqrt(vec2.x * vec2.x + vec2.y * vec2.y);
-	float cross_product = vec1.x * vec2.y - vec2.x * vec1.y;
-	float d = fabs(cross_product / d_vec2);
-	return d;
+	dst.Clear();
+	rdp_reduce<T, N>(pointList, pointList.Size(), epsilon, dst, stack);
 }
+
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::RdpReduceInPlace(std::pmr::vector<Vector>& points, T epsilon, std::pmr::vector<RdpRange>& stack)
+{
+	InPlaceWriter<T, N> dst { points };
+	rdp_reduce<T, N>(points, points.size(), epsilon, dst, stack);
+	points.resize(dst.count);
+}
+
+template<typename T, int N>
+std::pmr::vector<glm::vec<N, T>> BasicCurvePreprocess<T, N>::VisvalingamReduce(std::span<const Vector> pointList, T minArea, std::pmr::memory_resource* resource)
+{
+	std::pmr::vector<Vector> resultList{ resource };
+	std::pmr::vector<VisvalingamNode> nodes{ resource };
+	std::pmr::vector<int> heap{ resource };
+	VisvalingamReduce(pointList, minArea, resultList, nodes, heap);
+	return resultList;
+}
+
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::VisvalingamReduce(std::span<const Vector> pointList, T minArea, std::pmr::vector<Vector>& dst, std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap)
+{
+	dst.clear();
+	visvalingam_reduce<T, N>(pointList, pointList.size(), minArea, dst, nodes, heap);
+}
+
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::VisvalingamReduceInPlace(std::pmr::vector<Vector>& points, T minArea, std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap)
+{
+	InPlaceWriter<T, N> dst { points };
+	visvalingam_reduce<T, N>(points, points.size(), minArea, dst, nodes, heap);
+	points.resize(dst.count);
+}
+
+template<typename T, int N>
+void BasicCurvePreprocess<T, N>::VisvalingamReduce(const PointBuffer& pointList, T minArea, PointBuffer& dst, std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap)
+{
+	dst.Clear();
+	visvalingam_reduce<T, N>(pointList, pointList.Size(), minArea, dst, nodes, heap);
+}
+
+template class bezierfit::BasicCurvePreprocess<float, 2>;
+template class bezierfit::BasicCurvePreprocess<float, 3>;
+template class bezierfit::BasicCurvePreprocess<double, 2>;
+template class bezierfit::BasicCurvePreprocess<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicCurvePreprocess<FLOAT, 4>;
+#endif
@@ -0,0 +1,336 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :curve_set;
+import :vector_helper;
+
+using namespace bezierfit;
+
+namespace {
+	constexpr char MAGIC[4] = { 'B', 'Z', 'C', 'S' };
+	constexpr uint16_t FORMAT_VERSION = 1;
+	constexpr uint8_t FLAG_DOUBLE = 1;
+	constexpr uint8_t FLAG_QUANTIZED = 2;
+	constexpr FLOAT QUANTIZATION_LEVELS = FLOAT(65535);
+	constexpr size_t SECTION_ALIGNMENT = 8;
+
+	static_assert(sizeof(VECTOR) == DIMENSION * sizeof(FLOAT), "the points are read in place as VECTOR");
+
+	struct Header
+	{
+		char magic[4];
+		uint16_t version;
+		uint8_t dimension;
+		uint8_t flags;
+		uint32_t strokeCount;
+		uint32_t curveCount;
+		uint32_t pointCount;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(Header) == 24 && sizeof(Header) % SECTION_ALIGNMENT == 0);
+
+	// Start of every section and the total size, in bytes
+	struct Layout
+	{
+		size_t strokes;
+		size_t quantization;
+		size_t points;
+		size_t size;
+
+		Layout(size_t strokeCount, size_t pointCount, bool quantized)
+		{
+			strokes = sizeof(Header);
+			quantization = strokes + (strokeCount + 1) * 2 * sizeof(uint32_t);
+			points = quantization + (quantized ? strokeCount * 2 * DIMENSION * sizeof(FLOAT) : 0);
+			size = points + pointCount * DIMENSION * (quantized ? sizeof(uint16_t) : sizeof(FLOAT));
+		}
+	};
+
+	bool is_aligned(const void* p) { return reinterpret_cast<uintptr_t>(p) % SECTION_ALIGNMENT == 0; }
+
+	// The file is read in place, so its byte order has to be the one of the machine
+	void check_byte_order()
+	{
+		if (std::endian::native != std::endian::little)
+			throw std::runtime_error("curve sets are only supported on little endian targets");
+	}
+}
+
+CurveSetWriter::CurveSetWriter(CurveSetEncoding encoding, std::pmr::memory_resource* resource)
+	: _encoding(encoding), _points(resource), _strokePoints(resource), _strokeBounds(resource)
+{
+	check_byte_order();
+	_strokePoints.push_back(0);
+}
+
+CurveSetEncoding CurveSetWriter::GetEncoding() const { return _encoding; }
+size_t CurveSetWriter::GetStrokeCount() const { return _strokeBounds.size(); }
+
+size_t CurveSetWriter::GetCurveCount() const { return _curveCount; }
+
+template<typename TGetPoint>
+void CurveSetWriter::AppendChain(size_t curveCount, const TGetPoint& getPoint)
+{
+	for (size_t i = 1; i < curveCount; i++)
+	{
+		if (!VectorHelper::EqualsOrClose(getPoint(i - 1, 3), getPoint(i, 0)))
+			throw std::invalid_argument("The curve at index " + std::to_string(i) + " does not connect with the previous curve at index " + std::to_string(i - 1));
+	}
+	if (curveCount != 0 && _points.size() + 3 * curveCount + 1 > std::numeric_limits<uint32_t>::max())
+		throw std::invalid_argument("too many curves");
+	BoundingBox bounds;
+	if (curveCount != 0)
+	{
+		_points.push_back(getPoint(0, 0));
+		bounds.Include(getPoint(0, 0));
+	}
+	for (size_t i = 0; i < curveCount; i++)
+	{
+		for (int point = 1; point < 4; point++)
+		{
+			_points.push_back(getPoint(i, point));
+			bounds.Include(getPoint(i, point));
+		}
+	}
+	_strokePoints.push_back(static_cast<uint32_t>(_points.size()));
+	_strokeBounds.push_back(bounds);
+	_curveCount += curveCount;
+}
+
+void CurveSetWriter::AddStroke(std::span<const CubicBezier> curves)
+{
+	AppendChain(curves.size(), [&curves](size_t curve, int point) -> const VECTOR& {
+		auto& c = curves[curve];
+		return point == 0 ? c.p0 : point == 1 ? c.p1 : point == 2 ? c.p2 : c.p3;
+	});
+}
+
+void CurveSetWriter::AddStroke(std::span<const std::array<VECTOR, 4>> curves)
+{
+	AppendChain(curves.size(), [&curves](size_t curve, int point) -> const VECTOR& { return curves[curve][point]; });
+}
+
+void CurveSetWriter::AddBatch(const BatchResult& batch)
+{
+	std::span<const std::array<VECTOR, 4>> curves { batch.curves };
+	for (size_t stroke = 0; stroke + 1 < batch.offsets.size(); stroke++)
+		AddStroke(curves.subspan(batch.offsets[stroke], batch.offsets[stroke + 1] - batch.offsets[stroke]));
+}
+
+void CurveSetWriter::Clear()
+{
+	_points.clear();
+	_strokePoints.clear();
+	_strokePoints.push_back(0);
+	_strokeBounds.clear();
+	_curveCount = 0;
+}
+
+size_t CurveSetWriter::GetSize() const
+{
+	return Layout(GetStrokeCount(), _points.size(), _encoding == CurveSetEncoding::Quantized16).size;
+}
+
+void CurveSetWriter::Write(std::span<std::byte> dst) const
+{
+	bool quantized = _encoding == CurveSetEncoding::Quantized16;
+	size_t strokeCount = GetStrokeCount();
+	Layout layout { strokeCount, _points.size(), quantized };
+	if (dst.size() < layout.size)
+		throw std::out_of_range("dst is smaller than the curve set");
+	if (!is_aligned(dst.data()))
+		throw std::invalid_argument("dst must be aligned to 8 bytes");
+	if (strokeCount >= std::numeric_limits<uint32_t>::max())
+		throw std::invalid_argument("too many strokes");
+
+	Header header {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = FORMAT_VERSION;
+	header.dimension = static_cast<uint8_t>(DIMENSION);
+	header.flags = (sizeof(FLOAT) == sizeof(double) ? FLAG_DOUBLE : 0) | (quantized ? FLAG_QUANTIZED : 0);
+	header.strokeCount = static_cast<uint32_t>(strokeCount);
+	header.curveCount = static_cast<uint32_t>(_curveCount);
+	header.pointCount = static_cast<uint32_t>(_points.size());
+	std::memcpy(dst.data(), &header, sizeof(Header));
+
+	uint32_t* strokes = reinterpret_cast<uint32_t*>(dst.data() + layout.strokes);
+	uint32_t firstCurve = 0;
+	for (size_t i = 0; i <= strokeCount; i++)
+	{
+		strokes[2 * i] = firstCurve;
+		strokes[2 * i + 1] = _strokePoints[i];
+		if (i < strokeCount && _strokePoints[i + 1] > _strokePoints[i])
+			firstCurve += (_strokePoints[i + 1] - _strokePoints[i] - 1) / 3;
+	}
+
+	if (!quantized)
+	{
+		std::memcpy(dst.data() + layout.points, _points.data(), _points.size() * sizeof(VECTOR));
+		return;
+	}
+	FLOAT* quantization = reinterpret_cast<FLOAT*>(dst.data() + layout.quantization);
+	uint16_t* points = reinterpret_cast<uint16_t*>(dst.data() + layout.points);
+	for (size_t i = 0; i < strokeCount; i++)
+	{
+		const BoundingBox& bounds = _strokeBounds[i];
+		VECTOR min = bounds.IsEmpty() ? VECTOR(0) : bounds.min;
+		VECTOR step = bounds.IsEmpty() ? VECTOR(0) : (bounds.max - bounds.min) / QUANTIZATION_LEVELS;
+		for (int j = 0; j < DIMENSION; j++)
+		{
+			quantization[2 * DIMENSION * i + j] = min[j];
+			quantization[2 * DIMENSION * i + DIMENSION + j] = step[j];
+		}
+		for (uint32_t p = _strokePoints[i]; p < _strokePoints[i + 1]; p++)
+		{
+			for (int j = 0; j < DIMENSION; j++)
+			{
+				FLOAT q = step[j] > 0 ? std::round((_points[p][j] - min[j]) / step[j]) : FLOAT(0);
+				points[p * DIMENSION + j] = static_cast<uint16_t>(std::clamp(q, FLOAT(0), QUANTIZATION_LEVELS));
+			}
+		}
+	}
+}
+
+void CurveSetWriter::Write(std::pmr::vector<std::byte>& dst) const
+{
+	dst.resize(GetSize());
+	Write(std::span<std::byte> { dst });
+}
+
+CurveSetView::CurveSetView(std::span<const std::byte> data)
+{
+	check_byte_order();
+	if (data.size() < sizeof(Header))
+		throw std::invalid_argument("data is too small for a curve set");
+	if (!is_aligned(data.data()))
+		throw std::invalid_argument("data must be aligned to 8 bytes");
+	Header header;
+	std::memcpy(&header, data.data(), sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+		throw std::invalid_argument("data is not a curve set");
+	if (header.version != FORMAT_VERSION)
+		throw std::invalid_argument("unsupported curve set version " + std::to_string(header.version));
+	if (header.dimension != DIMENSION || (header.flags & FLAG_DOUBLE) != (sizeof(FLOAT) == sizeof(double) ? FLAG_DOUBLE : 0))
+		throw std::invalid_argument("the curve set was written with a different DIMENSION or FLOAT");
+	if ((header.flags & ~(FLAG_DOUBLE | FLAG_QUANTIZED)) != 0)
+		throw std::invalid_argument("unsupported curve set flags");
+
+	bool quantized = (header.flags & FLAG_QUANTIZED) != 0;
+	Layout layout { header.strokeCount, header.pointCount, quantized };
+	if (data.size() < layout.size)
+		throw std::invalid_argument("data is smaller than the curve set");
+	_encoding = quantized ? CurveSetEncoding::Quantized16 : CurveSetEncoding::Float;
+	_strokeCount = header.strokeCount;
+	_curveCount = header.curveCount;
+	_pointCount = header.pointCount;
+	_strokes = reinterpret_cast<const StrokeEntry*>(data.data() + layout.strokes);
+	if (_strokes[_strokeCount].firstCurve != _curveCount || _strokes[_strokeCount].firstPoint != _pointCount)
+		throw std::invalid_argument("corrupt stroke table");
+	if (quantized)
+	{
+		_quantization = reinterpret_cast<const FLOAT*>(data.data() + layout.quantization);
+		_quantizedPoints = reinterpret_cast<const uint16_t*>(data.data() + layout.points);
+	}
+	else
+		_points = reinterpret_cast<const VECTOR*>(data.data() + layout.points);
+}
+
+CurveSetEncoding CurveSetView::GetEncoding() const { return _encoding; }
+size_t CurveSetView::GetStrokeCount() const { return _strokeCount; }
+size_t CurveSetView::GetCurveCount() const { return _curveCount; }
+
+void CurveSetView::GetStroke(size_t stroke, size_t& firstCurve, size_t& curveCount, size_t& firstPoint) const
+{
+	if (stroke >= _strokeCount)
+		throw std::out_of_range("stroke out of range");
+	const StrokeEntry& entry = _strokes[stroke];
+	const StrokeEntry& next = _strokes[stroke + 1];
+	// Also rules out strokes that reach past the sections, since the last entry holds the totals
+	if (entry.firstCurve > next.firstCurve || next.firstCurve > _curveCount || entry.firstPoint > next.firstPoint || next.firstPoint > _pointCount)
+		throw std::invalid_argument("corrupt stroke table");
+	firstCurve = entry.firstCurve;
+	curveCount = next.firstCurve - entry.firstCurve;
+	firstPoint = entry.firstPoint;
+	if (next.firstPoint - entry.firstPoint != (curveCount > 0 ? 3 * curveCount + 1 : 0))
+		throw std::invalid_argument("corrupt stroke table");
+}
+
+size_t CurveSetView::GetCurveCount(size_t stroke) const
+{
+	size_t firstCurve, curveCount, firstPoint;
+	GetStroke(stroke, firstCurve, curveCount, firstPoint);
+	return curveCount;
+}
+
+VECTOR CurveSetView::GetPoint(size_t stroke, size_t point) const
+{
+	if (_points)
+		return _points[point];
+	const FLOAT* min = _quantization + 2 * DIMENSION * stroke;
+	const FLOAT* step = min + DIMENSION;
+	const uint16_t* q = _quantizedPoints + point * DIMENSION;
+	VECTOR p;
+	for (int j = 0; j < DIMENSION; j++)
+		p[j] = min[j] + step[j] * q[j];
+	return p;
+}
+
+CubicBezier CurveSetView::GetCurve(size_t stroke, size_t index) const
+{
+	size_t firstCurve, curveCount, firstPoint;
+	GetStroke(stroke, firstCurve, curveCount, firstPoint);
+	if (index >= curveCount)
+		throw std::out_of_range("index out of range");
+	size_t p = firstPoint + 3 * index;
+	return CubicBezier(GetPoint(stroke, p), GetPoint(stroke, p + 1), GetPoint(stroke, p + 2), GetPoint(stroke, p + 3));
+}
+
+std::span<const VECTOR> CurveSetView::GetPoints(size_t stroke) const
+{
+	if (_encoding != CurveSetEncoding::Float)
+		throw std::invalid_argument("the points of a quantized curve set can't be read in place");
+	size_t firstCurve, curveCount, firstPoint;
+	GetStroke(stroke, firstCurve, curveCount, firstPoint);
+	return { _points + firstPoint, curveCount > 0 ? 3 * curveCount + 1 : 0 };
+}
+
+void CurveSetView::ReadStroke(size_t stroke, std::pmr::vector<CubicBezier>& dst) const
+{
+	dst.clear();
+	size_t firstCurve, curveCount, firstPoint;
+	GetStroke(stroke, firstCurve, curveCount, firstPoint);
+	dst.reserve(curveCount);
+	VECTOR p0 = curveCount > 0 ? GetPoint(stroke, firstPoint) : VECTOR(0);
+	for (size_t i = 0; i < curveCount; i++)
+	{
+		size_t p = firstPoint + 3 * i;
+		VECTOR p3 = GetPoint(stroke, p + 3);
+		dst.push_back(CubicBezier(p0, GetPoint(stroke, p + 1), GetPoint(stroke, p + 2), p3));
+		p0 = p3;
+	}
+}
+
+BatchResult CurveSetView::ToBatchResult() const
+{
+	BatchResult result;
+	result.curves.reserve(_curveCount);
+	result.offsets.reserve(_strokeCount + 1);
+	result.offsets.push_back(0);
+	for (size_t stroke = 0; stroke < _strokeCount; stroke++)
+	{
+		size_t firstCurve, curveCount, firstPoint;
+		GetStroke(stroke, firstCurve, curveCount, firstPoint);
+		for (size_t i = 0; i < curveCount; i++)
+		{
+			size_t p = firstPoint + 3 * i;
+			result.curves.push_back({ GetPoint(stroke, p), GetPoint(stroke, p + 1), GetPoint(stroke, p + 2), GetPoint(stroke, p + 3) });
+		}
+		result.offsets.push_back(result.curves.size());
+	}
+	return result;
+}
@@ -0,0 +1,81 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :fit_context;
+
+using namespace bezierfit;
+
+FitContext::FitContext(std::pmr::memory_resource* resource)
+	: CurveFit(resource)
+{
+}
+
+std::span<const CubicBezier> FitContext::Fit(std::span<const VECTOR> points, FLOAT maxError)
+{
+	if (maxError < EPSILON)
+		throw std::invalid_argument("maxError cannot be negative/zero/less than epsilon value");
+	_result.clear();
+	if (points.size() < 2)
+		return {}; // need at least 2 points to do anything
+
+	auto capacities = GetCapacities();
+	Initialize(points, maxError);
+	FitInitialized();
+	CountAllocations(capacities);
+	return _result;
+}
+
+std::span<const CubicBezier> FitContext::Fit(const PointBuffer& points, FLOAT maxError)
+{
+	if (maxError < EPSILON)
+		throw std::invalid_argument("maxError cannot be negative/zero/less than epsilon value");
+	_result.clear();
+	if (points.Size() < 2)
+		return {}; // need at least 2 points to do anything
+
+	auto capacities = GetCapacities();
+	Initialize(points, maxError);
+	FitInitialized();
+	CountAllocations(capacities);
+	return _result;
+}
+
+void FitContext::FitInitialized()
+{
+	// Find tangents at ends
+	int last = GetPointCount() - 1;
+	VECTOR tanL = GetLeftTangent(last);
+	VECTOR tanR = GetRightTangent(0);
+
+	FitRecursive(0, last, tanL, tanR, _u, _result, _stats);
+
+	// Don't keep references to the caller's points around
+	_pts = {};
+	_soa = nullptr;
+}
+
+void FitContext::Reserve(size_t numPoints)
+{
+	auto capacities = GetCapacities();
+	_arclen.reserve(numPoints);
+	_u.reserve(numPoints);
+	// Every curve consumes at least one point, so there can't be more curves than points
+	_result.reserve(numPoints);
+	CountAllocations(capacities);
+}
+
+size_t FitContext::GetAllocationCount() const { return _allocationCount; }
+void FitContext::ResetAllocationCount() { _allocationCount = 0; }
+
+FitContext::Capacities FitContext::GetCapacities() const { return { _arclen.capacity(), _u.capacity(), _result.capacity() }; }
+
+void FitContext::CountAllocations(const Capacities& before)
+{
+	auto after = GetCapacities();
+	_allocationCount += (after.arclen != before.arclen) + (after.u != before.u) + (after.result != before.result);
+}
@@ -0,0 +1,915 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEZIERFIT_SIMD_SSE2
+// The AVX2 kernels are compiled for every x86 target and only used if the CPU supports them
+#define BEZIERFIT_SIMD_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define BEZIERFIT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+module bezierfit;
+
+import :fit_kernels;
+
+using namespace bezierfit;
+
+#if defined(BEZIERFIT_SIMD_SSE2) || defined(BEZIERFIT_SIMD_NEON)
+#define BEZIERFIT_SIMD
+#endif
+
+// GCC and Clang only allow AVX2 intrinsics in functions compiled for it, MSVC allows them anywhere.
+// The kernel bodies are forced inline, so they are compiled for the instruction set of the function that runs them.
+#if defined(__GNUC__) || defined(__clang__)
+#define BEZIERFIT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define BEZIERFIT_FORCE_INLINE __attribute__((always_inline)) inline
+#else
+#define BEZIERFIT_TARGET_AVX2
+#define BEZIERFIT_FORCE_INLINE __forceinline
+#endif
+
+namespace {
+	bool detect_avx2()
+	{
+#if !defined(BEZIERFIT_SIMD_AVX2)
+		return false;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		// The OS has to save the upper halves of the registers as well
+		if (!fma || !osxsave || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}
+
+	// The widest backend that the target and the CPU support
+	FitKernels::Backend get_best_backend()
+	{
+		if (FitKernels::IsSupported(FitKernels::Backend::Avx2))
+			return FitKernels::Backend::Avx2;
+		if (FitKernels::IsSupported(FitKernels::Backend::Simd))
+			return FitKernels::Backend::Simd;
+		return FitKernels::Backend::Scalar;
+	}
+}
+
+static std::atomic<FitKernels::Backend> g_backend = get_best_backend();
+
+bool FitKernels::IsSimdSupported()
+{
+#ifdef BEZIERFIT_SIMD
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FitKernels::IsSupported(Backend backend)
+{
+	static const bool avx2 = detect_avx2();
+	switch (backend)
+	{
+	case Backend::Scalar:
+		return true;
+	case Backend::Simd:
+		return IsSimdSupported();
+	case Backend::Avx2:
+		return avx2;
+	}
+	return false;
+}
+
+FitKernels::Backend FitKernels::GetBackend() { return g_backend.load(std::memory_order_relaxed); }
+
+void FitKernels::SetBackend(Backend backend)
+{
+	if (backend == Backend::Avx2 && !IsSupported(Backend::Avx2))
+		backend = Backend::Simd;
+	if (!IsSupported(backend))
+		backend = Backend::Scalar;
+	g_backend.store(backend, std::memory_order_relaxed);
+}
+
+#ifdef BEZIERFIT_SIMD
+namespace {
+	// The SIMD kernels only exist for 2D float points, the other instantiations of BasicFitKernels use the scalar code
+	using Vector2 = glm::vec<2, float>;
+	using CubicBezier2 = BasicCubicBezier<float, 2>;
+	using LeastSquaresSums2 = BasicFitKernels<float, 2>::LeastSquaresSums;
+	static_assert(sizeof(Vector2) == 2 * sizeof(float), "SIMD kernels require tightly packed float vectors");
+
+	// Minimal wrappers of four (F4) and eight (F8) lanes, so the kernels below are written once for both widths.
+	// Masks have all bits of a lane set if the comparison was true.
+#ifdef BEZIERFIT_SIMD_SSE2
+	struct M4 { __m128 v; };
+	struct I4
+	{
+		__m128i v;
+		static I4 Set1(int i) { return { _mm_set1_epi32(i) }; }
+		// 0, 1, 2, 3
+		static I4 Iota() { return { _mm_setr_epi32(0, 1, 2, 3) }; }
+	};
+	struct F4
+	{
+		using Int = I4;
+		static constexpr int WIDTH = 4;
+		__m128 v;
+		static F4 Set1(float f) { return { _mm_set1_ps(f) }; }
+		static F4 Load(const float* p) { return { _mm_loadu_ps(p) }; }
+	};
+
+	inline void store(float* p, F4 a) { _mm_storeu_ps(p, a.v); }
+	// Loads four interleaved (x, y) pairs and splits them into their components
+	inline void load_xy(const float* p, F4& x, F4& y)
+	{
+		__m128 a = _mm_loadu_ps(p);
+		__m128 b = _mm_loadu_ps(p + 4);
+		x = { _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)) };
+		y = { _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)) };
+	}
+	// Interleaves the components again and stores them as four (x, y) pairs
+	inline void store_xy(float* p, F4 x, F4 y)
+	{
+		_mm_storeu_ps(p, _mm_unpacklo_ps(x.v, y.v));
+		_mm_storeu_ps(p + 4, _mm_unpackhi_ps(x.v, y.v));
+	}
+	inline F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline F4 operator/(F4 a, F4 b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline F4 abs(F4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+	inline F4 sqrt(F4 a) { return { _mm_sqrt_ps(a.v) }; }
+	inline M4 operator>(F4 a, F4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+	inline M4 operator>=(F4 a, F4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+	inline M4 operator<=(F4 a, F4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+	inline M4 operator&(M4 a, M4 b) { return { _mm_and_ps(a.v, b.v) }; }
+	inline F4 select(M4 m, F4 a, F4 b) { return { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) }; }
+
+	inline I4 operator+(I4 a, I4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+	inline void store(int* p, I4 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a.v); }
+	inline I4 select(M4 m, I4 a, I4 b)
+	{
+		__m128i mi = _mm_castps_si128(m.v);
+		return { _mm_or_si128(_mm_and_si128(mi, a.v), _mm_andnot_si128(mi, b.v)) };
+	}
+#else
+	struct M4 { uint32x4_t v; };
+	struct I4
+	{
+		int32x4_t v;
+		static I4 Set1(int i) { return { vdupq_n_s32(i) }; }
+		static I4 Iota()
+		{
+			static const int v[4] = { 0, 1, 2, 3 };
+			return { vld1q_s32(v) };
+		}
+	};
+	struct F4
+	{
+		using Int = I4;
+		static constexpr int WIDTH = 4;
+		float32x4_t v;
+		static F4 Set1(float f) { return { vdupq_n_f32(f) }; }
+		static F4 Load(const float* p) { return { vld1q_f32(p) }; }
+	};
+
+	inline void store(float* p, F4 a) { vst1q_f32(p, a.v); }
+	inline void load_xy(const float* p, F4& x, F4& y)
+	{
+		float32x4x2_t xy = vld2q_f32(p);
+		x = { xy.val[0] };
+		y = { xy.val[1] };
+	}
+	inline void store_xy(float* p, F4 x, F4 y)
+	{
+		float32x4x2_t xy = { { x.v, y.v } };
+		vst2q_f32(p, xy);
+	}
+	inline F4 operator+(F4 a, F4 b) { return { vaddq_f32(a.v, b.v) }; }
+	inline F4 operator-(F4 a, F4 b) { return { vsubq_f32(a.v, b.v) }; }
+	inline F4 operator*(F4 a, F4 b) { return { vmulq_f32(a.v, b.v) }; }
+	inline F4 operator/(F4 a, F4 b) { return { vdivq_f32(a.v, b.v) }; }
+	inline F4 abs(F4 a) { return { vabsq_f32(a.v) }; }
+	inline F4 sqrt(F4 a) { return { vsqrtq_f32(a.v) }; }
+	inline M4 operator>(F4 a, F4 b) { return { vcgtq_f32(a.v, b.v) }; }
+	inline M4 operator>=(F4 a, F4 b) { return { vcgeq_f32(a.v, b.v) }; }
+	inline M4 operator<=(F4 a, F4 b) { return { vcleq_f32(a.v, b.v) }; }
+	inline M4 operator&(M4 a, M4 b) { return { vandq_u32(a.v, b.v) }; }
+	inline F4 select(M4 m, F4 a, F4 b) { return { vbslq_f32(m.v, a.v, b.v) }; }
+
+	inline I4 operator+(I4 a, I4 b) { return { vaddq_s32(a.v, b.v) }; }
+	inline void store(int* p, I4 a) { vst1q_s32(p, a.v); }
+	inline I4 select(M4 m, I4 a, I4 b) { return { vbslq_s32(m.v, a.v, b.v) }; }
+#endif
+
+	inline float hsum(F4 a)
+	{
+		float v[4];
+		store(v, a);
+		return (v[0] + v[1]) + (v[2] + v[3]);
+	}
+
+#ifdef BEZIERFIT_SIMD_AVX2
+	struct M8 { __m256 v; };
+	struct I8
+	{
+		__m256i v;
+		BEZIERFIT_TARGET_AVX2 static I8 Set1(int i) { return { _mm256_set1_epi32(i) }; }
+		BEZIERFIT_TARGET_AVX2 static I8 Iota() { return { _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) }; }
+	};
+	struct F8
+	{
+		using Int = I8;
+		static constexpr int WIDTH = 8;
+		__m256 v;
+		BEZIERFIT_TARGET_AVX2 static F8 Set1(float f) { return { _mm256_set1_ps(f) }; }
+		BEZIERFIT_TARGET_AVX2 static F8 Load(const float* p) { return { _mm256_loadu_ps(p) }; }
+	};
+
+	BEZIERFIT_TARGET_AVX2 inline void store(float* p, F8 a) { _mm256_storeu_ps(p, a.v); }
+	BEZIERFIT_TARGET_AVX2 inline void load_xy(const float* p, F8& x, F8& y)
+	{
+		// The shuffles work within the 128-bit halves, which leaves the pairs of points in the order 0 1 4 5 2 3 6 7
+		__m256 a = _mm256_loadu_ps(p);
+		__m256 b = _mm256_loadu_ps(p + 8);
+		__m256 xs = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 ys = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		x = { _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0))) };
+		y = { _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(ys), _MM_SHUFFLE(3, 1, 2, 0))) };
+	}
+	BEZIERFIT_TARGET_AVX2 inline void store_xy(float* p, F8 x, F8 y)
+	{
+		// Points 0 1 4 5 and 2 3 6 7
+		__m256 lo = _mm256_unpacklo_ps(x.v, y.v);
+		__m256 hi = _mm256_unpackhi_ps(x.v, y.v);
+		_mm256_storeu_ps(p, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+	BEZIERFIT_TARGET_AVX2 inline F8 operator+(F8 a, F8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline F8 operator-(F8 a, F8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline F8 operator*(F8 a, F8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline F8 operator/(F8 a, F8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline F8 abs(F8 a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline F8 sqrt(F8 a) { return { _mm256_sqrt_ps(a.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline M8 operator>(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	BEZIERFIT_TARGET_AVX2 inline M8 operator>=(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	BEZIERFIT_TARGET_AVX2 inline M8 operator<=(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	BEZIERFIT_TARGET_AVX2 inline M8 operator&(M8 a, M8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline F8 select(M8 m, F8 a, F8 b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+
+	BEZIERFIT_TARGET_AVX2 inline I8 operator+(I8 a, I8 b) { return { _mm256_add_epi32(a.v, b.v) }; }
+	BEZIERFIT_TARGET_AVX2 inline void store(int* p, I8 a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a.v); }
+	BEZIERFIT_TARGET_AVX2 inline I8 select(M8 m, I8 a, I8 b) { return { _mm256_blendv_epi8(b.v, a.v, _mm256_castps_si256(m.v)) }; }
+
+	BEZIERFIT_TARGET_AVX2 inline float hsum(F8 a)
+	{
+		float v[8];
+		store(v, a);
+		return ((v[0] + v[1]) + (v[2] + v[3])) + ((v[4] + v[5]) + (v[6] + v[7]));
+	}
+#endif
+
+	// Bernstein basis functions of a cubic bezier curve
+	template<typename F>
+	struct Basis
+	{
+		F t0, t1, t2, t3;
+		BEZIERFIT_FORCE_INLINE Basis(F t)
+		{
+			F one = F::Set1(1.0f);
+			F three = F::Set1(3.0f);
+			F ti = one - t;
+			t0 = ti * ti * ti;
+			t1 = three * ti * ti * t;
+			t2 = three * ti * t * t;
+			t3 = t * t * t;
+		}
+	};
+
+	// Control points of a curve broadcast to all lanes
+	template<typename F>
+	struct CurveLanes
+	{
+		F p0x, p0y, p1x, p1y, p2x, p2y, p3x, p3y;
+		BEZIERFIT_FORCE_INLINE explicit CurveLanes(const CubicBezier2& curve)
+			: p0x(F::Set1(curve.p0.x)), p0y(F::Set1(curve.p0.y)), p1x(F::Set1(curve.p1.x)), p1y(F::Set1(curve.p1.y)),
+			p2x(F::Set1(curve.p2.x)), p2y(F::Set1(curve.p2.y)), p3x(F::Set1(curve.p3.x)), p3y(F::Set1(curve.p3.y))
+		{
+		}
+	};
+
+	// Running maximum of every lane with the first index at which it was reached
+	template<typename F>
+	struct LaneMax
+	{
+		using I = typename F::Int;
+		F max;
+		I maxIndex;
+		I index;
+
+		BEZIERFIT_FORCE_INLINE LaneMax() : max(F::Set1(0)), maxIndex(I::Set1(-1)), index(I::Iota()) {}
+
+		BEZIERFIT_FORCE_INLINE void Update(F d)
+		{
+			auto greater = d > max;
+			max = select(greater, d, max);
+			maxIndex = select(greater, index, maxIndex);
+			index = index + I::Set1(F::WIDTH);
+		}
+
+		// Every lane holds the first index of its own maximum, so ties between lanes go to the lowest index
+		BEZIERFIT_FORCE_INLINE void Reduce(float& result, int& resultIndex) const
+		{
+			float maxs[F::WIDTH];
+			int indices[F::WIDTH];
+			store(maxs, max);
+			store(indices, maxIndex);
+			for (int lane = 0; lane < F::WIDTH; lane++)
+			{
+				if (indices[lane] < 0)
+					continue;
+				if (maxs[lane] > result || (maxs[lane] == result && indices[lane] < resultIndex))
+				{
+					result = maxs[lane];
+					resultIndex = indices[lane];
+				}
+			}
+		}
+	};
+}
+#endif
+
+namespace {
+	// Point accessors for the kernels, so the same code can run on interleaved and separate component arrays
+	template<typename T, int N>
+	struct InterleavedPoints
+	{
+		const glm::vec<N, T>* pts;
+		glm::vec<N, T> Get(int i) const { return pts[i]; }
+#ifdef BEZIERFIT_SIMD
+		template<typename F>
+		BEZIERFIT_FORCE_INLINE void Load(int i, F& x, F& y) const { load_xy(reinterpret_cast<const float*>(pts + i), x, y); }
+#endif
+	};
+
+	template<typename T, int N>
+	struct SeparatePoints
+	{
+		typename BasicFitKernels<T, N>::ComponentArrays components;
+		glm::vec<N, T> Get(int i) const
+		{
+			glm::vec<N, T> p;
+			for (int c = 0; c < N; c++)
+				p[c] = components[c][i];
+			return p;
+		}
+#ifdef BEZIERFIT_SIMD
+		template<typename F>
+		BEZIERFIT_FORCE_INLINE void Load(int i, F& px, F& py) const
+		{
+			px = F::Load(components[0] + i);
+			py = F::Load(components[1] + i);
+		}
+#endif
+	};
+
+	// Numerator and denominator of the Newton-Raphson step for the parameter of p, with q = Q(t), q1 = Q'(t) and q2 = Q''(t).
+	// The terms are summed component by component in the same order for any dimension.
+	template<typename T, int N>
+	inline void get_newton_step(const glm::vec<N, T>& p, const glm::vec<N, T>& q, const glm::vec<N, T>& q1, const glm::vec<N, T>& q2, T& num, T& den)
+	{
+		glm::vec<N, T> d = q - p;
+		num = 0;
+		den = 0;
+		for (int c = 0; c < N; c++)
+			num += d[c] * q1[c];
+		for (int c = 0; c < N; c++)
+			den += q1[c] * q1[c];
+		for (int c = 0; c < N; c++)
+			den += d[c] * q2[c];
+	}
+
+#ifdef BEZIERFIT_SIMD
+	// SIMD parts of the kernels, processing F::WIDTH points per iteration. Run returns the number of points it processed;
+	// the callers continue with the scalar code from there.
+	struct LeastSquaresSimd
+	{
+		template<typename F, typename TPoints>
+		static BEZIERFIT_FORCE_INLINE int Run(const TPoints& pts, const float* u, int count, const Vector2& p0, const Vector2& p3, const Vector2& tanL, const Vector2& tanR,
+			LeastSquaresSums2& sums)
+		{
+			if (count < F::WIDTH)
+				return 0;
+			F p0x = F::Set1(p0.x), p0y = F::Set1(p0.y), p3x = F::Set1(p3.x), p3y = F::Set1(p3.y);
+			F tLx = F::Set1(tanL.x), tLy = F::Set1(tanL.y), tRx = F::Set1(tanR.x), tRy = F::Set1(tanR.y);
+			F c00 = F::Set1(0), c01 = F::Set1(0), c11 = F::Set1(0), x0 = F::Set1(0), x1 = F::Set1(0);
+			int i = 0;
+			for (; i + F::WIDTH <= count; i += F::WIDTH)
+			{
+				Basis<F> b { F::Load(u + i) };
+				F px, py;
+				pts.Load(i, px, py);
+
+				// v = p - Q(t) with p1 = p0 and p2 = p3
+				F w0 = b.t0 + b.t1;
+				F w3 = b.t2 + b.t3;
+				F vx = px - (p0x * w0 + p3x * w3);
+				F vy = py - (p0y * w0 + p3y * w3);
+
+				F a0x = tLx * b.t1, a0y = tLy * b.t1;
+				F a1x = tRx * b.t2, a1y = tRy * b.t2;
+				c00 = c00 + (a0x * a0x + a0y * a0y);
+				c01 = c01 + (a0x * a1x + a0y * a1y);
+				c11 = c11 + (a1x * a1x + a1y * a1y);
+				x0 = x0 + (a0x * vx + a0y * vy);
+				x1 = x1 + (a1x * vx + a1y * vy);
+			}
+			sums = { hsum(c00), hsum(c01), hsum(c11), hsum(x0), hsum(x1) };
+			return i;
+		}
+	};
+
+	struct ReparameterizeSimd
+	{
+		template<typename F, typename TPoints>
+		static BEZIERFIT_FORCE_INLINE int Run(const TPoints& pts, float* u, int count, const CubicBezier2& curve,
+			const Vector2& qp0, const Vector2& qp1, const Vector2& qp2, const Vector2& qpp0, const Vector2& qpp1)
+		{
+			if (count < F::WIDTH)
+				return 0;
+			CurveLanes<F> c { curve };
+			F q0x = F::Set1(qp0.x), q0y = F::Set1(qp0.y), q1x = F::Set1(qp1.x), q1y = F::Set1(qp1.y), q2x = F::Set1(qp2.x), q2y = F::Set1(qp2.y);
+			F qq0x = F::Set1(qpp0.x), qq0y = F::Set1(qpp0.y), qq1x = F::Set1(qpp1.x), qq1y = F::Set1(qpp1.y);
+			F zero = F::Set1(0), one = F::Set1(1), two = F::Set1(2), eps = F::Set1(std::numeric_limits<float>::epsilon());
+			int i = 0;
+			for (; i + F::WIDTH <= count; i += F::WIDTH)
+			{
+				F t = F::Load(u + i);
+				Basis<F> b { t };
+				F ti = one - t;
+				F px, py;
+				pts.Load(i, px, py);
+
+				// Evaluate Q(t), Q'(t), and Q''(t)
+				F dx = (b.t0 * c.p0x + b.t1 * c.p1x + b.t2 * c.p2x + b.t3 * c.p3x) - px;
+				F dy = (b.t0 * c.p0y + b.t1 * c.p1y + b.t2 * c.p2y + b.t3 * c.p3y) - py;
+				F w0 = ti * ti, w1 = two * ti * t, w2 = t * t;
+				F d1x = w0 * q0x + w1 * q1x + w2 * q2x;
+				F d1y = w0 * q0y + w1 * q1y + w2 * q2y;
+				F d2x = ti * qq0x + t * qq1x;
+				F d2y = ti * qq0y + t * qq1y;
+
+				F num = dx * d1x + dy * d1y;
+				F den = d1x * d1x + d1y * d1y + dx * d2x + dy * d2y;
+				F newU = t - num / den;
+				auto accept = (abs(den) > eps) & (newU >= zero) & (newU <= one);
+				store(u + i, select(accept, newU, t));
+			}
+			return i;
+		}
+	};
+
+	struct MaxSquaredErrorSimd
+	{
+		template<typename F, typename TPoints>
+		static BEZIERFIT_FORCE_INLINE int Run(const TPoints& pts, const float* u, int count, const CubicBezier2& curve, float& max, int& maxIndex)
+		{
+			if (count < F::WIDTH)
+				return 0;
+			CurveLanes<F> c { curve };
+			LaneMax<F> laneMax;
+			int i = 0;
+			for (; i + F::WIDTH <= count; i += F::WIDTH)
+			{
+				Basis<F> b { F::Load(u + i) };
+				F px, py;
+				pts.Load(i, px, py);
+				F dx = px - (b.t0 * c.p0x + b.t1 * c.p1x + b.t2 * c.p2x + b.t3 * c.p3x);
+				F dy = py - (b.t0 * c.p0y + b.t1 * c.p1y + b.t2 * c.p2y + b.t3 * c.p3y);
+				laneMax.Update(dx * dx + dy * dy);
+			}
+			laneMax.Reduce(max, maxIndex);
+			return i;
+		}
+	};
+
+	struct FusedIterationSimd
+	{
+		template<typename F, typename TPoints>
+		static BEZIERFIT_FORCE_INLINE int Run(const TPoints& pts, float* u, int count, const CubicBezier2& curve,
+			const Vector2& qp0, const Vector2& qp1, const Vector2& qp2, const Vector2& qpp0, const Vector2& qpp1, const Vector2& tanL, const Vector2& tanR,
+			LeastSquaresSums2& sums, float& max, int& maxIndex)
+		{
+			if (count < F::WIDTH)
+				return 0;
+			CurveLanes<F> c { curve };
+			F q0x = F::Set1(qp0.x), q0y = F::Set1(qp0.y), q1x = F::Set1(qp1.x), q1y = F::Set1(qp1.y), q2x = F::Set1(qp2.x), q2y = F::Set1(qp2.y);
+			F qq0x = F::Set1(qpp0.x), qq0y = F::Set1(qpp0.y), qq1x = F::Set1(qpp1.x), qq1y = F::Set1(qpp1.y);
+			F tLx = F::Set1(tanL.x), tLy = F::Set1(tanL.y), tRx = F::Set1(tanR.x), tRy = F::Set1(tanR.y);
+			F zero = F::Set1(0), one = F::Set1(1), two = F::Set1(2), eps = F::Set1(std::numeric_limits<float>::epsilon());
+			F c00 = zero, c01 = zero, c11 = zero, x0 = zero, x1 = zero;
+			LaneMax<F> laneMax;
+			int i = 0;
+			for (; i + F::WIDTH <= count; i += F::WIDTH)
+			{
+				F t = F::Load(u + i);
+				Basis<F> b { t };
+				F ti = one - t;
+				F px, py;
+				pts.Load(i, px, py);
+
+				// Q(t) - p, shared by the error and the Newton step
+				F dx = (b.t0 * c.p0x + b.t1 * c.p1x + b.t2 * c.p2x + b.t3 * c.p3x) - px;
+				F dy = (b.t0 * c.p0y + b.t1 * c.p1y + b.t2 * c.p2y + b.t3 * c.p3y) - py;
+				laneMax.Update(dx * dx + dy * dy);
+
+				F w0 = ti * ti, w1 = two * ti * t, w2 = t * t;
+				F d1x = w0 * q0x + w1 * q1x + w2 * q2x;
+				F d1y = w0 * q0y + w1 * q1y + w2 * q2y;
+				F d2x = ti * qq0x + t * qq1x;
+				F d2y = ti * qq0y + t * qq1y;
+				F num = dx * d1x + dy * d1y;
+				F den = d1x * d1x + d1y * d1y + dx * d2x + dy * d2y;
+				F newU = t - num / den;
+				auto accept = (abs(den) > eps) & (newU >= zero) & (newU <= one);
+				t = select(accept, newU, t);
+				store(u + i, t);
+
+				// Least-squares terms for the updated parameter
+				Basis<F> nb { t };
+				F s0 = nb.t0 + nb.t1;
+				F s3 = nb.t2 + nb.t3;
+				F vx = px - (c.p0x * s0 + c.p3x * s3);
+				F vy = py - (c.p0y * s0 + c.p3y * s3);
+				F a0x = tLx * nb.t1, a0y = tLy * nb.t1;
+				F a1x = tRx * nb.t2, a1y = tRy * nb.t2;
+				c00 = c00 + (a0x * a0x + a0y * a0y);
+				c01 = c01 + (a0x * a1x + a0y * a1y);
+				c11 = c11 + (a1x * a1x + a1y * a1y);
+				x0 = x0 + (a0x * vx + a0y * vy);
+				x1 = x1 + (a1x * vx + a1y * vy);
+			}
+			sums = { hsum(c00), hsum(c01), hsum(c11), hsum(x0), hsum(x1) };
+			laneMax.Reduce(max, maxIndex);
+			return i;
+		}
+	};
+
+	struct SampleCurveSimd
+	{
+		template<typename F>
+		static BEZIERFIT_FORCE_INLINE int Run(const CubicBezier2& curve, const float* t, int count, Vector2* out)
+		{
+			if (count < F::WIDTH)
+				return 0;
+			CurveLanes<F> c { curve };
+			int i = 0;
+			for (; i + F::WIDTH <= count; i += F::WIDTH)
+			{
+				Basis<F> b { F::Load(t + i) };
+				F x = b.t0 * c.p0x + b.t1 * c.p1x + b.t2 * c.p2x + b.t3 * c.p3x;
+				F y = b.t0 * c.p0y + b.t1 * c.p1y + b.t2 * c.p2y + b.t3 * c.p3y;
+				store_xy(reinterpret_cast<float*>(out + i), x, y);
+			}
+			return i;
+		}
+	};
+
+	struct SampleTangentsSimd
+	{
+		template<typename F>
+		static BEZIERFIT_FORCE_INLINE int Run(const CubicBezier2& curve, const float* t, int count, Vector2* out)
+		{
+			if (count < F::WIDTH)
+				return 0;
+			// Control vertices of the derivative (without the factor 3, which the normalization removes)
+			Vector2 d0 = curve.p1 - curve.p0;
+			Vector2 d1 = curve.p2 - curve.p1;
+			Vector2 d2 = curve.p3 - curve.p2;
+			F d0x = F::Set1(d0.x), d0y = F::Set1(d0.y), d1x = F::Set1(d1.x), d1y = F::Set1(d1.y), d2x = F::Set1(d2.x), d2y = F::Set1(d2.y);
+			F one = F::Set1(1), two = F::Set1(2);
+			int i = 0;
+			for (; i + F::WIDTH <= count; i += F::WIDTH)
+			{
+				F tt = F::Load(t + i);
+				F ti = one - tt;
+				F w0 = ti * ti, w1 = two * ti * tt, w2 = tt * tt;
+				F x = w0 * d0x + w1 * d1x + w2 * d2x;
+				F y = w0 * d0y + w1 * d1y + w2 * d2y;
+				F len = sqrt(x * x + y * y);
+				store_xy(reinterpret_cast<float*>(out + i), x / len, y / len);
+			}
+			return i;
+		}
+	};
+
+	// Whether BasicFitKernels<T, N> has SIMD kernels
+	template<typename T, int N>
+	constexpr bool HAS_SIMD_KERNELS = std::is_same_v<T, float> && N == 2;
+
+#ifdef BEZIERFIT_SIMD_AVX2
+	// The only functions compiled for AVX2; the kernel and the wrappers are inlined into them
+	template<typename TKernel, typename... TArgs>
+	BEZIERFIT_TARGET_AVX2 int run_avx2(TArgs&&... args)
+	{
+		return TKernel::template Run<F8>(args...);
+	}
+#endif
+
+	// Runs the SIMD part of TKernel with the lanes of the selected backend and returns the number of points it processed
+	template<typename TKernel, typename... TArgs>
+	int run_simd(TArgs&&... args)
+	{
+		FitKernels::Backend backend = FitKernels::GetBackend();
+#ifdef BEZIERFIT_SIMD_AVX2
+		if (backend == FitKernels::Backend::Avx2)
+			return run_avx2<TKernel>(args...);
+#endif
+		if (backend == FitKernels::Backend::Simd)
+			return TKernel::template Run<F4>(args...);
+		return 0;
+	}
+#endif
+
+	template<typename T, int N, typename TPoints>
+	typename BasicFitKernels<T, N>::LeastSquaresSums accumulate_least_squares(const TPoints& pts, const T* u, int count, glm::vec<N, T> p0, glm::vec<N, T> p3,
+		glm::vec<N, T> tanL, glm::vec<N, T> tanR)
+	{
+		using Vector = glm::vec<N, T>;
+		typename BasicFitKernels<T, N>::LeastSquaresSums sums { 0, 0, 0, 0, 0 };
+		int i = 0;
+#ifdef BEZIERFIT_SIMD
+		if constexpr (HAS_SIMD_KERNELS<T, N>)
+			i = run_simd<LeastSquaresSimd>(pts, u, count, p0, p3, tanL, tanR, sums);
+#endif
+		for (; i < count; i++)
+		{
+			// Calculate cubic bezier multipliers
+			T t = u[i];
+			T ti = 1 - t;
+			T t0 = ti * ti * ti;
+			T t1 = 3 * ti * ti * t;
+			T t2 = 3 * ti * t * t;
+			T t3 = t * t * t;
+
+			// For X matrix; moving this up here since profiling shows it's better up here (maybe a0/a1 not in registers vs only v not in regs)
+			Vector s = (p0 * t0) + (p0 * t1) + (p3 * t2) + (p3 * t3); // NOTE: this would be Q(t) if p1=p0 and p2=p3
+			Vector v = pts.Get(i) - s;
+
+			// C matrix
+			Vector a0 = tanL * t1;
+			Vector a1 = tanR * t2;
+			sums.c00 += BasicVectorHelper<T, N>::Dot(a0, a0);
+			sums.c01 += BasicVectorHelper<T, N>::Dot(a0, a1);
+			sums.c11 += BasicVectorHelper<T, N>::Dot(a1, a1);
+
+			// X matrix
+			sums.x0 += BasicVectorHelper<T, N>::Dot(a0, v);
+			sums.x1 += BasicVectorHelper<T, N>::Dot(a1, v);
+		}
+		return sums;
+	}
+
+	template<typename T, int N, typename TPoints>
+	void reparameterize(const TPoints& pts, T* u, int count, const BasicCubicBezier<T, N>& curve)
+	{
+		using Vector = glm::vec<N, T>;
+
+		// Control vertices for Q'
+		Vector qp0 = (curve.p1 - curve.p0) * T(3);
+		Vector qp1 = (curve.p2 - curve.p1) * T(3);
+		Vector qp2 = (curve.p3 - curve.p2) * T(3);
+
+		// Control vertices for Q''
+		Vector qpp0 = (qp1 - qp0) * T(2);
+		Vector qpp1 = (qp2 - qp1) * T(2);
+
+		int i = 0;
+#ifdef BEZIERFIT_SIMD
+		if constexpr (HAS_SIMD_KERNELS<T, N>)
+			i = run_simd<ReparameterizeSimd>(pts, u, count, curve, qp0, qp1, qp2, qpp0, qpp1);
+#endif
+		for (; i < count; i++)
+		{
+			Vector p = pts.Get(i);
+			T t = u[i];
+			T ti = 1 - t;
+
+			// Evaluate Q(t), Q'(t), and Q''(t)
+			Vector p0 = curve.Sample(t);
+			Vector p1 = ((ti * ti) * qp0) + ((2 * ti * t) * qp1) + ((t * t) * qp2);
+			Vector p2 = (ti * qpp0) + (t * qpp1);
+
+			// these are the actual fitting calculations using http://en.wikipedia.org/wiki/Newton%27s_method
+			T num, den;
+			get_newton_step(p, p0, p1, p2, num, den);
+			T newU = t - num / den;
+			if (std::abs(den) > std::numeric_limits<T>::epsilon() && newU >= 0 && newU <= 1)
+				u[i] = newU;
+		}
+	}
+
+	template<typename T, int N, typename TPoints>
+	T find_max_squared_error(const TPoints& pts, const T* u, int count, const BasicCubicBezier<T, N>& curve, int& maxIndex)
+	{
+		using Vector = glm::vec<N, T>;
+		T max = 0;
+		int i = 0;
+#ifdef BEZIERFIT_SIMD
+		if constexpr (HAS_SIMD_KERNELS<T, N>)
+			i = run_simd<MaxSquaredErrorSimd>(pts, u, count, curve, max, maxIndex);
+#endif
+		for (; i < count; i++)
+		{
+			Vector v0 = pts.Get(i);
+			Vector v1 = curve.Sample(u[i]);
+			T d = BasicVectorHelper<T, N>::DistanceSquared(v0, v1);
+			if (d > max)
+			{
+				max = d;
+				maxIndex = i;
+			}
+		}
+		return max;
+	}
+
+	template<typename T, int N, typename TPoints>
+	T fused_iteration(const TPoints& pts, T* u, int count, const BasicCubicBezier<T, N>& curve, int& maxIndex, glm::vec<N, T> tanL, glm::vec<N, T> tanR,
+		typename BasicFitKernels<T, N>::LeastSquaresSums& sums)
+	{
+		using Vector = glm::vec<N, T>;
+
+		// Control vertices for Q'
+		Vector qp0 = (curve.p1 - curve.p0) * T(3);
+		Vector qp1 = (curve.p2 - curve.p1) * T(3);
+		Vector qp2 = (curve.p3 - curve.p2) * T(3);
+
+		// Control vertices for Q''
+		Vector qpp0 = (qp1 - qp0) * T(2);
+		Vector qpp1 = (qp2 - qp1) * T(2);
+
+		Vector p0 = curve.p0;
+		Vector p3 = curve.p3;
+		T max = 0;
+		sums = { 0, 0, 0, 0, 0 };
+		int i = 0;
+#ifdef BEZIERFIT_SIMD
+		if constexpr (HAS_SIMD_KERNELS<T, N>)
+			i = run_simd<FusedIterationSimd>(pts, u, count, curve, qp0, qp1, qp2, qpp0, qpp1, tanL, tanR, sums, max, maxIndex);
+#endif
+		for (; i < count; i++)
+		{
+			Vector p = pts.Get(i);
+			T t = u[i];
+			T ti = 1 - t;
+
+			// Error of the current curve, see find_max_squared_error
+			Vector q = curve.Sample(t);
+			T d = BasicVectorHelper<T, N>::DistanceSquared(p, q);
+			if (d > max)
+			{
+				max = d;
+				maxIndex = i;
+			}
+
+			// Newton-Raphson step reusing Q(t), see reparameterize
+			Vector q1 = ((ti * ti) * qp0) + ((2 * ti * t) * qp1) + ((t * t) * qp2);
+			Vector q2 = (ti * qpp0) + (t * qpp1);
+			T num, den;
+			get_newton_step(p, q, q1, q2, num, den);
+			T newU = t - num / den;
+			if (std::abs(den) > std::numeric_limits<T>::epsilon() && newU >= 0 && newU <= 1)
+			{
+				u[i] = newU;
+				t = newU;
+				ti = 1 - t;
+			}
+
+			// Least-squares terms for the updated parameter, see accumulate_least_squares
+			T t0 = ti * ti * ti;
+			T t1 = 3 * ti * ti * t;
+			T t2 = 3 * ti * t * t;
+			T t3 = t * t * t;
+			Vector s = (p0 * t0) + (p0 * t1) + (p3 * t2) + (p3 * t3);
+			Vector v = p - s;
+			Vector a0 = tanL * t1;
+			Vector a1 = tanR * t2;
+			sums.c00 += BasicVectorHelper<T, N>::Dot(a0, a0);
+			sums.c01 += BasicVectorHelper<T, N>::Dot(a0, a1);
+			sums.c11 += BasicVectorHelper<T, N>::Dot(a1, a1);
+			sums.x0 += BasicVectorHelper<T, N>::Dot(a0, v);
+			sums.x1 += BasicVectorHelper<T, N>::Dot(a1, v);
+		}
+		return max;
+	}
+
+	template<typename T, int N>
+	void sample_curve(const BasicCubicBezier<T, N>& curve, const T* t, int count, glm::vec<N, T>* out)
+	{
+		int i = 0;
+#ifdef BEZIERFIT_SIMD
+		if constexpr (HAS_SIMD_KERNELS<T, N>)
+			i = run_simd<SampleCurveSimd>(curve, t, count, out);
+#endif
+		for (; i < count; i++)
+			out[i] = curve.Sample(t[i]);
+	}
+
+	template<typename T, int N>
+	void sample_tangents(const BasicCubicBezier<T, N>& curve, const T* t, int count, glm::vec<N, T>* out)
+	{
+		int i = 0;
+#ifdef BEZIERFIT_SIMD
+		if constexpr (HAS_SIMD_KERNELS<T, N>)
+			i = run_simd<SampleTangentsSimd>(curve, t, count, out);
+#endif
+		for (; i < count; i++)
+			out[i] = curve.Tangent(t[i]);
+	}
+}
+
+template<typename T, int N>
+typename BasicFitKernels<T, N>::LeastSquaresSums BasicFitKernels<T, N>::AccumulateLeastSquares(const Vector* pts, const T* u, int count, Vector p0, Vector p3, Vector tanL, Vector tanR)
+{
+	return accumulate_least_squares(InterleavedPoints<T, N> { pts }, u, count, p0, p3, tanL, tanR);
+}
+
+template<typename T, int N>
+typename BasicFitKernels<T, N>::LeastSquaresSums BasicFitKernels<T, N>::AccumulateLeastSquares(const ComponentArrays& pts, const T* u, int count, Vector p0, Vector p3, Vector tanL, Vector tanR)
+{
+	return accumulate_least_squares(SeparatePoints<T, N> { pts }, u, count, p0, p3, tanL, tanR);
+}
+
+template<typename T, int N>
+void BasicFitKernels<T, N>::Reparameterize(const Vector* pts, T* u, int count, const CubicBezier& curve)
+{
+	reparameterize(InterleavedPoints<T, N> { pts }, u, count, curve);
+}
+
+template<typename T, int N>
+void BasicFitKernels<T, N>::Reparameterize(const ComponentArrays& pts, T* u, int count, const CubicBezier& curve)
+{
+	reparameterize(SeparatePoints<T, N> { pts }, u, count, curve);
+}
+
+template<typename T, int N>
+T BasicFitKernels<T, N>::FindMaxSquaredError(const Vector* pts, const T* u, int count, const CubicBezier& curve, int& maxIndex)
+{
+	return find_max_squared_error(InterleavedPoints<T, N> { pts }, u, count, curve, maxIndex);
+}
+
+template<typename T, int N>
+T BasicFitKernels<T, N>::FindMaxSquaredError(const ComponentArrays& pts, const T* u, int count, const CubicBezier& curve, int& maxIndex)
+{
+	return find_max_squared_error(SeparatePoints<T, N> { pts }, u, count, curve, maxIndex);
+}
+
+template<typename T, int N>
+T BasicFitKernels<T, N>::FusedIteration(const Vector* pts, T* u, int count, const CubicBezier& curve, int& maxIndex, Vector tanL, Vector tanR, LeastSquaresSums& sums)
+{
+	return fused_iteration(InterleavedPoints<T, N> { pts }, u, count, curve, maxIndex, tanL, tanR, sums);
+}
+
+template<typename T, int N>
+T BasicFitKernels<T, N>::FusedIteration(const ComponentArrays& pts, T* u, int count, const CubicBezier& curve, int& maxIndex, Vector tanL, Vector tanR, LeastSquaresSums& sums)
+{
+	return fused_iteration(SeparatePoints<T, N> { pts }, u, count, curve, maxIndex, tanL, tanR, sums);
+}
+
+template<typename T, int N>
+void BasicFitKernels<T, N>::SampleCurve(const CubicBezier& curve, const T* t, int count, Vector* out)
+{
+	sample_curve(curve, t, count, out);
+}
+
+template<typename T, int N>
+void BasicFitKernels<T, N>::SampleTangents(const CubicBezier& curve, const T* t, int count, Vector* out)
+{
+	sample_tangents(curve, t, count, out);
+}
+
+template class bezierfit::BasicFitKernels<float, 2>;
+template class bezierfit::BasicFitKernels<float, 3>;
+template class bezierfit::BasicFitKernels<double, 2>;
+template class bezierfit::BasicFitKernels<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicFitKernels<FLOAT, 4>;
+#endif
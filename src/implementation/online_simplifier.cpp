@@ -0,0 +1,190 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :online_simplifier;
+
+using namespace bezierfit;
+
+namespace {
+	template<typename T, int N>
+	inline T cross_2d(const glm::vec<N, T>& a, const glm::vec<N, T>& b) { return a.x * b.y - a.y * b.x; }
+
+	// The 2D test splits the tolerance between the distance from the line through the anchor and the distance by which a
+	// point may lie beyond the end of the segment, so that both together stay within the tolerance
+	template<typename T>
+	constexpr T TOLERANCE_SPLIT = T(0.70710678118654752);
+}
+
+template<typename T, int N>
+BasicOnlineSimplifier<T, N>::BasicOnlineSimplifier(T tolerance, int maxLookahead, std::pmr::memory_resource* resource)
+	: _tolerance(tolerance), _maxLookahead(maxLookahead), _window(resource)
+{
+	if (tolerance < 0)
+		throw std::invalid_argument("tolerance cannot be negative");
+	if (maxLookahead < 1)
+		throw std::invalid_argument("maxLookahead must be at least 1");
+	if constexpr (N != 2)
+		_window.reserve(maxLookahead);
+}
+
+template<typename T, int N>
+T BasicOnlineSimplifier<T, N>::GetTolerance() const { return _tolerance; }
+template<typename T, int N>
+int BasicOnlineSimplifier<T, N>::GetMaxLookahead() const { return _maxLookahead; }
+template<typename T, int N>
+int BasicOnlineSimplifier<T, N>::GetPendingCount() const { return _pending; }
+
+template<typename T, int N>
+void BasicOnlineSimplifier<T, N>::BeginSegment(const Vector& p)
+{
+	_last = p;
+	_pending = 1;
+	if constexpr (N == 2)
+	{
+		Vector v = p - _anchor;
+		_hasWedge = false;
+		_maxDistance = glm::length(v);
+		AddToWedge(v, _maxDistance);
+	}
+	else
+	{
+		_window.clear();
+		_window.push_back(p);
+	}
+}
+
+template<typename T, int N>
+bool BasicOnlineSimplifier<T, N>::ExtendSegment(const Vector& p)
+{
+	if constexpr (N == 2)
+	{
+		// If p lies inside the wedge, every collected point is close to the line through the anchor and p, and if none of
+		// them is much farther from the anchor than p, they are also close to the segment
+		Vector v = p - _anchor;
+		if (_hasWedge && (cross_2d(_right, v) < 0 || cross_2d(v, _left) < 0))
+			return false;
+		T distance = glm::length(v);
+		if (distance < _maxDistance - _tolerance * TOLERANCE_SPLIT<T>)
+			return false;
+		_maxDistance = std::max(_maxDistance, distance);
+		AddToWedge(v, distance);
+	}
+	else
+	{
+		if (!FitsSegment(p))
+			return false;
+		_window.push_back(p);
+	}
+	_last = p;
+	++_pending;
+	return true;
+}
+
+template<typename T, int N>
+void BasicOnlineSimplifier<T, N>::AddToWedge(const Vector& v, T distance)
+{
+	if constexpr (N == 2)
+	{
+		T tolerance = _tolerance * TOLERANCE_SPLIT<T>;
+		if (distance <= tolerance)
+			return;
+		// Directions whose line passes within the tolerance of v: v rotated by up to asin(tolerance / |v|) either way
+		Vector dir = v / distance;
+		T s = tolerance / distance;
+		T c = std::sqrt(1 - s * s);
+		Vector left = dir;
+		left.x = c * dir.x - s * dir.y;
+		left.y = s * dir.x + c * dir.y;
+		Vector right = dir;
+		right.x = c * dir.x + s * dir.y;
+		right.y = c * dir.y - s * dir.x;
+		if (!_hasWedge)
+		{
+			_left = left;
+			_right = right;
+			_hasWedge = true;
+			return;
+		}
+		if (cross_2d(_left, left) < 0)
+			_left = left;
+		if (cross_2d(_right, right) > 0)
+			_right = right;
+	}
+}
+
+template<typename T, int N>
+bool BasicOnlineSimplifier<T, N>::FitsSegment(const Vector& end) const
+{
+	// Distance to the segment rather than the line, so points that run back past the anchor aren't dropped
+	Vector dir = end - _anchor;
+	T lenSq = glm::dot(dir, dir);
+	T toleranceSq = _tolerance * _tolerance;
+	for (auto& p : _window)
+	{
+		Vector v = p - _anchor;
+		T t = lenSq > 0 ? std::clamp(glm::dot(v, dir) / lenSq, T(0), T(1)) : T(0);
+		Vector d = v - dir * t;
+		if (glm::dot(d, d) > toleranceSq)
+			return false;
+	}
+	return true;
+}
+
+template<typename T, int N>
+bool BasicOnlineSimplifier<T, N>::Add(const Vector& p, Vector& kept)
+{
+	if (!_started)
+	{
+		_started = true;
+		_anchor = p;
+		kept = p;
+		return true;
+	}
+	if (_pending == 0)
+	{
+		BeginSegment(p);
+		return false;
+	}
+	if (_pending < _maxLookahead && ExtendSegment(p))
+		return false;
+	// The previous point was within tolerance for all points before it, so it ends the simplified segment
+	_anchor = _last;
+	kept = _anchor;
+	BeginSegment(p);
+	return true;
+}
+
+template<typename T, int N>
+bool BasicOnlineSimplifier<T, N>::Finish(Vector& kept)
+{
+	bool hasPending = _pending > 0;
+	if (hasPending)
+		kept = _last;
+	Reset();
+	return hasPending;
+}
+
+template<typename T, int N>
+void BasicOnlineSimplifier<T, N>::Reset()
+{
+	_started = false;
+	_anchor = Vector(0);
+	_last = Vector(0);
+	_pending = 0;
+	_hasWedge = false;
+	_maxDistance = 0;
+	_window.clear();
+}
+
+template class bezierfit::BasicOnlineSimplifier<float, 2>;
+template class bezierfit::BasicOnlineSimplifier<float, 3>;
+template class bezierfit::BasicOnlineSimplifier<double, 2>;
+template class bezierfit::BasicOnlineSimplifier<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicOnlineSimplifier<FLOAT, 4>;
+#endif
@@ -0,0 +1,181 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <cassert>
+
+module bezierfit;
+
+import :point_buffer;
+
+using namespace bezierfit;
+
+template<typename T, int N>
+BasicPointBuffer<T, N>::BasicPointBuffer(std::pmr::memory_resource* resource)
+	: _resource(resource)
+{
+}
+
+template<typename T, int N>
+BasicPointBuffer<T, N>::BasicPointBuffer(std::span<const Vector> points, std::pmr::memory_resource* resource)
+	: _resource(resource)
+{
+	Assign(points);
+}
+
+template<typename T, int N>
+BasicPointBuffer<T, N>::BasicPointBuffer(BasicPointBuffer&& other) noexcept
+	: _resource(other._resource), _data(other._data), _size(other._size), _capacity(other._capacity)
+{
+	other._data = nullptr;
+	other._size = 0;
+	other._capacity = 0;
+}
+
+template<typename T, int N>
+BasicPointBuffer<T, N>& BasicPointBuffer<T, N>::operator=(BasicPointBuffer&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+	Release();
+	_resource = other._resource;
+	_data = other._data;
+	_size = other._size;
+	_capacity = other._capacity;
+	other._data = nullptr;
+	other._size = 0;
+	other._capacity = 0;
+	return *this;
+}
+
+template<typename T, int N>
+BasicPointBuffer<T, N>::~BasicPointBuffer() { Release(); }
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::Assign(std::span<const Vector> points)
+{
+	Clear();
+	Reserve(points.size());
+	for (int c = 0; c < N; c++)
+	{
+		T* dst = GetComponent(c);
+		for (size_t i = 0; i < points.size(); i++)
+			dst[i] = points[i][c];
+	}
+	_size = points.size();
+}
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::AssignInterleaved(std::span<const T> data, size_t stride)
+{
+	if (stride < N)
+		throw std::invalid_argument("stride must be at least " + std::to_string(N));
+	Clear();
+	// The last point only needs its own components to be present
+	size_t count = data.size() < N ? 0 : (data.size() - N) / stride + 1;
+	Reserve(count);
+	for (int c = 0; c < N; c++)
+	{
+		T* dst = GetComponent(c);
+		const T* src = data.data() + c;
+		for (size_t i = 0; i < count; i++, src += stride)
+			dst[i] = *src;
+	}
+	_size = count;
+}
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::PushBack(const Vector& p)
+{
+	if (_size == _capacity)
+		Grow(_size + 1);
+	for (int c = 0; c < N; c++)
+		GetComponent(c)[_size] = p[c];
+	++_size;
+}
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::Reserve(size_t count)
+{
+	if (count > _capacity)
+		Grow(count);
+}
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::Clear()
+{
+	// Keep the padding at zero
+	for (int c = 0; c < N && _data; c++)
+		std::fill_n(GetComponent(c), _size, T(0));
+	_size = 0;
+}
+
+template<typename T, int N>
+size_t BasicPointBuffer<T, N>::Size() const { return _size; }
+template<typename T, int N>
+bool BasicPointBuffer<T, N>::Empty() const { return _size == 0; }
+
+template<typename T, int N>
+glm::vec<N, T> BasicPointBuffer<T, N>::operator[](size_t i) const
+{
+	assert(i < _size);
+	Vector p;
+	for (int c = 0; c < N; c++)
+		p[c] = Component(c)[i];
+	return p;
+}
+
+template<typename T, int N>
+glm::vec<N, T> BasicPointBuffer<T, N>::Back() const { return (*this)[_size - 1]; }
+
+template<typename T, int N>
+const T* BasicPointBuffer<T, N>::Component(int component) const
+{
+	assert(component >= 0 && component < N);
+	return _data + component * _capacity;
+}
+
+template<typename T, int N>
+const T* BasicPointBuffer<T, N>::X() const { return Component(0); }
+template<typename T, int N>
+const T* BasicPointBuffer<T, N>::Y() const { return Component(1); }
+
+template<typename T, int N>
+T* BasicPointBuffer<T, N>::GetComponent(int component) { return _data + component * _capacity; }
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::Grow(size_t minCapacity)
+{
+	size_t capacity = std::max(minCapacity, _capacity * 2);
+	capacity = (capacity + PADDING - 1) / PADDING * PADDING;
+	auto* data = static_cast<T*>(_resource->allocate(capacity * N * sizeof(T), ALIGNMENT));
+	for (int c = 0; c < N; c++)
+	{
+		T* dst = data + c * capacity;
+		if (_data)
+			std::copy_n(GetComponent(c), _size, dst);
+		std::fill(dst + _size, dst + capacity, T(0));
+	}
+	Release();
+	_data = data;
+	_capacity = capacity;
+}
+
+template<typename T, int N>
+void BasicPointBuffer<T, N>::Release()
+{
+	if (_data)
+		_resource->deallocate(_data, _capacity * N * sizeof(T), ALIGNMENT);
+	_data = nullptr;
+	_capacity = 0;
+}
+
+template class bezierfit::BasicPointBuffer<float, 2>;
+template class bezierfit::BasicPointBuffer<float, 3>;
+template class bezierfit::BasicPointBuffer<double, 2>;
+template class bezierfit::BasicPointBuffer<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicPointBuffer<FLOAT, 4>;
+#endif
@@ -0,0 +1,144 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :preprocess_pipeline;
+import :curve_preprocess;
+
+using namespace bezierfit;
+
+PreprocessPipeline::PreprocessPipeline(const FitOptions& options, std::pmr::memory_resource* resource)
+	: _points(resource), _stack(resource), _nodes(resource), _heap(resource)
+{
+	SetOptions(options);
+}
+
+const FitOptions& PreprocessPipeline::GetOptions() const { return _options; }
+
+void PreprocessPipeline::SetOptions(const FitOptions& options)
+{
+	if (options.linearizeDistance < 0)
+		throw std::invalid_argument("linearizeDistance cannot be negative");
+	if (options.linearizeDistance > 0 && options.linearizeDistance <= CurvePreprocess::EPSILON)
+		throw std::invalid_argument("linearizeDistance must be 0 or greater than epsilon");
+	if (options.reduceTolerance < 0)
+		throw std::invalid_argument("reduceTolerance cannot be negative");
+	_options = options;
+	Reset();
+}
+
+void PreprocessPipeline::Process(const VECTOR& p, StreamState& state, std::pmr::vector<VECTOR>& dst) const
+{
+	if (!state.started)
+	{
+		state.started = true;
+		state.prev = p;
+		state.lastEmitted = p;
+		dst.push_back(p);
+		return;
+	}
+	if (_options.removeDuplicates && glm::all(glm::gtc::epsilonEqual(state.prev, p, CurvePreprocess::EPSILON)))
+		return;
+	if (_options.linearizeDistance > 0)
+		Linearize(p, state, dst);
+	else
+		dst.push_back(p);
+	state.prev = p;
+}
+
+// Same steps as CurvePreprocess::Linearize for the segment from state.prev to p
+void PreprocessPipeline::Linearize(const VECTOR& p, StreamState& state, std::pmr::vector<VECTOR>& dst) const
+{
+	FLOAT md = _options.linearizeDistance;
+	const VECTOR& p0 = state.prev;
+	FLOAT td = glm::distance(p0, p);
+	if (state.distance + td > md)
+	{
+		FLOAT pd = md - state.distance;
+		dst.push_back(glm::mix(p0, p, pd / td));
+		FLOAT rd = td - pd;
+		while (rd > md)
+		{
+			rd -= md;
+			VECTOR np = glm::mix(p0, p, (td - rd) / td);
+			if (!glm::all(glm::gtc::epsilonEqual(np, state.lastEmitted, CurvePreprocess::EPSILON)))
+			{
+				dst.push_back(np);
+				state.lastEmitted = np;
+			}
+		}
+		state.distance = rd;
+	}
+	else
+		state.distance += td;
+}
+
+void PreprocessPipeline::Complete(StreamState& state, std::pmr::vector<VECTOR>& dst)
+{
+	// Linearization always ends with the last point
+	if (state.started && _options.linearizeDistance > 0 && !glm::all(glm::gtc::epsilonEqual(state.lastEmitted, state.prev, CurvePreprocess::EPSILON)))
+		dst.push_back(state.prev);
+	if (_options.reduceTolerance > 0)
+	{
+		switch (_options.reducer)
+		{
+		case Reducer::Rdp:
+			CurvePreprocess::RdpReduceInPlace(dst, _options.reduceTolerance, _stack);
+			break;
+		case Reducer::Visvalingam:
+			CurvePreprocess::VisvalingamReduceInPlace(dst, _options.reduceTolerance * _options.reduceTolerance, _nodes, _heap);
+			break;
+		}
+	}
+	state = {};
+}
+
+void PreprocessPipeline::Run(std::span<const VECTOR> points, std::pmr::vector<VECTOR>& dst)
+{
+	dst.clear();
+	// Without linearization the output can't be longer than the input
+	if (_options.linearizeDistance == 0)
+		dst.reserve(points.size());
+	StreamState state;
+	for (auto& p : points)
+		Process(p, state, dst);
+	Complete(state, dst);
+}
+
+void PreprocessPipeline::Push(const VECTOR& p)
+{
+	if (_finished)
+		Reset();
+	Process(p, _state, _points);
+}
+
+void PreprocessPipeline::Push(std::span<const VECTOR> points)
+{
+	if (_finished)
+		Reset();
+	for (auto& p : points)
+		Process(p, _state, _points);
+}
+
+std::span<const VECTOR> PreprocessPipeline::GetPoints() const { return _points; }
+
+std::span<const VECTOR> PreprocessPipeline::Finish()
+{
+	if (!_finished)
+	{
+		Complete(_state, _points);
+		_finished = true;
+	}
+	return _points;
+}
+
+void PreprocessPipeline::Reset()
+{
+	_points.clear();
+	_state = {};
+	_finished = false;
+}
@@ -23,80 +23,177 @@ module;
 module bezierfit;
 
 import :spline;
+import :fit_kernels;
 
 using namespace bezierfit;
 
-Spline::Spline(int samplesPerCurve) : _samplesPerCurve(samplesPerCurve)
+template<typename T, int N>
+const T BasicSpline<T, N>::EPSILON = BasicVectorHelper<T, N>::EPSILON;
+
+namespace {
+	// 8-point Gauss-Legendre rule on [-1, 1]; the nodes are symmetric, so only the positive half is listed
+	constexpr int GAUSS_HALF_ORDER = 4;
+	constexpr double GAUSS_NODES[GAUSS_HALF_ORDER] = { 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+	constexpr double GAUSS_WEIGHTS[GAUSS_HALF_ORDER] = { 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+	constexpr int MAX_NEWTON_ITERS = 8;
+	// Relative to the length of the segment that is being inverted
+	constexpr double NEWTON_TOLERANCE = 1e-6;
+
+	// Derivative of the curve as a polynomial a * t^2 + b * t + c, in double precision
+	template<typename T, int N>
+	struct Velocity
+	{
+		using DVECTOR = glm::vec<N, double>;
+		DVECTOR a, b, c;
+
+		explicit Velocity(const BasicCubicBezier<T, N>& curve)
+		{
+			DVECTOR d0 = DVECTOR(curve.p1) - DVECTOR(curve.p0);
+			DVECTOR d1 = DVECTOR(curve.p2) - DVECTOR(curve.p1);
+			DVECTOR d2 = DVECTOR(curve.p3) - DVECTOR(curve.p2);
+			a = 3.0 * (d0 - 2.0 * d1 + d2);
+			b = 6.0 * (d1 - d0);
+			c = 3.0 * d0;
+		}
+
+		double Speed(double t) const
+		{
+			return glm::length((a * t + b) * t + c);
+		}
+
+		// Arc length between t0 and t1
+		double Length(double t0, double t1) const
+		{
+			double half = (t1 - t0) * 0.5;
+			double mid = (t0 + t1) * 0.5;
+			double sum = 0;
+			for (int i = 0; i < GAUSS_HALF_ORDER; i++)
+				sum += GAUSS_WEIGHTS[i] * (Speed(mid - half * GAUSS_NODES[i]) + Speed(mid + half * GAUSS_NODES[i]));
+			return sum * half;
+		}
+	};
+
+	// Finds the parameter in [t0, t1] at which the length from t0 is target. Newton's method, falling back to bisection whenever a step
+	// leaves the bracket (the speed can get close to zero at cusps).
+	template<typename T, int N>
+	double invert_length(const Velocity<T, N>& velocity, double t0, double t1, double length, double target)
+	{
+		if (length <= 0)
+			return t0;
+		double lo = t0, hi = t1;
+		double t = t0 + (t1 - t0) * std::clamp(target / length, 0.0, 1.0);
+		for (int i = 0; i < MAX_NEWTON_ITERS; i++)
+		{
+			double f = velocity.Length(t0, t) - target;
+			if (std::abs(f) <= NEWTON_TOLERANCE * length)
+				break;
+			if (f > 0)
+				hi = t;
+			else
+				lo = t;
+			double speed = velocity.Speed(t);
+			double next = speed > 0 ? t - f / speed : lo;
+			t = next > lo && next < hi ? next : (lo + hi) * 0.5;
+		}
+		return t;
+	}
+}
+
+template<typename T, int N>
+BasicSpline<T, N>::BasicSpline(int samplesPerCurve, std::pmr::memory_resource* resource) : BasicSpline(samplesPerCurve, ArcLengthMode::Table, resource) {}
+
+template<typename T, int N>
+BasicSpline<T, N>::BasicSpline(std::span<const CubicBezier> curves, int samplesPerCurve, std::pmr::memory_resource* resource) : BasicSpline(curves, samplesPerCurve, ArcLengthMode::Table, resource) {}
+
+template<typename T, int N>
+BasicSpline<T, N>::BasicSpline(int samplesPerCurve, ArcLengthMode mode, std::pmr::memory_resource* resource)
+	: _curves(resource), _arclen(resource), _lengthTree(resource), _samplesPerCurve(mode == ArcLengthMode::Quadrature ? QUADRATURE_SEGMENTS : samplesPerCurve), _arcLengthMode(mode)
 {
-	if (_samplesPerCurve < MIN_SAMPLES_PER_CURVE || _samplesPerCurve > MAX_SAMPLES_PER_CURVE)
+	if (mode == ArcLengthMode::Table && (samplesPerCurve < MIN_SAMPLES_PER_CURVE || samplesPerCurve > MAX_SAMPLES_PER_CURVE))
 		throw std::invalid_argument("samplesPerCurve must be between " + std::to_string(MIN_SAMPLES_PER_CURVE) + " and " + std::to_string(MAX_SAMPLES_PER_CURVE));
-	_curves.resize(16);
-	_arclen.resize(16 * samplesPerCurve);
+	_curves.reserve(16);
+	_arclen.reserve(16 * _samplesPerCurve);
+	_lengthTree.reserve(16);
 }
 
-Spline::Spline(const std::vector<CubicBezier>& curves, int samplesPerCurve) : _samplesPerCurve(samplesPerCurve)
+template<typename T, int N>
+BasicSpline<T, N>::BasicSpline(std::span<const CubicBezier> curves, int samplesPerCurve, ArcLengthMode mode, std::pmr::memory_resource* resource)
+	: BasicSpline(samplesPerCurve, mode, resource)
 {
 	if (curves.empty())
 		throw std::invalid_argument("curves cannot be empty");
-	if (_samplesPerCurve < MIN_SAMPLES_PER_CURVE || _samplesPerCurve > MAX_SAMPLES_PER_CURVE)
-		throw std::invalid_argument("samplesPerCurve must be between " + std::to_string(MIN_SAMPLES_PER_CURVE) + " and " + std::to_string(MAX_SAMPLES_PER_CURVE));
-	_curves.resize(curves.size());
-	_arclen.resize(_curves.size() * samplesPerCurve);
+	_curves.reserve(curves.size());
+	_arclen.reserve(curves.size() * _samplesPerCurve);
+	_lengthTree.reserve(curves.size());
 	for (auto& curve : curves)
 		Add(curve);
 }
 
-void Spline::Add(const CubicBezier& curve)
+template<typename T, int N>
+typename BasicSpline<T, N>::ArcLengthMode BasicSpline<T, N>::GetArcLengthMode() const { return _arcLengthMode; }
+template<typename T, int N>
+int BasicSpline<T, N>::GetSamplesPerCurve() const { return _samplesPerCurve; }
+
+template<typename T, int N>
+void BasicSpline<T, N>::Add(const CubicBezier& curve)
 {
-	if (_curves.size() > 0 && !VectorHelper::EqualsOrClose(_curves[_curves.size() - 1].p3, curve.p0))
+	if (_curves.size() > 0 && !BasicVectorHelper<T, N>::EqualsOrClose(_curves[_curves.size() - 1].p3, curve.p0))
 		throw std::invalid_argument("The new curve at index " + std::to_string(_curves.size()) + " does not connect with the previous curve at index " + std::to_string(_curves.size() - 1));
 	_curves.push_back(curve);
 	for (int i = 0; i < _samplesPerCurve; i++) // expand the array since updateArcLengths expects these values to be there
 		_arclen.push_back(0);
 	UpdateArcLengths(_curves.size() - 1);
+	AppendLength(GetCurveLength(_curves.size() - 1));
 }
 
-void Spline::Update(int index, const CubicBezier& curve)
+template<typename T, int N>
+void BasicSpline<T, N>::Update(int index, const CubicBezier& curve)
 {
 	if (index < 0)
 		throw std::out_of_range("Negative index");
 	if (index >= _curves.size())
 		throw std::out_of_range("Curve index " + std::to_string(index) + " is out of range (there are " + std::to_string(_curves.size()) + " curves in the spline)");
-	if (index > 0 && !VectorHelper::EqualsOrClose(_curves[index - 1].p3, curve.p0))
+	if (index > 0 && !BasicVectorHelper<T, N>::EqualsOrClose(_curves[index - 1].p3, curve.p0))
 		throw std::invalid_argument("The updated curve at index " + std::to_string(index) + " does not connect with the previous curve at index " + std::to_string(index - 1));
-	if (index < _curves.size() - 1 && !VectorHelper::EqualsOrClose(_curves[index + 1].p0, curve.p3))
+	if (index < _curves.size() - 1 && !BasicVectorHelper<T, N>::EqualsOrClose(_curves[index + 1].p0, curve.p3))
 		throw std::invalid_argument("The updated curve at index " + std::to_string(index) + " does not connect with the next curve at index " + std::to_string(index + 1));
 
+	// Only the table of this curve changes, the following curves just move by the difference in length
+	T oldLength = GetCurveLength(index);
 	_curves[index] = curve;
-	for (int i = index; i < _curves.size(); i++)
-		UpdateArcLengths(i);
+	UpdateArcLengths(index);
+	AddLength(index, static_cast<double>(GetCurveLength(index)) - oldLength);
 }
 
-void Spline::Clear()
+template<typename T, int N>
+void BasicSpline<T, N>::Clear()
 {
 	_curves.clear();
 	_arclen.clear();
+	_lengthTree.clear();
 }
 
-FLOAT Spline::Length() const
+template<typename T, int N>
+T BasicSpline<T, N>::Length() const
 {
-	std::vector<FLOAT> arclen = _arclen;
-	int count = arclen.size();
-	return count == 0 ? 0 : arclen[count - 1];
+	return static_cast<T>(GetPrefixLength(static_cast<int>(_curves.size())));
 }
 
-const std::vector<CubicBezier>& Spline::Curves() const
+template<typename T, int N>
+const std::pmr::vector<BasicCubicBezier<T, N>>& BasicSpline<T, N>::Curves() const
 {
 	return _curves;
 }
 
-glm::vec2 Spline::Sample(FLOAT u) const
+template<typename T, int N>
+glm::vec<N, T> BasicSpline<T, N>::Sample(T u) const
 {
 	SamplePos pos = GetSamplePosition(u);
 	return _curves[pos.Index].Sample(pos.Time);
 }
 
-typename Spline::SamplePos Spline::GetSamplePosition(FLOAT u) const
+template<typename T, int N>
+typename BasicSpline<T, N>::SamplePos BasicSpline<T, N>::GetSamplePosition(T u) const
 {
 	if (_curves.empty())
 		throw std::invalid_argument("No curves have been added to the spline");
@@ -105,74 +202,236 @@ typename Spline::SamplePos Spline::GetSamplePosition(FLOAT u) const
 	if (u > 1)
 		return SamplePos(_curves.size() - 1, 1);
 
-	const std::vector<FLOAT>& arclen = _arclen;
-	FLOAT total = Length(); // Assuming Length() method is implemented
-	FLOAT target = u * total;
+	double total = GetPrefixLength(static_cast<int>(_curves.size()));
+	double target = u * total;
 	assert(target >= 0);
 
-	// Binary search to find largest value <= target
-	int index = 0;
-	int low = 0;
-	int high = static_cast<int>(arclen.size()) - 1;
-	FLOAT found = std::numeric_limits<FLOAT>::quiet_NaN();
-	while (low < high)
+	double offset;
+	int curveIndex = FindCurve(target, offset);
+	if (curveIndex >= static_cast<int>(_curves.size()))
+		return SamplePos(_curves.size() - 1, 1); // past the end due to rounding, but not picked up by the test for u > 1
+
+	// Binary search for the first sample at or past the target
+	auto begin = _arclen.begin() + curveIndex * _samplesPerCurve;
+	auto end = begin + _samplesPerCurve;
+	T localTarget = static_cast<T>(offset);
+	auto it = std::lower_bound(begin, end, localTarget);
+	if (it == end)
+		return SamplePos(curveIndex, 1);
+
+	return GetLocalSamplePosition(curveIndex, static_cast<int>(it - begin), localTarget);
+}
+
+template<typename T, int N>
+typename BasicSpline<T, N>::SamplePos BasicSpline<T, N>::GetLocalSamplePosition(int curveIndex, int index, T localTarget) const
+{
+	// interpolate between two values to see where the index would be if continuous values
+	const T* table = _arclen.data() + curveIndex * _samplesPerCurve;
+	T min = index == 0 ? 0 : table[index - 1];
+	T max = table[index];
+	if (_arcLengthMode == ArcLengthMode::Quadrature)
 	{
-		index = (low + high) / 2;
-		found = arclen[index];
-		if (found < target)
-			low = index + 1;
-		else
-			high = index;
+		double t0 = static_cast<double>(index) / _samplesPerCurve;
+		double t1 = static_cast<double>(index + 1) / _samplesPerCurve;
+		double t = invert_length(Velocity<T, N> { _curves[curveIndex] }, t0, t1, static_cast<double>(max) - min, static_cast<double>(localTarget) - min);
+		return SamplePos(curveIndex, static_cast<T>(t));
 	}
+	T part = max <= min ? 0 : std::clamp((localTarget - min) / (max - min), T(0), T(1));
+	T t = (index + part) / _samplesPerCurve;
+	return SamplePos(curveIndex, t);
+}
 
-	// this should be a rather rare scenario: we're past the end, but this wasn't picked up by the test for u >= 1
-	if (index >= static_cast<int>(arclen.size()) - 1)
-		return SamplePos(_curves.size() - 1, 1);
+template<typename T, int N>
+void BasicSpline<T, N>::SampleMany(std::span<const T> u, std::span<Vector> out) const
+{
+	if (out.size() < u.size())
+		throw std::invalid_argument("out must have at least as many elements as u");
+	SampleCursor cursor;
+	EvaluateSorted(u, out.data(), false, cursor);
+}
 
-	// this can happen because the binary search can give us either index or index + 1
-	if (found > target)
-		index--;
+template<typename T, int N>
+void BasicSpline<T, N>::TangentMany(std::span<const T> u, std::span<Vector> out) const
+{
+	if (out.size() < u.size())
+		throw std::invalid_argument("out must have at least as many elements as u");
+	SampleCursor cursor;
+	EvaluateSorted(u, out.data(), true, cursor);
+}
 
-	if (index < 0)
+template<typename T, int N>
+void BasicSpline<T, N>::SampleUniform(std::span<Vector> out) const
+{
+	// Generate the parameters in chunks on the stack, the cursor carries the walk over from one chunk to the next
+	constexpr size_t CHUNK_SIZE = 256;
+	T u[CHUNK_SIZE];
+	size_t count = out.size();
+	T divisor = count > 1 ? static_cast<T>(count - 1) : T(1);
+	SampleCursor cursor;
+	for (size_t first = 0; first < count; first += CHUNK_SIZE)
+	{
+		size_t n = std::min(CHUNK_SIZE, count - first);
+		for (size_t i = 0; i < n; i++)
+			u[i] = static_cast<T>(first + i) / divisor;
+		EvaluateSorted(std::span<const T> { u, n }, out.data() + first, false, cursor);
+	}
+}
+
+template<typename T, int N>
+void BasicSpline<T, N>::EvaluateSorted(std::span<const T> u, Vector* out, bool tangents, SampleCursor& cursor) const
+{
+	if (_curves.empty())
+		throw std::invalid_argument("No curves have been added to the spline");
+	double total = GetPrefixLength(static_cast<int>(_curves.size()));
+
+	// Consecutive values on the same curve are collected and handed to the kernel together
+	constexpr int BATCH_SIZE = 64;
+	T t[BATCH_SIZE];
+	int batchCount = 0;
+	int batchCurve = -1;
+	size_t batchFirst = 0;
+	auto flush = [&]() {
+		if (batchCount == 0)
+			return;
+		if (tangents)
+			BasicFitKernels<T, N>::SampleTangents(_curves[batchCurve], t, batchCount, out + batchFirst);
+		else
+			BasicFitKernels<T, N>::SampleCurve(_curves[batchCurve], t, batchCount, out + batchFirst);
+		batchCount = 0;
+	};
+
+	for (size_t i = 0; i < u.size(); i++)
 	{
-		// We're at the beginning of the spline
-		FLOAT max = arclen[0];
-		assert(target <= max + EPSILON); // Assuming EPSILON is defined
-		FLOAT part = target / max;
-		FLOAT t = part / _samplesPerCurve;
-		return SamplePos(0, t);
+		if (u[i] < cursor.prevU)
+			throw std::invalid_argument("u must be sorted in ascending order");
+		cursor.prevU = u[i];
+		SamplePos pos = AdvanceCursor(u[i], total, cursor);
+		if (pos.Index != batchCurve || batchCount == BATCH_SIZE)
+		{
+			flush();
+			batchCurve = pos.Index;
+			batchFirst = i;
+		}
+		t[batchCount++] = pos.Time;
 	}
-	else
+	flush();
+}
+
+template<typename T, int N>
+typename BasicSpline<T, N>::SamplePos BasicSpline<T, N>::AdvanceCursor(T u, double total, SampleCursor& cursor) const
+{
+	int lastCurve = static_cast<int>(_curves.size()) - 1;
+	if (u < 0)
+		return SamplePos(0, 0);
+	if (u > 1)
+		return SamplePos(lastCurve, 1);
+
+	// Same result as GetSamplePosition, except that the curve and sample are found by moving forward from the previous value
+	double target = u * total;
+	while (cursor.curve < lastCurve && cursor.start + GetCurveLength(cursor.curve) < target)
 	{
-		// interpolate between two values to see where the index would be if continuous values
-		FLOAT min = arclen[index];
-		FLOAT max = arclen[index + 1];
-		assert(target >= min - EPSILON && target <= max + EPSILON); // Assuming EPSILON is defined
-		FLOAT part = target < min ? 0 : target > max ? 1 : (target - min) / (max - min);
-		FLOAT t = (((index + 1) % static_cast<int>(_samplesPerCurve)) + part) / _samplesPerCurve;
-		int curveIndex = (index + 1) / static_cast<int>(_samplesPerCurve);
-		return SamplePos(curveIndex, t);
+		cursor.start += GetCurveLength(cursor.curve);
+		++cursor.curve;
+		cursor.sample = 0;
 	}
+	T localTarget = static_cast<T>(target - cursor.start);
+	const T* table = _arclen.data() + cursor.curve * _samplesPerCurve;
+	while (cursor.sample < _samplesPerCurve && table[cursor.sample] < localTarget)
+		++cursor.sample;
+	if (cursor.sample == _samplesPerCurve)
+		return SamplePos(cursor.curve, 1);
+	return GetLocalSamplePosition(cursor.curve, cursor.sample, localTarget);
 }
 
-void Spline::UpdateArcLengths(int iCurve)
+template<typename T, int N>
+void BasicSpline<T, N>::UpdateArcLengths(int iCurve)
 {
 	assert(iCurve >= 0 && iCurve < _curves.size());
 
 	CubicBezier curve = _curves[iCurve];
 	int nSamples = static_cast<int>(_samplesPerCurve);
-	std::vector<FLOAT>& arclen = _arclen;
-	FLOAT clen = iCurve > 0 ? arclen[iCurve * nSamples - 1] : 0;
-	VECTOR pp = curve.Sample(0); // Assuming t = 0 for the starting point
+	std::pmr::vector<T>& arclen = _arclen;
+	if (_arcLengthMode == ArcLengthMode::Quadrature)
+	{
+		Velocity<T, N> velocity { curve };
+		double length = 0;
+		for (int iSegment = 0; iSegment < nSamples; iSegment++)
+		{
+			length += velocity.Length(static_cast<double>(iSegment) / nSamples, static_cast<double>(iSegment + 1) / nSamples);
+			arclen[(iCurve * nSamples) + iSegment] = static_cast<T>(length);
+		}
+		return;
+	}
+	T clen = 0;
+	// The samples are evenly spaced in t, so they are generated by forward differencing instead of evaluating the curve each time
+	BasicForwardDifferencer<T, N> walk { curve, nSamples };
+	Vector pp = walk.Get();
 	assert(arclen.size() >= ((iCurve + 1) * nSamples));
 	for (int iPoint = 0; iPoint < nSamples; iPoint++)
 	{
 		int idx = (iCurve * nSamples) + iPoint;
-		FLOAT t = static_cast<FLOAT>(iPoint + 1) / static_cast<FLOAT>(nSamples);
-		VECTOR np = curve.Sample(t);
-		FLOAT d = glm::distance(np, pp);
+		walk.Next();
+		Vector np = walk.Get();
+		T d = glm::distance(np, pp);
 		clen += d;
 		arclen[idx] = clen;
 		pp = np;
 	}
 }
+
+template<typename T, int N>
+T BasicSpline<T, N>::GetCurveLength(int iCurve) const { return _arclen[(iCurve + 1) * _samplesPerCurve - 1]; }
+
+template<typename T, int N>
+void BasicSpline<T, N>::AppendLength(T length)
+{
+	// Node i (1-based) holds the sum of the lengths (i - lowbit(i), i]; its children are the nodes i - 1, i - 2, i - 4, ... below lowbit(i)
+	int i = static_cast<int>(_lengthTree.size()) + 1;
+	double node = length;
+	for (int j = 1; j < (i & -i); j <<= 1)
+		node += _lengthTree[i - j - 1];
+	_lengthTree.push_back(node);
+}
+
+template<typename T, int N>
+void BasicSpline<T, N>::AddLength(int iCurve, double delta)
+{
+	int count = static_cast<int>(_lengthTree.size());
+	for (int i = iCurve + 1; i <= count; i += i & -i)
+		_lengthTree[i - 1] += delta;
+}
+
+template<typename T, int N>
+double BasicSpline<T, N>::GetPrefixLength(int count) const
+{
+	double sum = 0;
+	for (int i = count; i > 0; i &= i - 1)
+		sum += _lengthTree[i - 1];
+	return sum;
+}
+
+template<typename T, int N>
+int BasicSpline<T, N>::FindCurve(double target, double& offset) const
+{
+	// Descends the tree to the last curve that ends before target, the curve after it contains target
+	int count = static_cast<int>(_lengthTree.size());
+	int index = 0;
+	offset = target;
+	for (int step = static_cast<int>(std::bit_floor(static_cast<unsigned int>(count))); step > 0; step >>= 1)
+	{
+		if (index + step <= count && _lengthTree[index + step - 1] < offset)
+		{
+			index += step;
+			offset -= _lengthTree[index - 1];
+		}
+	}
+	return index;
+}
+
+template class bezierfit::BasicSpline<float, 2>;
+template class bezierfit::BasicSpline<float, 3>;
+template class bezierfit::BasicSpline<double, 2>;
+template class bezierfit::BasicSpline<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicSpline<FLOAT, 4>;
+#endif
@@ -26,12 +26,17 @@ import :spline_builder;
 
 using namespace bezierfit;
 
-SplineBuilder::SplineBuilder(FLOAT pointDistance, FLOAT error, int samplesPerCurve)
-	: _builder(static_cast<float>(pointDistance), static_cast<float>(error)), _spline(samplesPerCurve)
+SplineBuilder::SplineBuilder(FLOAT pointDistance, FLOAT error, int samplesPerCurve, std::pmr::memory_resource* resource)
+	: SplineBuilder(pointDistance, error, samplesPerCurve, Spline::ArcLengthMode::Table, resource)
 {
 }
 
-bool SplineBuilder::Add(const glm::vec2& p)
+SplineBuilder::SplineBuilder(FLOAT pointDistance, FLOAT error, int samplesPerCurve, Spline::ArcLengthMode mode, std::pmr::memory_resource* resource)
+	: _builder(pointDistance, error, resource), _spline(samplesPerCurve, mode, resource), _bvh(resource)
+{
+}
+
+bool SplineBuilder::Add(const VECTOR& p)
 {
 	// Add point to CurveBuilder and check if the spline was modified
 	CurveBuilder::AddPointResult res = _builder.AddPoint(p);
@@ -39,7 +44,7 @@ bool SplineBuilder::Add(const glm::vec2& p)
 		return false;
 
 	// Update spline
-	const std::vector<CubicBezier>& curves = _builder.Curves();
+	const std::pmr::vector<CubicBezier>& curves = _builder.Curves();
 	if (res.WasAdded() && curves.size() == 1)
 	{
 		// First curve
@@ -49,6 +54,7 @@ bool SplineBuilder::Add(const glm::vec2& p)
 	else if (res.WasAdded())
 	{
 		// Split
+		_bvhValidCount = std::min(_bvhValidCount, res.FirstChangedIndex());
 		_spline.Update(_spline.Curves().size() - 1, curves[res.FirstChangedIndex()]);
 		for (int i = res.FirstChangedIndex() + 1; i < curves.size(); i++)
 			_spline.Add(curves[i]);
@@ -57,18 +63,19 @@ bool SplineBuilder::Add(const glm::vec2& p)
 	{
 		// Last curve updated
         assert(res.FirstChangedIndex() == curves.size() - 1);
+		_bvhValidCount = std::min(_bvhValidCount, res.FirstChangedIndex());
 		_spline.Update(_spline.Curves().size() - 1, curves[curves.size() - 1]);
 	}
 
 	return true;
 }
 
-glm::vec2 SplineBuilder::Sample(FLOAT u) const
+VECTOR SplineBuilder::Sample(FLOAT u) const
 {
-	return _spline.Sample(static_cast<float>(u));
+	return _spline.Sample(u);
 }
 
-glm::vec2 SplineBuilder::Tangent(FLOAT u) const
+VECTOR SplineBuilder::Tangent(FLOAT u) const
 {
 	Spline::SamplePos pos = _spline.GetSamplePosition(u);
 	return _spline.Curves()[pos.Index].Tangent(pos.Time);
@@ -78,9 +85,23 @@ void SplineBuilder::Clear()
 {
 	_builder.Clear();
 	_spline.Clear();
+	_bvh.Clear();
+	_bvhValidCount = 0;
 }
 
-const std::vector<CubicBezier>& SplineBuilder::Curves() const
+const std::pmr::vector<CubicBezier>& SplineBuilder::Curves() const
 {
 	return _spline.Curves();
 }
+
+const CurveBvh& SplineBuilder::GetBvh()
+{
+	const std::pmr::vector<CubicBezier>& curves = _spline.Curves();
+	int count = static_cast<int>(curves.size());
+	for (int i = _bvhValidCount; i < _bvh.GetCurveCount(); i++)
+		_bvh.Update(i, curves[i]);
+	for (int i = _bvh.GetCurveCount(); i < count; i++)
+		_bvh.Add(curves[i]);
+	_bvhValidCount = count;
+	return _bvh;
+}
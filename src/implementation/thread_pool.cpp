@@ -0,0 +1,119 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+module bezierfit;
+
+import :thread_pool;
+
+using namespace bezierfit;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	_threads.reserve(threadCount - 1);
+	for (unsigned int i = 1; i < threadCount; i++)
+		_threads.emplace_back(&ThreadPool::WorkerMain, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock{ _mutex };
+		_stop = true;
+	}
+	_cvStart.notify_all();
+	for (auto& t : _threads)
+		t.join();
+}
+
+unsigned int ThreadPool::GetThreadCount() const { return static_cast<unsigned int>(_threads.size()) + 1; }
+
+void ThreadPool::Run(const Job& job, unsigned int maxThreads)
+{
+	unsigned int numThreads = GetThreadCount();
+	if (maxThreads != 0)
+		numThreads = std::min(numThreads, maxThreads);
+	if (numThreads <= 1)
+	{
+		job(0);
+		return;
+	}
+
+	// The caller takes index 0, the workers the others
+	JobState state{ &job, numThreads, 1, numThreads };
+	{
+		std::scoped_lock lock{ _mutex };
+		_queue.push_back(&state);
+	}
+	_cvStart.notify_all();
+	RunIndex(state, 0);
+
+	// Runs the indices that are still queued (all of them if the workers are busy with other jobs), so a nested or
+	// concurrent Run never waits for a worker to become free
+	std::unique_lock lock{ _mutex };
+	while (state.next < state.count)
+	{
+		unsigned int index = state.next++;
+		if (state.next == state.count)
+			_queue.erase(std::find(_queue.begin(), _queue.end(), &state));
+		lock.unlock();
+		RunIndex(state, index);
+		lock.lock();
+	}
+	_cvDone.wait(lock, [&state]() { return state.remaining == 0; });
+	if (state.exception)
+		std::rethrow_exception(state.exception);
+}
+
+void ThreadPool::RunIndex(JobState& state, unsigned int index)
+{
+	std::exception_ptr exception;
+	try
+	{
+		(*state.job)(index);
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	bool done;
+	{
+		std::scoped_lock lock{ _mutex };
+		if (exception && !state.exception)
+			state.exception = exception;
+		done = --state.remaining == 0;
+	}
+	// Several callers may be waiting for their own jobs
+	if (done)
+		_cvDone.notify_all();
+}
+
+void ThreadPool::WorkerMain()
+{
+	for (;;)
+	{
+		JobState* state;
+		unsigned int index;
+		{
+			std::unique_lock lock{ _mutex };
+			_cvStart.wait(lock, [this]() { return _stop || !_queue.empty(); });
+			if (_stop)
+				return;
+			state = _queue.front();
+			index = state->next++;
+			if (state->next == state->count)
+				_queue.pop_front();
+		}
+		RunIndex(*state, index);
+	}
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool pool{ std::max(std::thread::hardware_concurrency(), 1u) };
+	return pool;
+}
@@ -26,55 +26,73 @@ import :vector_helper;
 
 using namespace bezierfit;
 
-const FLOAT VectorHelper::EPSILON = 1.2e-12f;
+template<typename T, int N>
+const T BasicVectorHelper<T, N>::EPSILON = 1.2e-12f;
 
-FLOAT VectorHelper::Distance(const glm::vec2& a, const glm::vec2& b)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::Distance(const Vector& a, const Vector& b)
 {
 	return glm::gtx::distance(a, b);
 }
 
-FLOAT VectorHelper::DistanceSquared(const glm::vec2& a, const glm::vec2& b)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::DistanceSquared(const Vector& a, const Vector& b)
 {
 	return glm::gtx::distance2(a, b);
 }
 
-FLOAT VectorHelper::Dot(const glm::vec2& a, const glm::vec2& b)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::Dot(const Vector& a, const Vector& b)
 {
 	return glm::dot(a, b);
 }
 
-glm::vec2 VectorHelper::Normalize(const glm::vec2& v)
+template<typename T, int N>
+glm::vec<N, T> BasicVectorHelper<T, N>::Normalize(const Vector& v)
 {
 	return glm::normalize(v);
 }
 
-FLOAT VectorHelper::Length(const glm::vec2& v)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::Length(const Vector& v)
 {
 	return glm::length(v);
 }
 
-FLOAT VectorHelper::LengthSquared(const glm::vec2& v)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::LengthSquared(const Vector& v)
 {
 	return glm::gtx::length2(v);
 }
 
-glm::vec2 VectorHelper::Lerp(const glm::vec2& a, const glm::vec2& b, FLOAT amount)
+template<typename T, int N>
+glm::vec<N, T> BasicVectorHelper<T, N>::Lerp(const Vector& a, const Vector& b, T amount)
 {
 	return glm::mix(a, b, amount);
 }
 
-FLOAT VectorHelper::GetX(const glm::vec2& v)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::GetX(const Vector& v)
 {
 	return v.x;
 }
 
-FLOAT VectorHelper::GetY(const glm::vec2& v)
+template<typename T, int N>
+T BasicVectorHelper<T, N>::GetY(const Vector& v)
 {
 	return v.y;
 }
 
-bool VectorHelper::EqualsOrClose(const glm::vec2& v1, const glm::vec2& v2)
+template<typename T, int N>
+bool BasicVectorHelper<T, N>::EqualsOrClose(const Vector& v1, const Vector& v2)
 {
 	return DistanceSquared(v1, v2) < EPSILON;
 }
 
+template class bezierfit::BasicVectorHelper<float, 2>;
+template class bezierfit::BasicVectorHelper<float, 3>;
+template class bezierfit::BasicVectorHelper<double, 2>;
+template class bezierfit::BasicVectorHelper<double, 3>;
+#if BEZIERFIT_DIMENSION == 4
+template class bezierfit::BasicVectorHelper<FLOAT, 4>;
+#endif
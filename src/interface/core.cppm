@@ -18,16 +18,76 @@
 
 module;
 
+#ifndef BEZIERFIT_DIMENSION
+#define BEZIERFIT_DIMENSION 2
+#endif
+
 export module bezierfit:core;
 
 export import glm;
 export import std.compat;
 
 export namespace bezierfit {
-	using VECTOR = glm::vec2;
+	// The default number of components of the points and the default scalar type, selected when the library is built
+	// (BEZIERFIT_DIMENSION and BEZIERFIT_DOUBLE_PRECISION). The curve classes are templates on both (BasicCubicBezier<T, N>, ...)
+	// that are instantiated for float and double in 2D and 3D; CubicBezier etc. are aliases for the defaults. Only the float 2D
+	// instantiations use the SIMD kernels.
+	constexpr int DIMENSION = BEZIERFIT_DIMENSION;
+	static_assert(DIMENSION >= 2 && DIMENSION <= 4, "BEZIERFIT_DIMENSION must be 2, 3 or 4");
+#ifdef BEZIERFIT_DOUBLE_PRECISION
+	using FLOAT = double;
+#else
 	using FLOAT = float;
+#endif
+	using VECTOR = glm::vec<DIMENSION, FLOAT>;
+
+	// Curves of all strokes of a batch, stored back to back. The curves of stroke i are
+	// curves[offsets[i]] ... curves[offsets[i + 1] - 1], so offsets has one more entry than there are strokes.
+	struct BatchResult
+	{
+		std::vector<std::array<VECTOR, 4>> curves;
+		std::vector<size_t> offsets;
+	};
+
+	// Algorithm that removes the points that don't contribute to the shape before fitting
+	enum class Reducer : uint8_t
+	{
+		Rdp = 0,     // Ramer-Douglas-Peucker (see CurvePreprocess::RdpReduce); quadratic in the worst case
+		Visvalingam, // Visvalingam-Whyatt (see CurvePreprocess::VisvalingamReduce); O(n log n) for any shape
+	};
+
+	// Settings of the functions below. The points are deduplicated and linearized first (see CurvePreprocess::RemoveDuplicates
+	// and CurvePreprocess::Linearize), then reduced and then fitted; PreprocessPipeline runs these stages in a single pass.
+	// The overloads that only take maxError use the defaults for the rest.
+	struct FitOptions
+	{
+		// Maximum distance of the points from the fitted curves
+		FLOAT maxError = 1;
+		// Tolerance of the reduction (0 = no reduction). Rdp removes points that are closer than this to the simplified line,
+		// Visvalingam removes points whose effective area is less than the square of it.
+		FLOAT reduceTolerance = 0.03f;
+		// Distance between the points after linearization (0 = no linearization)
+		FLOAT linearizeDistance = 0;
+		// Drops points that are equal to the previous one before linearization (see CurvePreprocess::RemoveDuplicates)
+		bool removeDuplicates = false;
+		Reducer reducer = Reducer::Rdp;
+	};
 
 	std::vector<VECTOR> reduce(std::vector<VECTOR> points, FLOAT error = 0.03f);
+	// Only the preprocessing of fit, maxError is ignored
+	std::vector<VECTOR> reduce(std::span<const VECTOR> points, const FitOptions& options);
 	std::vector<std::array<VECTOR, 4>> fit(std::vector<VECTOR> points, FLOAT maxError);
+	std::vector<std::array<VECTOR, 4>> fit(std::span<const VECTOR> points, const FitOptions& options);
+	// Same as fit, but independent parts of the stroke are fitted concurrently once they have at least parallelThreshold points.
+	// Produces the same curves as fit; only worthwhile for very long strokes.
+	std::vector<std::array<VECTOR, 4>> fit_parallel(std::vector<VECTOR> points, FLOAT maxError, int parallelThreshold = 2048, unsigned int threadCount = 0);
+	std::vector<std::array<VECTOR, 4>> fit_parallel(std::span<const VECTOR> points, const FitOptions& options, int parallelThreshold = 2048, unsigned int threadCount = 0);
+
+	// Fits every stroke independently (equivalent to calling fit on each of them) across up to threadCount threads (0 = all cores).
+	BatchResult fit_batch(std::span<const std::vector<VECTOR>> strokes, FLOAT maxError, unsigned int threadCount = 0);
+	BatchResult fit_batch(std::span<const std::vector<VECTOR>> strokes, const FitOptions& options, unsigned int threadCount = 0);
+	// Same as above, but the strokes are given as one flat point buffer; stroke i is points[offsets[i]] ... points[offsets[i + 1] - 1].
+	BatchResult fit_batch(std::span<const VECTOR> points, std::span<const size_t> offsets, FLOAT maxError, unsigned int threadCount = 0);
+	BatchResult fit_batch(std::span<const VECTOR> points, std::span<const size_t> offsets, const FitOptions& options, unsigned int threadCount = 0);
 	std::pair<VECTOR, VECTOR> calc_four_point_cubic_bezier(const VECTOR &v0, const VECTOR &v1, const VECTOR &v2, const VECTOR &v3);
 };
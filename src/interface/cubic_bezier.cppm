@@ -23,20 +23,43 @@ export module bezierfit:cubic_bezier;
 
 import :vector_helper;
 
-namespace bezierfit
+export namespace bezierfit
 {
-	class CubicBezier
+	// Axis-aligned bounding box. A default constructed box is empty, including a point or box makes it grow.
+	template<typename T, int N>
+	struct BasicBoundingBox
+	{
+		using Vector = glm::vec<N, T>;
+
+		Vector min = Vector(std::numeric_limits<T>::infinity());
+		Vector max = Vector(-std::numeric_limits<T>::infinity());
+
+		bool IsEmpty() const;
+		void Include(const Vector& p);
+		void Include(const BasicBoundingBox& other);
+		// Boxes that only touch intersect as well
+		bool Intersects(const BasicBoundingBox& other) const;
+		Vector GetCenter() const;
+		// Squared distance from p to the closest point of the box (0 if p is inside)
+		T GetDistanceSquared(const Vector& p) const;
+	};
+
+	template<typename T, int N>
+	class BasicCubicBezier
 	{
 	public:
+		using Vector = glm::vec<N, T>;
+		using BoundingBox = BasicBoundingBox<T, N>;
+
 		// Control points
-		VECTOR p0;
-		VECTOR p1;
-		VECTOR p2;
-		VECTOR p3;
-
-		CubicBezier() = default;
-		CubicBezier(const VECTOR& p0, const VECTOR& p1, const VECTOR& p2, const VECTOR& p3);
-		CubicBezier& operator=(const CubicBezier& other) {
+		Vector p0;
+		Vector p1;
+		Vector p2;
+		Vector p3;
+
+		BasicCubicBezier() = default;
+		BasicCubicBezier(const Vector& p0, const Vector& p1, const Vector& p2, const Vector& p3);
+		BasicCubicBezier& operator=(const BasicCubicBezier& other) {
 			p0 = other.p0;
 			p1 = other.p1;
 			p2 = other.p2;
@@ -44,17 +67,76 @@ namespace bezierfit
 			return *this;
 		}
 
-		VECTOR Sample(FLOAT t) const;
+		Vector Sample(T t) const;
+
+		Vector Derivative(T t) const;
+
+		Vector Tangent(T t) const;
 
-		VECTOR Derivative(FLOAT t) const;
+		// Bounds of the control points, which contain the whole curve
+		BoundingBox GetControlBounds() const;
+		// Exact bounds of the curve: the end points and the extremes of every component, where the derivative is zero
+		BoundingBox GetBounds() const;
 
-		VECTOR Tangent(FLOAT t) const;
+		// Finds the point of the curve closest to p, sets t to its parameter and returns the distance to it.
+		// The stationary points of the squared distance are the roots of a quintic, which are isolated by subdividing it in
+		// Bernstein form (a part whose coefficients don't change sign has no root) and then refined with Newton's method.
+		T Project(const Vector& p, T& t) const;
 
 		std::string ToString() const;
 
 		// Equality members
-		bool operator==(const CubicBezier& other) const;
+		bool operator==(const BasicCubicBezier& other) const;
 
-		bool operator!=(const CubicBezier& other) const;
+		bool operator!=(const BasicCubicBezier& other) const;
 	};
+
+	// The curve as a polynomial ((a * t + b) * t + c) * t + d. Horner's method needs fewer operations than the Bernstein form,
+	// so this is worth computing once for a curve that is evaluated at many parameters.
+	template<typename T, int N>
+	struct BasicPowerBasis
+	{
+		using Vector = glm::vec<N, T>;
+
+		Vector a;
+		Vector b;
+		Vector c;
+		Vector d;
+
+		BasicPowerBasis() = default;
+		explicit BasicPowerBasis(const BasicCubicBezier<T, N>& curve);
+
+		Vector Sample(T t) const;
+		Vector Derivative(T t) const;
+	};
+
+	// Walks a curve at evenly spaced parameters t = i / steps by forward differencing: every point costs three additions.
+	// The differences are accumulated in double precision, otherwise the rounding errors of the additions build up over
+	// long walks (to about steps * epsilon of the coordinates in float).
+	template<typename T, int N>
+	class BasicForwardDifferencer
+	{
+	public:
+		using Vector = glm::vec<N, T>;
+
+		BasicForwardDifferencer(const BasicCubicBezier<T, N>& curve, int steps);
+
+		// Point at the current step, starting with curve.p0 at step 0
+		Vector Get() const;
+		// Moves to the next step. Steps past the end continue the polynomial beyond t = 1.
+		void Next();
+	private:
+		using DVECTOR = glm::vec<N, double>;
+
+		DVECTOR _point;
+		DVECTOR _d1;
+		DVECTOR _d2;
+		DVECTOR _d3;
+	};
+
+	// The types of the default configuration (see VECTOR and FLOAT)
+	using BoundingBox = BasicBoundingBox<FLOAT, DIMENSION>;
+	using CubicBezier = BasicCubicBezier<FLOAT, DIMENSION>;
+	using PowerBasis = BasicPowerBasis<FLOAT, DIMENSION>;
+	using ForwardDifferencer = BasicForwardDifferencer<FLOAT, DIMENSION>;
 }
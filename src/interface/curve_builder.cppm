@@ -22,12 +22,19 @@ module;
 export module bezierfit:curve_builder;
 
 import :curve_fit;
+import :online_simplifier;
 
-namespace bezierfit
+export namespace bezierfit
 {
-	class CurveBuilder : public CurveFitBase
+	template<typename T, int N>
+	class BasicCurveBuilder : public BasicCurveFitBase<T, N>
 	{
+		using Base = BasicCurveFitBase<T, N>;
+		using OnlineSimplifier = BasicOnlineSimplifier<T, N>;
 	public:
+		using Vector = glm::vec<N, T>;
+		using CubicBezier = BasicCubicBezier<T, N>;
+
 		struct AddPointResult
 		{
 			static const AddPointResult NO_CHANGE;
@@ -43,30 +50,118 @@ namespace bezierfit
 			int data = 0;
 		};
 
-		explicit CurveBuilder(FLOAT linDist, FLOAT error);
-
-		AddPointResult AddPoint(const VECTOR& p);
+		// Limits for interactive input. Whenever a limit is exceeded the last curve is split even if it still fits,
+		// which keeps the segment that is refitted on every point short. Splits use the usual center tangent, so the curves stay C1 continuous.
+		struct StreamingOptions
+		{
+			// Maximum number of points of the last curve (0 = unlimited, otherwise at least 3)
+			int maxSegmentPoints = 0;
+			// Time an AddPoint call may spend fitting (0 = unlimited). Once it is exceeded, the last curve is split whenever it has
+			// more than 2 * FitPolicy::midTangentPoints points for the rest of the call, so a long jump takes time linear in its length.
+			std::chrono::microseconds timeBudget { 0 };
+			// Tolerance of an OnlineSimplifier that the points pass through before they are fitted (0 = off). It removes jitter
+			// from the input, which results in fewer curves; the kept points lag behind by up to simplifyLookahead points.
+			// Since the points are resampled to linDist anyway, it barely changes the number of refits.
+			T simplifyTolerance = 0;
+			int simplifyLookahead = OnlineSimplifier::DEFAULT_MAX_LOOKAHEAD;
+		};
 
-		const std::vector<CubicBezier>& Curves() const;
+		// Latencies of AddPoint calls, kept in a fixed-size logarithmic histogram so recording never allocates.
+		// Percentiles are accurate to within 1/8 of the reported value.
+		class StreamingStats
+		{
+		public:
+			using Duration = std::chrono::nanoseconds;
+
+			void Reset();
+			size_t GetCallCount() const;
+			// Number of splits caused by StreamingOptions
+			size_t GetForcedSplitCount() const;
+			// Most points the last curve had when it was refitted for a new point
+			size_t GetMaxRefitPoints() const;
+			// Latency that p (0 ... 1) of all calls stayed below
+			Duration GetPercentile(double p) const;
+			Duration GetP50() const;
+			Duration GetP99() const;
+			Duration GetMax() const;
+		private:
+			friend class BasicCurveBuilder;
+			static constexpr int SUB_BUCKET_BITS = 3;
+			static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+			void Record(Duration latency);
+			static int GetBucket(uint64_t ns);
+			static uint64_t GetBucketUpperBound(int bucket);
+
+			std::array<size_t, 64 * SUB_BUCKETS> _buckets {};
+			size_t _count = 0;
+			size_t _forcedSplits = 0;
+			size_t _maxRefitPoints = 0;
+			Duration _max { 0 };
+		};
 
-		void Clear();
+		explicit BasicCurveBuilder(T linDist, T error, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-	private:
-		FLOAT _linDist;
-		VECTOR _prev;
-		VECTOR _tanL;
-		FLOAT _totalLength;
-		int _first;
-		std::vector<CubicBezier> _result;
+		AddPointResult AddPoint(const Vector& p);
+		// Adds the point that is still held back by the simplifier (see StreamingOptions::simplifyTolerance), e.g. at the end of a stroke
+		AddPointResult Flush();
 
-		AddPointResult AddInternal(const VECTOR& np);
+		const StreamingOptions& GetStreamingOptions() const;
+		// Points that are held back by the simplifier are dropped, call Flush first to keep them
+		void SetStreamingOptions(const StreamingOptions& options);
+		// Records every AddPoint call in stats (nullptr = off). stats has to stay alive while it is set.
+		void SetStreamingStats(StreamingStats* stats);
 
-		bool FitCurve(int first, int last, const VECTOR& tanL, const VECTOR& tanR, CubicBezier& curve, int& split);
+		const std::pmr::vector<CubicBezier>& Curves() const;
 
-		std::vector<CubicBezier>::const_iterator begin() const;
-		std::vector<CubicBezier>::const_iterator end() const;
+		void Clear();
 
-		std::vector<CubicBezier>::iterator begin();
-		std::vector<CubicBezier>::iterator end();
+	private:
+		using Base::_pts;
+		using Base::_arclen;
+		using Base::_u;
+		using Base::_squaredError;
+		using Base::_policy;
+		using Base::_stats;
+		using Base::GetLeftTangent;
+		using Base::GetRightTangent;
+		using Base::GetCenterTangent;
+		using Base::FitCurve;
+
+		T _linDist;
+		Vector _prev;
+		Vector _tanL;
+		T _totalLength;
+		// Index of the first point of the last (still changing) curve in _points. Points before it have been retired:
+		// they can't affect any curve anymore and are dropped by RetirePoints.
+		int _first;
+		std::pmr::vector<Vector> _points;
+		std::pmr::vector<CubicBezier> _result;
+		StreamingOptions _streaming;
+		OnlineSimplifier _simplifier;
+		StreamingStats* _streamingStats = nullptr;
+		std::chrono::steady_clock::time_point _callStart;
+		// Set once the current call has exceeded the time budget. From then on the last curve is only kept short instead of
+		// being split at every point, which would produce a tiny curve for each of them.
+		bool _overBudget = false;
+
+		// Passes p through the simplifier if it is enabled
+		AddPointResult AddSimplified(const Vector& p);
+		// Adds the points between the previous point and p, spaced _linDist apart
+		AddPointResult AddInterpolated(const Vector& p);
+		AddPointResult AddInternal(const Vector& np);
+
+		// Whether the last curve, spanning [first ... last], has to be split because of the streaming options
+		bool ShouldForceSplit(int first, int last);
+
+		void RetirePoints();
+
+		std::pmr::vector<CubicBezier>::const_iterator begin() const;
+		std::pmr::vector<CubicBezier>::const_iterator end() const;
+
+		std::pmr::vector<CubicBezier>::iterator begin();
+		std::pmr::vector<CubicBezier>::iterator end();
 	};
+
+	using CurveBuilder = BasicCurveBuilder<FLOAT, DIMENSION>;
 };
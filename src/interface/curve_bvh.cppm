@@ -0,0 +1,84 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:curve_bvh;
+
+import :core;
+import :cubic_bezier;
+
+export namespace bezierfit {
+	// Bounding volume hierarchy over a set of curves, for culling (Query) and for finding the point closest to a query point
+	// among many curves (hit testing, snapping). Every curve is bounded exactly (CubicBezier::GetBounds); the nodes are split at
+	// the median of the longest axis and stored depth first in a single array, with the left child directly after its parent.
+	// Curves can be added and updated without a full rebuild (see SplineBuilder::GetBvh): an update refits the boxes on the path
+	// to the root, and added curves are kept in a short list that is tested linearly until it grows large enough to rebuild the hierarchy.
+	// The hierarchy only stores boxes and indices, so the projections take the curves again and they must be the ones it was built from.
+	class CurveBvh
+	{
+	public:
+		static constexpr int MAX_LEAF_SIZE = 4;
+
+		struct Projection
+		{
+			// Index of the closest curve, -1 if no curve was found
+			int curve = -1;
+			FLOAT t = 0;
+			FLOAT distance = std::numeric_limits<FLOAT>::infinity();
+		};
+
+		explicit CurveBvh(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		CurveBvh(std::span<const CubicBezier> curves, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		// Builds the hierarchy over the curves of a Spline or CurveBuilder (Curves()) or any other array of curves
+		void Build(std::span<const CubicBezier> curves);
+		// Same for the output of fit or BatchResult::curves; the curve indices are the indices in that array
+		void Build(std::span<const std::array<VECTOR, 4>> curves);
+		// Appends a curve with the next index
+		void Add(const CubicBezier& curve);
+		// Replaces the bounds of the curve at index
+		void Update(int index, const CubicBezier& curve);
+		void Clear();
+		int GetCurveCount() const;
+		BoundingBox GetBounds() const;
+		const BoundingBox& GetCurveBounds(int index) const;
+
+		// Writes the indices of all curves whose bounds intersect box to out (which is cleared first), in no particular order
+		void Query(const BoundingBox& box, std::pmr::vector<int>& out) const;
+
+		// Closest point to p on any of the curves. Only curves closer than maxDistance are considered, which makes the query
+		// cheaper when the caller only cares about nearby curves (e.g. a snapping radius).
+		Projection Project(std::span<const CubicBezier> curves, const VECTOR& p, FLOAT maxDistance = std::numeric_limits<FLOAT>::infinity()) const;
+		// Project for every point of points. The curve found for the previous point is tested first, which bounds the search
+		// early when consecutive points are close to each other (e.g. a stroke). out must have at least as many elements as points.
+		void ProjectMany(std::span<const CubicBezier> curves, std::span<const VECTOR> points, std::span<Projection> out,
+			FLOAT maxDistance = std::numeric_limits<FLOAT>::infinity()) const;
+	private:
+		struct Node
+		{
+			BoundingBox bounds;
+			// Leaves: the range [first ... first + count - 1] of _indices. Inner nodes have count 0 and first is the index of the right child.
+			int first;
+			int count;
+		};
+
+		// Rebuilds the nodes over all curves from _curveBounds
+		void Rebuild();
+		// Appends the subtree over [first ... first + count - 1] of _indices and returns the index of its root
+		int BuildNode(int first, int count, int parent);
+		// Updates best if a curve is closer than best.distance
+		void Search(std::span<const CubicBezier> curves, const VECTOR& p, Projection& best) const;
+		// Number of curves in the nodes; the ones after them have been added since the last rebuild
+		int GetIndexedCount() const;
+
+		std::pmr::vector<Node> _nodes;
+		std::pmr::vector<int> _parents;
+		// Curve indices in the order of the leaves
+		std::pmr::vector<int> _indices;
+		// Bounds and leaf node of every curve, by curve index
+		std::pmr::vector<BoundingBox> _curveBounds;
+		std::pmr::vector<int> _leaves;
+	};
+};
@@ -22,48 +22,139 @@ module;
 export module bezierfit:curve_fit;
 
 import :cubic_bezier;
+import :fit_kernels;
+import :point_buffer;
 
-namespace bezierfit {
+export namespace bezierfit {
 	const FLOAT EPSILON = std::numeric_limits<FLOAT>::epsilon();
 	const int MAX_ITERS = 4;
 	const int END_TANGENT_N_PTS = 8;
 	const int MID_TANGENT_N_PTS = 4;
 
-	class CurveFitBase
+	// Controls how hard FitCurve tries before splitting a segment. The defaults reproduce the original algorithm;
+	// stagnationThreshold and splitErrorFactor trade a few more (shorter) curves for fewer iterations.
+	struct FitPolicy
 	{
+		// Maximum number of Newton-Raphson reparameterizations per segment before it is split
+		int maxIterations = MAX_ITERS;
+		// Split as soon as an iteration reduces the error by less than this fraction of the previous error (0 = disabled)
+		FLOAT stagnationThreshold = 0;
+		// Split as soon as the error is greater than splitErrorFactor times the maximum error (0 = disabled)
+		FLOAT splitErrorFactor = 0;
+		// Number of points used to estimate the tangents at the ends of the input
+		int endTangentPoints = END_TANGENT_N_PTS;
+		// Number of points on either side of a split used to estimate the tangent there
+		int midTangentPoints = MID_TANGENT_N_PTS;
+	};
+
+	// Counters collected by FitCurve
+	struct FitStats
+	{
+		// Segments that needed iterating (at least 3 points)
+		size_t segments = 0;
+		// Newton-Raphson reparameterizations performed
+		size_t iterations = 0;
+		// Reparameterizations skipped because the policy split a segment before maxIterations was reached
+		size_t iterationsSaved = 0;
+		// Segments split early because of splitErrorFactor or stagnationThreshold
+		size_t errorSplits = 0;
+		size_t stagnationSplits = 0;
+
+		FitStats& operator+=(const FitStats& other);
+	};
+
+	template<typename T, int N>
+	class BasicCurveFitBase
+	{
+	public:
+		using Vector = glm::vec<N, T>;
+		using CubicBezier = BasicCubicBezier<T, N>;
+		using PointBuffer = BasicPointBuffer<T, N>;
+
+		// How FitCurve refines a segment. ThreePass is the original loop that walks the points three times per iteration
+		// (Reparameterize, GenerateBezier, FindMaxSquaredError); Fused does the same work in a single pass per iteration.
+		// Both produce the same curves with the Scalar kernel backend.
+		enum class IterationMode : uint8_t
+		{
+			ThreePass = 0,
+			Fused,
+		};
+
+		IterationMode GetIterationMode() const;
+		void SetIterationMode(IterationMode mode);
+
+		const FitPolicy& GetPolicy() const;
+		void SetPolicy(const FitPolicy& policy);
+
+		// Counters accumulated over all fits since construction or the last reset
+		const FitStats& GetStats() const;
+		void ResetStats();
 	protected:
-		std::vector<VECTOR> _pts;
-		std::vector<FLOAT> _arclen;
-		std::vector<FLOAT> _u;
-		FLOAT _squaredError;
+		using Kernels = BasicFitKernels<T, N>;
+		using LeastSquaresSums = typename Kernels::LeastSquaresSums;
+
+		static constexpr T EPSILON = std::numeric_limits<T>::epsilon();
+
+		// All scratch buffers are allocated from resource
+		explicit BasicCurveFitBase(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-		VECTOR GetLeftTangent(int last);
+		// Points that are being fitted, either interleaved (_pts) or as separate component arrays (_soa, which takes precedence if set).
+		// The storage is owned by the derived class or the caller.
+		std::span<const Vector> _pts;
+		const PointBuffer* _soa = nullptr;
+		std::pmr::vector<T> _arclen;
+		std::pmr::vector<T> _u;
+		T _squaredError;
+		IterationMode _iterationMode = IterationMode::Fused;
+		FitPolicy _policy;
+		FitStats _stats;
 
-		VECTOR GetRightTangent(int first);
+		// Takes over the iteration mode and the policy of other
+		void CopySettings(const BasicCurveFitBase& other);
 
-		VECTOR GetCenterTangent(int first, int last, int split);
+		Vector GetPoint(int i) const;
+		size_t GetPointCount() const;
+
+		Vector GetLeftTangent(int last);
+
+		Vector GetRightTangent(int first);
+
+		Vector GetCenterTangent(int first, int last, int split);
 
 		void InitializeArcLengths();
 
-		void ArcLengthParamaterize(int first, int last);
+		void ArcLengthParamaterize(int first, int last, std::pmr::vector<T>& u);
 
 		/// <summary>
 		 /// Generates a bezier curve for the segment using a least-squares approximation.
 		 /// </summary>
-		CubicBezier GenerateBezier(int first, int last, VECTOR tanL, VECTOR tanR);
+		CubicBezier GenerateBezier(int first, int last, Vector tanL, Vector tanR, const std::pmr::vector<T>& u);
+
+		/// <summary>
+		/// Solves the least-squares system that GenerateBezier sets up, from sums that have already been accumulated.
+		/// </summary>
+		CubicBezier GenerateBezier(int first, int last, Vector tanL, Vector tanR, const LeastSquaresSums& sums);
 
 		/// <summary>
 		 /// Attempts to find a slightly better parameterization for u on the given curve.
 		 /// </summary>
-		void Reparameterize(int first, int last, CubicBezier curve);
+		void Reparameterize(int first, int last, CubicBezier curve, std::pmr::vector<T>& u);
 
 		/// <summary>
 		/// Computes the maximum squared distance from a point to the curve using the current parameterization.
 		/// </summary>
-		FLOAT FindMaxSquaredError(int first, int last, CubicBezier curve, int& split);
+		T FindMaxSquaredError(int first, int last, CubicBezier curve, int& split, const std::pmr::vector<T>& u);
+
+		/// <summary>
+		/// FindMaxSquaredError, Reparameterize and the accumulation of the least-squares sums for the next curve in a single pass.
+		/// </summary>
+		T FusedIteration(int first, int last, Vector tanL, Vector tanR, CubicBezier curve, int& split, std::pmr::vector<T>& u, LeastSquaresSums& sums);
+
+		// Clamps the index of the point of maximum error to a valid split point of [first ... last]
+		static int GetSplitPoint(int first, int last, int maxIndex);
 
 		/// <summary>
-		/// Tries to fit single Bezier curve to the points in [first ... last]. Destroys anything in <see cref="_u"/> in the process.
+		/// Tries to fit single Bezier curve to the points in [first ... last]. Destroys anything in u in the process.
 		/// Assumes there are at least two points to fit.
 		/// </summary>
 		/// <param name="first">Index of first point to consider.</param>
@@ -72,28 +163,83 @@ namespace bezierfit {
 		/// <param name="tanR">Tangent on the end of the curve ("right").</param>
 		/// <param name="curve">The fitted curve.</param>
 		/// <param name="split">Point at which to split if this method returns false.</param>
+		/// <param name="u">Scratch buffer for the parameterization; separate buffers allow fitting disjoint ranges concurrently.</param>
+		/// <param name="stats">Counters to update; like u, separate instances allow fitting concurrently.</param>
 		/// <returns>true if the fit was within error tolerance, false if the curve should be split. Even if this returns false, curve will contain
 		/// a curve that somewhat fits the points; it's just outside error tolerance.</returns>
-		bool FitCurve(int first, int last, VECTOR tanL, VECTOR tanR, CubicBezier& curve, int& split);
+		bool FitCurve(int first, int last, Vector tanL, Vector tanR, CubicBezier& curve, int& split, std::pmr::vector<T>& u, FitStats& stats);
+
+		/// <summary>
+		/// Decides whether FitCurve should reparameterize again after the curve of the given iteration (0 = initial curve) missed the tolerance
+		/// with error, or split the segment instead. prevError is the error of the previous iteration. reparameterized tells
+		/// whether u has already been reparameterized for the next iteration (the fused pass does that while measuring the error).
+		/// </summary>
+		bool ContinueIterating(int iteration, T error, T prevError, bool reparameterized, FitStats& stats) const;
 
 	};
 
-	class CurveFit : public CurveFitBase
+	template<typename T, int N>
+	class BasicCurveFit : public BasicCurveFitBase<T, N>
 	{
+		using Base = BasicCurveFitBase<T, N>;
 	public:
-		std::vector< CubicBezier> Fit(std::vector<VECTOR> points, FLOAT maxError);
-	private:
+		using Vector = glm::vec<N, T>;
+		using CubicBezier = BasicCubicBezier<T, N>;
+		using PointBuffer = BasicPointBuffer<T, N>;
+
+		// Minimum number of points a subrange needs to be handed to another thread by FitParallel.
+		static constexpr int DEFAULT_PARALLEL_THRESHOLD = 2048;
+
+		explicit BasicCurveFit(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		std::vector< CubicBezier> Fit(std::span<const Vector> points, T maxError);
+
+		/// <summary>
+		/// Same as Fit, but subranges with at least parallelThreshold points are fitted as independent tasks
+		/// on up to threadCount threads (0 = all cores). The resulting curves are identical to those of Fit.
+		/// </summary>
+		std::vector<CubicBezier> FitParallel(std::span<const Vector> points, T maxError, int parallelThreshold = DEFAULT_PARALLEL_THRESHOLD, unsigned int threadCount = 0);
+	protected:
+		using Base::EPSILON;
+		using Base::_pts;
+		using Base::_soa;
+		using Base::_u;
+		using Base::_squaredError;
+		using Base::_policy;
+		using Base::_stats;
+		using Base::CopySettings;
+		using Base::GetPointCount;
+		using Base::GetLeftTangent;
+		using Base::GetRightTangent;
+		using Base::GetCenterTangent;
+		using Base::InitializeArcLengths;
+		using Base::FitCurve;
+
 		// Curves we've found so far.
-		std::vector<CubicBezier> _result;
+		std::pmr::vector<CubicBezier> _result;
 
 		// Shared zero-curve array.
 		static const std::vector<CubicBezier> NO_CURVES;
 
+		void Initialize(std::span<const Vector> points, T maxError);
+		void Initialize(const PointBuffer& points, T maxError);
+
 		/// <summary>
 		/// Main fit function that attempts to fit a segment of curve and recurses if unable to.
 		/// </summary>
-		void FitRecursive(int first, int last, VECTOR tanL, VECTOR tanR);
+		void FitRecursive(int first, int last, Vector tanL, Vector tanR, std::pmr::vector<T>& u, std::pmr::vector<CubicBezier>& result, FitStats& stats);
+
+		/// <summary>
+		/// Computes the tangents of both halves of [first ... last] if it has to be split at split.
+		/// tanL and tanR may be adjusted if the original end tangents were based on points outside of the new curves.
+		/// </summary>
+		void GetSplitTangents(int first, int last, int split, Vector& tanL, Vector& tanR, Vector& tanM1, Vector& tanM2);
+
+		void FitRecursiveParallel(int first, int last, Vector tanL, Vector tanR, int parallelThreshold, unsigned int threadCount);
 
 		// Other functions and variables go here...
 	};
+
+	using CurveFitBase = BasicCurveFitBase<FLOAT, DIMENSION>;
+	using CurveFit = BasicCurveFit<FLOAT, DIMENSION>;
 };
@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:curve_flattener;
+
+import :core;
+import :cubic_bezier;
+
+export namespace bezierfit {
+	// Converts curves to polylines (e.g. for rendering) that stay within the tolerance of the curves, with close to the fewest
+	// points possible: flat parts get few points and tight turns many. Every curve is approximated by quadratic curves, and the
+	// points are distributed along those with the subdivision density of a parabola (R. Levien, "Flattening quadratic Béziers"),
+	// so the number of points is known before any of them are computed. The points are then evaluated on the cubic curve in
+	// batches by the SIMD kernels (see BasicFitKernels::SampleCurve).
+	// The output is written to buffers of the caller; reusing them and the flattener avoids allocations.
+	class CurveFlattener
+	{
+	public:
+		explicit CurveFlattener(FLOAT tolerance, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		FLOAT GetTolerance() const;
+		// Number of segments that Flatten produces for curve
+		int GetSegmentCount(const CubicBezier& curve);
+
+		// Writes the polyline from curve.p0 to curve.p3 to dst, which is cleared first
+		void Flatten(const CubicBezier& curve, std::pmr::vector<VECTOR>& dst);
+		// Writes one polyline through all curves to dst (cleared first), e.g. for the curves of a Spline. The start point of a
+		// curve is only written if it differs from the end point of the previous one.
+		void Flatten(std::span<const CubicBezier> curves, std::pmr::vector<VECTOR>& dst);
+		// Flattens every stroke of a batch into one buffer: polyline i is dst[dstOffsets[i]] ... dst[dstOffsets[i + 1] - 1]
+		// (the same layout as BatchResult). Both buffers are cleared first.
+		void Flatten(const BatchResult& batch, std::pmr::vector<VECTOR>& dst, std::pmr::vector<size_t>& dstOffsets);
+	private:
+		// Subdivision of one of the quadratic curves that approximate the cubic curve
+		struct QuadParams
+		{
+			// Values of the parabola integral at the ends, and the inverse integral at the start and its scale
+			FLOAT a0;
+			FLOAT a2;
+			FLOAT u0;
+			FLOAT uScale;
+			// Number of segments needed for this part, times 2 * sqrt(tolerance)
+			FLOAT weight;
+			// Nearly straight parts are subdivided evenly, the parabola integral degenerates for them
+			bool uniform;
+
+			// Parameter within the part of the point at x (0 ... 1) of its share
+			FLOAT GetParameter(FLOAT x) const;
+		};
+
+		// Approximates curve with quadratic curves into _quads
+		void EstimateQuads(const CubicBezier& curve);
+		int GetSegmentCount(FLOAT weight) const;
+		// Appends the points of the polyline of curve after p0
+		void AppendCurve(const CubicBezier& curve, std::pmr::vector<VECTOR>& dst);
+
+		FLOAT _tolerance;
+		// Square root of the tolerance left for flattening the quadratic curves
+		FLOAT _sqrtTolerance;
+		std::pmr::vector<QuadParams> _quads;
+	};
+};
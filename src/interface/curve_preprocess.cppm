@@ -22,21 +22,81 @@ module;
 export module bezierfit:curve_preprocess;
 
 import :core;
+import :point_buffer;
 
-namespace bezierfit
+export namespace bezierfit
 {
-	class CurvePreprocess
+	template<typename T, int N>
+	class BasicCurvePreprocess
 	{
 	public:
-		static constexpr FLOAT EPSILON = 0.000001; // Change the epsilon value as needed for FLOAT type
+		using Vector = glm::vec<N, T>;
+		using PointBuffer = BasicPointBuffer<T, N>;
 
-		static std::vector<VECTOR> Linearize(const std::vector<VECTOR>& src, FLOAT md);
+		static constexpr T EPSILON = T(0.000001); // Change the epsilon value as needed for T
 
-		static std::vector<VECTOR> RemoveDuplicates(const std::vector<VECTOR>& pts);
+		// Range [first ... last] of a point list that still has to be simplified by RdpReduce
+		struct RdpRange
+		{
+			int first;
+			int last;
+		};
 
-		static std::vector<VECTOR> RdpReduce(const std::vector<VECTOR>& pointList, float epsilon);
+		// Point of the linked list that VisvalingamReduce removes points from, with its position in the heap of effective areas
+		struct VisvalingamNode
+		{
+			int prev;
+			int next;
+			int heapIndex;
+			T area;
+		};
 
-	private:
-		static FLOAT PerpendicularDistance(const VECTOR& p, const VECTOR& lineP1, const VECTOR& lineP2);
+		// Scratch buffers of Preprocess; they keep their capacity between calls
+		struct Buffers
+		{
+			std::pmr::vector<Vector> deduplicated;
+			std::pmr::vector<Vector> linearized;
+			std::pmr::vector<Vector> reduced;
+			std::pmr::vector<RdpRange> stack;
+			std::pmr::vector<VisvalingamNode> nodes;
+			std::pmr::vector<int> heap;
+			explicit Buffers(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		};
+		// Applies the duplicate removal, linearization and reduction configured in options to points, with the same result as
+		// PreprocessPipeline::Run. The result refers to either points or one of the buffers and remains valid until the next call
+		// with the same buffers.
+		static std::span<const Vector> Preprocess(std::span<const Vector> points, const FitOptions& options, Buffers& buffers);
+
+		static std::pmr::vector<Vector> Linearize(std::span<const Vector> src, T md, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		// Same as above, but writes the result into dst (which is cleared first)
+		static void Linearize(std::span<const Vector> src, T md, std::pmr::vector<Vector>& dst);
+
+		static std::pmr::vector<Vector> RemoveDuplicates(std::span<const Vector> pts, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		static std::pmr::vector<Vector> RdpReduce(std::span<const Vector> pointList, T epsilon, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		// Same as above, but writes the result into dst (which is cleared first) and uses stack as scratch space for the ranges
+		// that still have to be processed. Neither allocates once dst and stack have grown to the required size.
+		static void RdpReduce(std::span<const Vector> pointList, T epsilon, std::pmr::vector<Vector>& dst, std::pmr::vector<RdpRange>& stack);
+		// Same as above, but replaces the contents of points with the result. The kept points never move past a point
+		// that still has to be read, so no second buffer is needed.
+		static void RdpReduceInPlace(std::pmr::vector<Vector>& points, T epsilon, std::pmr::vector<RdpRange>& stack);
+
+		// Visvalingam-Whyatt reduction: repeatedly removes the point whose triangle with its neighbors has the smallest area, until
+		// all remaining points have an effective area of at least minArea. The points are kept in a linked list and the areas in an
+		// indexed min-heap, so it runs in O(n log n) for any shape, unlike RdpReduce, which is quadratic in the worst case (e.g. spirals).
+		static std::pmr::vector<Vector> VisvalingamReduce(std::span<const Vector> pointList, T minArea, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		// Same as above, but writes the result into dst (which is cleared first) and uses nodes and heap as scratch space
+		static void VisvalingamReduce(std::span<const Vector> pointList, T minArea, std::pmr::vector<Vector>& dst, std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap);
+		// Same as above, but replaces the contents of points with the result
+		static void VisvalingamReduceInPlace(std::pmr::vector<Vector>& points, T minArea, std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap);
+
+		// PointBuffer versions of the above, so the points can stay in structure of arrays form from ingestion to fitting.
+		// dst is cleared first and must not be the same buffer as the input.
+		static void RemoveDuplicates(const PointBuffer& pts, PointBuffer& dst);
+		static void RdpReduce(const PointBuffer& pointList, T epsilon, PointBuffer& dst, std::pmr::vector<RdpRange>& stack);
+		static void VisvalingamReduce(const PointBuffer& pointList, T minArea, PointBuffer& dst, std::pmr::vector<VisvalingamNode>& nodes, std::pmr::vector<int>& heap);
 	};
+
+	using CurvePreprocess = BasicCurvePreprocess<FLOAT, DIMENSION>;
 }
@@ -0,0 +1,116 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:curve_set;
+
+import :core;
+import :cubic_bezier;
+
+export namespace bezierfit {
+	// How CurveSetWriter stores the control points
+	enum class CurveSetEncoding : uint8_t
+	{
+		Float = 0,   // FLOAT components, which CurveSetView returns in place without copying
+		Quantized16, // 16-bit offsets within the bounds of the stroke; the error is about 1/131070 of the extent of the stroke per component
+	};
+
+	// Binary format for storing many fitted strokes, e.g. to load them at startup without fitting them again. The curves of a
+	// stroke are stored as one chain of control points p0, p1, p2, p3, p1, p2, p3, ..., since the end point of a curve is the
+	// start point of the next one, so a stroke of n curves takes 3 * n + 1 points instead of 4 * n.
+	//
+	// Layout (little endian; all sections start at multiples of 8 bytes from the start):
+	//   header         24 bytes: "BZCS", version (uint16), DIMENSION (uint8), flags (uint8: 1 = double components, 2 = quantized),
+	//                  number of strokes, curves and points (uint32 each) and 4 reserved bytes
+	//   stroke table   (strokes + 1) entries of { first curve, first point } (uint32 each); stroke i has the curves and points
+	//                  up to the first ones of stroke i + 1. Strokes without curves have no points.
+	//   quantization   only if quantized: the minimum and the step (FLOAT[DIMENSION] each) of every stroke
+	//   points         FLOAT[DIMENSION] or, if quantized, uint16_t[DIMENSION] per point
+	//
+	// The components and the dimension of a file have to match the ones the library is built with. Since the data is read in
+	// place, the writer and the view throw std::runtime_error when they are constructed on a big endian target.
+	class CurveSetWriter
+	{
+	public:
+		explicit CurveSetWriter(CurveSetEncoding encoding = CurveSetEncoding::Float, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		CurveSetEncoding GetEncoding() const;
+		size_t GetStrokeCount() const;
+		size_t GetCurveCount() const;
+
+		// Appends a stroke. Every curve has to start where the previous one ends (like the curves of a Spline), the end point
+		// of the previous curve is stored for both.
+		void AddStroke(std::span<const CubicBezier> curves);
+		// Same for the curves returned by fit
+		void AddStroke(std::span<const std::array<VECTOR, 4>> curves);
+		// Appends every stroke of the batch
+		void AddBatch(const BatchResult& batch);
+		void Clear();
+
+		// Number of bytes that Write produces
+		size_t GetSize() const;
+		// Writes the curve set to dst, which must have at least GetSize() bytes and be aligned to 8 bytes
+		void Write(std::span<std::byte> dst) const;
+		// Resizes dst to GetSize() and writes the curve set to it
+		void Write(std::pmr::vector<std::byte>& dst) const;
+	private:
+		// Appends the chain of a stroke of curveCount curves, where getPoint(curve, i) returns control point i of a curve
+		template<typename TGetPoint>
+		void AppendChain(size_t curveCount, const TGetPoint& getPoint);
+
+		CurveSetEncoding _encoding;
+		// Point chains of all strokes back to back, and the first point of every stroke with the total at the end
+		std::pmr::vector<VECTOR> _points;
+		std::pmr::vector<uint32_t> _strokePoints;
+		// Bounds of the points of every stroke, for the quantization
+		std::pmr::vector<BoundingBox> _strokeBounds;
+		size_t _curveCount = 0;
+	};
+
+	// Reads a curve set written by CurveSetWriter in place, e.g. from a memory mapped file. The constructor only checks the
+	// header and that the sections fit into the data, so opening is O(1); the entries of the stroke table are checked when
+	// their stroke is accessed. The view doesn't copy the data, which has to stay valid (and mapped) while it is used.
+	class CurveSetView
+	{
+	public:
+		CurveSetView() = default;
+		// data must be aligned to 8 bytes, which memory mapped files and allocated buffers are
+		explicit CurveSetView(std::span<const std::byte> data);
+
+		CurveSetEncoding GetEncoding() const;
+		size_t GetStrokeCount() const;
+		size_t GetCurveCount() const;
+		size_t GetCurveCount(size_t stroke) const;
+
+		CubicBezier GetCurve(size_t stroke, size_t index) const;
+		// Point chain of a stroke, read in place: curve i has the control points points[3 * i] ... points[3 * i + 3].
+		// Only available for CurveSetEncoding::Float.
+		std::span<const VECTOR> GetPoints(size_t stroke) const;
+		// Writes the curves of a stroke to dst, which is cleared first
+		void ReadStroke(size_t stroke, std::pmr::vector<CubicBezier>& dst) const;
+		// Copies all strokes, e.g. to pass them on to CurveFlattener or CurveBvh
+		BatchResult ToBatchResult() const;
+	private:
+		struct StrokeEntry
+		{
+			uint32_t firstCurve;
+			uint32_t firstPoint;
+		};
+
+		// Checked entry of the stroke table: the curves of the stroke and its first point
+		void GetStroke(size_t stroke, size_t& firstCurve, size_t& curveCount, size_t& firstPoint) const;
+		VECTOR GetPoint(size_t stroke, size_t point) const;
+
+		CurveSetEncoding _encoding = CurveSetEncoding::Float;
+		size_t _strokeCount = 0;
+		size_t _curveCount = 0;
+		size_t _pointCount = 0;
+		const StrokeEntry* _strokes = nullptr;
+		// Minimum and step of every stroke, if quantized
+		const FLOAT* _quantization = nullptr;
+		const VECTOR* _points = nullptr;
+		const uint16_t* _quantizedPoints = nullptr;
+	};
+};
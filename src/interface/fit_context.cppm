@@ -0,0 +1,44 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:fit_context;
+
+import :curve_fit;
+
+export namespace bezierfit {
+	// Reusable fitter that keeps all of its scratch buffers (arc lengths, parameters and results) between calls.
+	// Once the buffers have grown to the largest input that is being fitted, Fit does not allocate any memory.
+	class FitContext : public CurveFit
+	{
+	public:
+		explicit FitContext(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		// Fits curves to the points without copying them. The returned curves remain valid until the next call.
+		std::span<const CubicBezier> Fit(std::span<const VECTOR> points, FLOAT maxError);
+		// Same as above, but works directly on the separate component arrays of the buffer.
+		std::span<const CubicBezier> Fit(const PointBuffer& points, FLOAT maxError);
+
+		// Grows the scratch buffers so that inputs of up to numPoints points can be fitted without allocating.
+		void Reserve(size_t numPoints);
+
+		// Number of times a scratch buffer had to grow during Fit or Reserve since construction or the last reset.
+		// Stays unchanged across calls that did not allocate.
+		size_t GetAllocationCount() const;
+		void ResetAllocationCount();
+	private:
+		struct Capacities
+		{
+			size_t arclen;
+			size_t u;
+			size_t result;
+		};
+		void FitInitialized();
+		Capacities GetCapacities() const;
+		void CountAllocations(const Capacities& before);
+
+		size_t _allocationCount = 0;
+	};
+};
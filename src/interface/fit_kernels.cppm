@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:fit_kernels;
+
+import :cubic_bezier;
+
+namespace bezierfit {
+	// Inner loops of the curve fitter. With the Simd backend four points are processed per iteration using SSE2 or NEON
+	// (whichever the target supports), with the Avx2 backend eight points using AVX2 and FMA. The remaining points and the
+	// Scalar backend use the original scalar code. The AVX2 kernels are built for every x86 target and selected at startup
+	// if the CPU supports them, so the default is the widest available backend.
+	// FitKernels selects the backend, BasicFitKernels holds the kernels. Only the 2D float instantiation has SIMD kernels,
+	// the others always run the scalar code.
+	class FitKernels
+	{
+	public:
+		enum class Backend : uint8_t
+		{
+			Scalar = 0,
+			Simd,
+			Avx2,
+		};
+
+		// Whether the target has the four-lane kernels (SSE2 or NEON)
+		static bool IsSimdSupported();
+		// Whether the target and the CPU running it support backend
+		static bool IsSupported(Backend backend);
+		static Backend GetBackend();
+		// Selects the implementation used by all kernels. Avx2 falls back to Simd and Simd to Scalar if they aren't supported.
+		static void SetBackend(Backend backend);
+	};
+
+	// Every kernel accepts the points either interleaved or as separate component arrays (see PointBuffer).
+	template<typename T, int N>
+	class BasicFitKernels
+	{
+	public:
+		using Vector = glm::vec<N, T>;
+		using CubicBezier = BasicCubicBezier<T, N>;
+
+		// Component c of point i is components[c][i]
+		using ComponentArrays = std::array<const T*, N>;
+
+		struct LeastSquaresSums
+		{
+			T c00;
+			T c01;
+			T c11;
+			T x0;
+			T x1;
+		};
+
+		// Accumulates the least-squares matrices of CurveFitBase::GenerateBezier over pts[0 ... count - 1] with the parameters u.
+		static LeastSquaresSums AccumulateLeastSquares(const Vector* pts, const T* u, int count, Vector p0, Vector p3, Vector tanL, Vector tanR);
+		static LeastSquaresSums AccumulateLeastSquares(const ComponentArrays& pts, const T* u, int count, Vector p0, Vector p3, Vector tanL, Vector tanR);
+
+		// Performs one Newton-Raphson step on each of the parameters u[0 ... count - 1], see CurveFitBase::Reparameterize.
+		static void Reparameterize(const Vector* pts, T* u, int count, const CubicBezier& curve);
+		static void Reparameterize(const ComponentArrays& pts, T* u, int count, const CubicBezier& curve);
+
+		// Returns the maximum squared distance between pts[i] and curve.Sample(u[i]). maxIndex is set to the index of the first point
+		// with that distance, or left unchanged if no distance is greater than 0.
+		static T FindMaxSquaredError(const Vector* pts, const T* u, int count, const CubicBezier& curve, int& maxIndex);
+		static T FindMaxSquaredError(const ComponentArrays& pts, const T* u, int count, const CubicBezier& curve, int& maxIndex);
+
+		// One pass of the fused FitCurve iteration: returns the maximum squared error of curve at the parameters u (like FindMaxSquaredError),
+		// moves every u[i] by one Newton-Raphson step (like Reparameterize) and returns the least-squares sums for the new parameters in sums
+		// (like AccumulateLeastSquares with the end points of curve). Q(t) is evaluated once per point for both the error and the Newton step.
+		static T FusedIteration(const Vector* pts, T* u, int count, const CubicBezier& curve, int& maxIndex, Vector tanL, Vector tanR, LeastSquaresSums& sums);
+		static T FusedIteration(const ComponentArrays& pts, T* u, int count, const CubicBezier& curve, int& maxIndex, Vector tanL, Vector tanR, LeastSquaresSums& sums);
+
+		// Evaluates curve.Sample(t[i]) or curve.Tangent(t[i]) for i = 0 ... count - 1 into out.
+		static void SampleCurve(const CubicBezier& curve, const T* t, int count, Vector* out);
+		static void SampleTangents(const CubicBezier& curve, const T* t, int count, Vector* out);
+	};
+};
@@ -0,0 +1,68 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:online_simplifier;
+
+import :core;
+
+export namespace bezierfit {
+	// Simplifies a polyline while it is being drawn, for input that can't wait for RdpReduce to see the whole stroke.
+	// Points are collected as long as all of them stay within the tolerance of the segment from the last kept point to the
+	// newest one; when a point breaks that, or after maxLookahead points, the previous point is kept. Every dropped point is
+	// therefore within the tolerance of the segment between the kept points around it, and a point is decided at most
+	// maxLookahead points after it arrived.
+	// In 2D the check takes constant time per point (sleeve fitting): the directions from the last kept point that pass
+	// within the tolerance of all collected points form a wedge, and a new point extends the segment if it lies inside the
+	// wedge and isn't much closer to the last kept point than the collected points. Other dimensions test the collected points directly.
+	template<typename T, int N>
+	class BasicOnlineSimplifier
+	{
+	public:
+		using Vector = glm::vec<N, T>;
+
+		static constexpr int DEFAULT_MAX_LOOKAHEAD = 32;
+
+		explicit BasicOnlineSimplifier(T tolerance, int maxLookahead = DEFAULT_MAX_LOOKAHEAD, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		T GetTolerance() const;
+		int GetMaxLookahead() const;
+
+		// Returns true and sets kept if p caused a point to be kept. The first point of a stroke is kept immediately.
+		bool Add(const Vector& p, Vector& kept);
+		// Ends the stroke: returns true and sets kept if the last point still has to be kept. The next Add starts a new stroke.
+		bool Finish(Vector& kept);
+		// Number of points that have been added but not decided yet
+		int GetPendingCount() const;
+		void Reset();
+	private:
+		// Starts collecting points after the last kept point with p
+		void BeginSegment(const Vector& p);
+		// Adds p to the collected points if the segment to it is within the tolerance of all of them
+		bool ExtendSegment(const Vector& p);
+		void AddToWedge(const Vector& v, T distance);
+		bool FitsSegment(const Vector& end) const;
+
+		T _tolerance;
+		int _maxLookahead;
+		bool _started = false;
+		// Last kept point
+		Vector _anchor = Vector(0);
+		// Newest collected point and the number of collected points
+		Vector _last = Vector(0);
+		int _pending = 0;
+
+		// 2D: boundaries of the wedge (counter-clockwise from _right to _left) and the largest distance of a collected point from
+		// the anchor. Points within the tolerance of the anchor don't restrict the wedge; _hasWedge stays false until there is one that does.
+		Vector _left = Vector(0);
+		Vector _right = Vector(0);
+		bool _hasWedge = false;
+		T _maxDistance = 0;
+		// Other dimensions: the collected points
+		std::pmr::vector<Vector> _window;
+	};
+
+	using OnlineSimplifier = BasicOnlineSimplifier<FLOAT, DIMENSION>;
+};
@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:point_buffer;
+
+import :core;
+
+export namespace bezierfit {
+	// Point storage with every component in a separate array (structure of arrays).
+	// All arrays are aligned to ALIGNMENT bytes and zero-padded to a multiple of PADDING elements, so a vectorized loop over
+	// all points may read a full register past the last one. The fitting kernels don't rely on this: they work on subranges
+	// of the points (and on parameter arrays without padding), so they still finish with a scalar remainder loop.
+	template<typename T, int N>
+	class BasicPointBuffer
+	{
+	public:
+		using Vector = glm::vec<N, T>;
+
+		static constexpr size_t ALIGNMENT = 32;
+		static constexpr size_t PADDING = 8;
+
+		explicit BasicPointBuffer(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		BasicPointBuffer(std::span<const Vector> points, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		BasicPointBuffer(BasicPointBuffer&& other) noexcept;
+		BasicPointBuffer& operator=(BasicPointBuffer&& other) noexcept;
+		BasicPointBuffer(const BasicPointBuffer&) = delete;
+		BasicPointBuffer& operator=(const BasicPointBuffer&) = delete;
+		~BasicPointBuffer();
+
+		void Assign(std::span<const Vector> points);
+		// Copies the points out of an interleaved buffer such as a vertex buffer, without an intermediate conversion to Vector.
+		// stride is the distance between the x components of two consecutive points, in elements of T; the other components have to follow x directly.
+		void AssignInterleaved(std::span<const T> data, size_t stride = N);
+		void PushBack(const Vector& p);
+		void Reserve(size_t count);
+		void Clear();
+
+		size_t Size() const;
+		bool Empty() const;
+		Vector operator[](size_t i) const;
+		Vector Back() const;
+
+		// Array of the given component (0 = x) of all points
+		const T* Component(int component) const;
+		const T* X() const;
+		const T* Y() const;
+	private:
+		T* GetComponent(int component);
+		void Grow(size_t minCapacity);
+		void Release();
+
+		std::pmr::memory_resource* _resource;
+		// The component arrays back to back, each _capacity elements long
+		T* _data = nullptr;
+		size_t _size = 0;
+		size_t _capacity = 0;
+	};
+
+	using PointBuffer = BasicPointBuffer<FLOAT, DIMENSION>;
+};
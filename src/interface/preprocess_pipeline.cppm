@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:preprocess_pipeline;
+
+import :core;
+import :curve_preprocess;
+
+export namespace bezierfit {
+	// Runs the preprocessing stages selected by FitOptions (RemoveDuplicates, Linearize and RdpReduce or VisvalingamReduce, in
+	// that order) without intermediate buffers. Deduplication and linearization are applied to every point as it arrives and
+	// write straight into the output, which is then reduced in place. The result is the same as chaining the CurvePreprocess functions.
+	class PreprocessPipeline
+	{
+	public:
+		explicit PreprocessPipeline(const FitOptions& options = {}, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		const FitOptions& GetOptions() const;
+		// Also discards any points that have been pushed
+		void SetOptions(const FitOptions& options);
+
+		// Processes all points at once and writes the result to dst (which is cleared first). Doesn't affect the pushed points.
+		void Run(std::span<const VECTOR> points, std::pmr::vector<VECTOR>& dst);
+
+		// Incremental use, e.g. for points coming from an input device: the points are deduplicated and linearized immediately,
+		// Finish completes the stroke and reduces it. The next Push after Finish starts a new stroke.
+		void Push(const VECTOR& p);
+		void Push(std::span<const VECTOR> points);
+		// Points of the current stroke that have been deduplicated and linearized so far. With linearization the last point that
+		// was pushed is only added by Finish, since it depends on whether more points follow.
+		std::span<const VECTOR> GetPoints() const;
+		// The result remains valid until the next call to Push, SetOptions or Reset.
+		std::span<const VECTOR> Finish();
+		void Reset();
+	private:
+		// State of deduplication and linearization between two points
+		struct StreamState
+		{
+			bool started = false;
+			// Last point that passed deduplication
+			VECTOR prev = VECTOR(0);
+			// Last point emitted by linearization, to skip interpolated points on top of it
+			VECTOR lastEmitted = VECTOR(0);
+			// Distance covered since the last emitted point
+			FLOAT distance = 0;
+		};
+
+		void Process(const VECTOR& p, StreamState& state, std::pmr::vector<VECTOR>& dst) const;
+		void Linearize(const VECTOR& p, StreamState& state, std::pmr::vector<VECTOR>& dst) const;
+		void Complete(StreamState& state, std::pmr::vector<VECTOR>& dst);
+
+		FitOptions _options;
+		StreamState _state;
+		std::pmr::vector<VECTOR> _points;
+		std::pmr::vector<CurvePreprocess::RdpRange> _stack;
+		std::pmr::vector<CurvePreprocess::VisvalingamNode> _nodes;
+		std::pmr::vector<int> _heap;
+		bool _finished = false;
+	};
+};
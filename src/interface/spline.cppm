@@ -23,39 +23,103 @@ export module bezierfit:spline;
 
 import :cubic_bezier;
 
-namespace bezierfit
+export namespace bezierfit
 {
-	class Spline
+	template<typename T, int N>
+	class BasicSpline
 	{
 	public:
+		using Vector = glm::vec<N, T>;
+		using CubicBezier = BasicCubicBezier<T, N>;
+
 		static const int MIN_SAMPLES_PER_CURVE = 8;
 		static const int MAX_SAMPLES_PER_CURVE = 1024;
-		static const FLOAT EPSILON;
+		static const T EPSILON;
+		// Number of segments of every curve whose lengths are stored by ArcLengthMode::Quadrature
+		static const int QUADRATURE_SEGMENTS = 4;
+
+		// How distances along the spline are mapped to curve parameters.
+		// Table sums the chords between samplesPerCurve points of every curve and interpolates linearly between them.
+		// Quadrature integrates the speed of every curve with Gauss-Legendre quadrature and inverts the length with Newton's method,
+		// which is more accurate and only stores QUADRATURE_SEGMENTS values per curve, but makes every lookup more expensive.
+		enum class ArcLengthMode : uint8_t
+		{
+			Table = 0,
+			Quadrature,
+		};
 
 		struct SamplePos
 		{
 			int Index;
-			FLOAT Time;
+			T Time;
 
-			SamplePos(int curveIndex, FLOAT t) : Index(curveIndex), Time(t) {}
+			SamplePos(int curveIndex, T t) : Index(curveIndex), Time(t) {}
 		};
 
-		Spline(int samplesPerCurve);
-		Spline(const std::vector<CubicBezier>& curves, int samplesPerCurve);
+		BasicSpline(int samplesPerCurve, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		BasicSpline(std::span<const CubicBezier> curves, int samplesPerCurve, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		// samplesPerCurve is ignored by ArcLengthMode::Quadrature
+		BasicSpline(int samplesPerCurve, ArcLengthMode mode, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		BasicSpline(std::span<const CubicBezier> curves, int samplesPerCurve, ArcLengthMode mode, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+		ArcLengthMode GetArcLengthMode() const;
+		// Number of arc length values stored per curve
+		int GetSamplesPerCurve() const;
 
 		void Add(const CubicBezier& curve);
 		void Update(int index, const CubicBezier& curve);
 		void Clear();
-		FLOAT Length() const;
-		const std::vector<CubicBezier>& Curves() const;
-		glm::vec2 Sample(FLOAT u) const;
-		SamplePos GetSamplePosition(FLOAT u) const;
+		T Length() const;
+		const std::pmr::vector<CubicBezier>& Curves() const;
+		Vector Sample(T u) const;
+		SamplePos GetSamplePosition(T u) const;
+
+		// Batch versions of Sample and CubicBezier::Tangent for the values in u, which must be sorted in ascending order.
+		// The positions are found by walking the arc length tables once instead of searching them for every value.
+		// out must have at least as many elements as u.
+		void SampleMany(std::span<const T> u, std::span<Vector> out) const;
+		void TangentMany(std::span<const T> u, std::span<Vector> out) const;
+		// Samples out.size() evenly spaced positions from the start to the end of the spline
+		void SampleUniform(std::span<Vector> out) const;
 
 	private:
+		// Position of the walk through the curves done by the batch functions
+		struct SampleCursor
+		{
+			int curve = 0;
+			int sample = 0;
+			// Distance of the start of curve from the start of the spline
+			double start = 0;
+			T prevU = -std::numeric_limits<T>::infinity();
+		};
+
+		// Evaluates the spline at u, continuing from cursor
+		void EvaluateSorted(std::span<const T> u, Vector* out, bool tangents, SampleCursor& cursor) const;
+		SamplePos AdvanceCursor(T u, double total, SampleCursor& cursor) const;
+		// Interpolates the parameter of the point at distance localTarget from the start of the curve, index is the first sample at or past it
+		SamplePos GetLocalSamplePosition(int curveIndex, int index, T localTarget) const;
+
+		// Recomputes the arc length table (or the segment lengths) of a single curve
 		void UpdateArcLengths(int iCurve);
+		T GetCurveLength(int iCurve) const;
+
+		// Fenwick tree over the curve lengths
+		void AppendLength(T length);
+		void AddLength(int iCurve, double delta);
+		// Total length of the curves [0 ... count - 1]
+		double GetPrefixLength(int count) const;
+		// Index of the curve that contains the point at distance target along the spline; offset is set to the distance of target from the start of that curve
+		int FindCurve(double target, double& offset) const;
 
-		std::vector<CubicBezier> _curves;
-		std::vector<FLOAT> _arclen;
+		std::pmr::vector<CubicBezier> _curves;
+		// Arc length of every curve at samplesPerCurve evenly spaced parameters, relative to the start of that curve,
+		// so changing one curve doesn't affect the tables of the others.
+		std::pmr::vector<T> _arclen;
+		// Accumulated in double precision, since SplineBuilder updates the last curve on nearly every point
+		std::pmr::vector<double> _lengthTree;
 		int _samplesPerCurve;
+		ArcLengthMode _arcLengthMode;
 	};
+
+	using Spline = BasicSpline<FLOAT, DIMENSION>;
 }
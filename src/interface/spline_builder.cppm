@@ -22,23 +22,31 @@ module;
 export module bezierfit:spline_builder;
 
 import :cubic_bezier;
+import :curve_bvh;
 import :curve_builder;
 import :spline;
 
-namespace bezierfit {
+export namespace bezierfit {
 	class SplineBuilder
 	{
 	public:
-		SplineBuilder(FLOAT pointDistance, FLOAT error, int samplesPerCurve);
+		SplineBuilder(FLOAT pointDistance, FLOAT error, int samplesPerCurve, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		SplineBuilder(FLOAT pointDistance, FLOAT error, int samplesPerCurve, Spline::ArcLengthMode mode, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-		bool Add(const glm::vec2& p);
-		glm::vec2 Sample(FLOAT u) const;
-		glm::vec2 Tangent(FLOAT u) const;
+		bool Add(const VECTOR& p);
+		VECTOR Sample(FLOAT u) const;
+		VECTOR Tangent(FLOAT u) const;
 		void Clear();
-		const std::vector<CubicBezier>& Curves() const;
+		const std::pmr::vector<CubicBezier>& Curves() const;
+		// Hierarchy over Curves(). Add only records which curves changed; this refits or adds the bounds of those curves
+		// (see CurveBvh::Update and CurveBvh::Add), so calling it once per frame costs about as much as the curves that changed.
+		const CurveBvh& GetBvh();
 
 	private:
 		CurveBuilder _builder;
 		Spline _spline;
+		CurveBvh _bvh;
+		// Number of curves whose bounds in _bvh are up to date
+		int _bvhValidCount = 0;
 	};
 };
@@ -0,0 +1,62 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+export module bezierfit:thread_pool;
+
+import :core;
+
+namespace bezierfit {
+	// Persistent set of worker threads used by the batch and parallel fitting paths.
+	// Jobs are executed fork-join style: every participating thread runs the same job function
+	// and pulls work items from shared state, so long items never block the remaining workers.
+	// Several threads can run jobs at the same time, and a job may run a nested job: every job queues its own
+	// worker indices, and the caller runs the ones no worker has picked up itself before it waits for the others.
+	class ThreadPool
+	{
+	public:
+		using Job = std::function<void(unsigned int)>;
+
+		// threadCount includes the calling thread, so a value of 1 will not spawn any workers.
+		explicit ThreadPool(unsigned int threadCount);
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		unsigned int GetThreadCount() const;
+
+		// Runs job(workerIndex) for every worker index below maxThreads (0 = all threads) and blocks until all of them
+		// have returned. The calling thread participates with worker index 0. Each index runs exactly once, but not
+		// necessarily on its own thread, so a job must not wait for another index of the same job to start.
+		void Run(const Job& job, unsigned int maxThreads = 0);
+
+		// Pool shared by the free fitting functions, sized to the hardware concurrency.
+		static ThreadPool& GetShared();
+
+	private:
+		// A running job, on the stack of the thread that called Run
+		struct JobState
+		{
+			const Job* job;
+			unsigned int count;
+			// Worker indices handed out so far and the ones that haven't returned yet
+			unsigned int next = 0;
+			unsigned int remaining = 0;
+			std::exception_ptr exception;
+		};
+
+		void WorkerMain();
+		// Runs one worker index of the job and records its exception
+		void RunIndex(JobState& state, unsigned int index);
+
+		std::vector<std::thread> _threads;
+		std::mutex _mutex;
+		std::condition_variable _cvStart;
+		std::condition_variable _cvDone;
+		// Jobs with worker indices that haven't been handed out yet
+		std::deque<JobState*> _queue;
+		bool _stop = false;
+	};
+};
@@ -23,19 +23,24 @@ export module bezierfit:vector_helper;
 import :core;
 
 namespace bezierfit {
-	class VectorHelper
+	template<typename T, int N>
+	class BasicVectorHelper
 	{
 	public:
-		static const FLOAT EPSILON;
-		static FLOAT Distance(const glm::vec2& a, const glm::vec2& b);
-		static FLOAT DistanceSquared(const glm::vec2& a, const glm::vec2& b);
-		static FLOAT Dot(const glm::vec2& a, const glm::vec2& b);
-		static glm::vec2 Normalize(const glm::vec2& v);
-		static FLOAT Length(const glm::vec2& v);
-		static FLOAT LengthSquared(const glm::vec2& v);
-		static glm::vec2 Lerp(const glm::vec2& a, const glm::vec2& b, FLOAT amount);
-		static FLOAT GetX(const glm::vec2& v);
-		static FLOAT GetY(const glm::vec2& v);
-		static bool EqualsOrClose(const glm::vec2& v1, const glm::vec2& v2);
+		using Vector = glm::vec<N, T>;
+
+		static const T EPSILON;
+		static T Distance(const Vector& a, const Vector& b);
+		static T DistanceSquared(const Vector& a, const Vector& b);
+		static T Dot(const Vector& a, const Vector& b);
+		static Vector Normalize(const Vector& v);
+		static T Length(const Vector& v);
+		static T LengthSquared(const Vector& v);
+		static Vector Lerp(const Vector& a, const Vector& b, T amount);
+		static T GetX(const Vector& v);
+		static T GetY(const Vector& v);
+		static bool EqualsOrClose(const Vector& v1, const Vector& v2);
 	};
+
+	using VectorHelper = BasicVectorHelper<FLOAT, DIMENSION>;
 };
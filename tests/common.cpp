@@ -0,0 +1,51 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module bezierfit;
+
+import :cubic_bezier;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+VECTOR test::Random::NextPoint(FLOAT scale)
+{
+	VECTOR p(0);
+	for (int i = 0; i < DIMENSION; i++)
+		p[i] = Next() * scale;
+	return p;
+}
+
+VECTOR test::make_point(FLOAT x, FLOAT y)
+{
+	VECTOR p(0);
+	p[0] = x;
+	p[1] = y;
+	return p;
+}
+
+std::vector<VECTOR> test::make_stroke(size_t numPoints, uint32_t seed)
+{
+	Random random { seed };
+	std::vector<VECTOR> points;
+	points.reserve(numPoints);
+	for (size_t i = 0; i < numPoints; i++)
+	{
+		FLOAT t = static_cast<FLOAT>(i) * FLOAT(0.05);
+		FLOAT x = t * 8 + std::sin(t * 3) * 10 + random.Next() * FLOAT(0.3);
+		FLOAT y = std::cos(t * 2) * 20 + random.Next() * FLOAT(0.3);
+		points.push_back(make_point(x, y));
+	}
+	return points;
+}
+
+CubicBezier test::make_curve(Random& random, FLOAT scale)
+{
+	VECTOR p0 = random.NextPoint(scale);
+	VECTOR p1 = random.NextPoint(scale);
+	VECTOR p2 = random.NextPoint(scale);
+	VECTOR p3 = random.NextPoint(scale);
+	return CubicBezier(p0, p1, p2, p3);
+}
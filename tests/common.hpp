@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BEZIERFIT_TESTS_COMMON_HPP
+#define BEZIERFIT_TESTS_COMMON_HPP
+
+// Helpers shared by the tests. The tests are implementation units of the bezierfit module, so they can check the internals
+// (e.g. FitKernels) as well as the exported engines. Include this after the module declaration.
+
+namespace bezierfit::test {
+	// Deterministic values in [-1, 1]; std::minstd_rand produces the same sequence everywhere, unlike the standard distributions
+	class Random
+	{
+	public:
+		explicit Random(uint32_t seed) : _engine(seed) {}
+		FLOAT Next() { return static_cast<FLOAT>(_engine() - std::minstd_rand::min()) / static_cast<FLOAT>(std::minstd_rand::max() - std::minstd_rand::min()) * 2 - 1; }
+		// Point with every component in [-scale, scale]
+		VECTOR NextPoint(FLOAT scale);
+	private:
+		std::minstd_rand _engine;
+	};
+
+	// Selects a kernel backend for the lifetime of the object
+	class BackendScope
+	{
+	public:
+		explicit BackendScope(FitKernels::Backend backend) : _previous(FitKernels::GetBackend()) { FitKernels::SetBackend(backend); }
+		~BackendScope() { FitKernels::SetBackend(_previous); }
+		BackendScope(const BackendScope&) = delete;
+		BackendScope& operator=(const BackendScope&) = delete;
+	private:
+		FitKernels::Backend _previous;
+	};
+
+	// Memory resource that counts the allocations it passes on to the default resource
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		size_t GetAllocationCount() const { return _allocations; }
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			++_allocations;
+			return std::pmr::get_default_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override { std::pmr::get_default_resource()->deallocate(p, bytes, alignment); }
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		size_t _allocations = 0;
+	};
+
+	// Planar point; any further components are left at zero
+	VECTOR make_point(FLOAT x, FLOAT y);
+
+	// Wavy stroke with some jitter, long enough to be split into many curves
+	std::vector<VECTOR> make_stroke(size_t numPoints, uint32_t seed);
+
+	// Random curve with the control points within [-scale, scale]
+	CubicBezier make_curve(Random& random, FLOAT scale);
+};
+
+#endif
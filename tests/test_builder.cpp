@@ -0,0 +1,125 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :curve_builder;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	constexpr FLOAT LIN_DIST = FLOAT(0.5);
+	constexpr FLOAT MAX_ERROR = FLOAT(0.25);
+
+	// Applies the change reported by AddPoint to a copy of the curves
+	void apply(const CurveBuilder& builder, CurveBuilder::AddPointResult result, std::vector<CubicBezier>& curves)
+	{
+		if (!result.WasChanged())
+			return;
+		auto& built = builder.Curves();
+		size_t first = result.FirstChangedIndex();
+		ASSERT_LE(first, curves.size());
+		if (result.WasAdded())
+		{
+			ASSERT_GT(built.size(), curves.size());
+		}
+		curves.resize(built.size());
+		std::copy(built.begin() + first, built.end(), curves.begin() + first);
+	}
+
+	void expect_connected(std::span<const CubicBezier> curves)
+	{
+		for (size_t i = 1; i < curves.size(); i++)
+			EXPECT_EQ(curves[i].p0, curves[i - 1].p3) << "curve " << i;
+	}
+}
+
+// Curves before the first changed index have to stay as they are, even though their points have been retired
+TEST(Builder, ResultsReportChanges)
+{
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(3000, seed);
+		CurveBuilder builder { LIN_DIST, MAX_ERROR };
+		std::vector<CubicBezier> curves;
+		for (auto& p : points)
+		{
+			apply(builder, builder.AddPoint(p), curves);
+			ASSERT_EQ(curves, std::vector<CubicBezier>(builder.Curves().begin(), builder.Curves().end()));
+		}
+		ASSERT_GT(curves.size(), 10u);
+		EXPECT_EQ(curves.front().p0, points.front());
+		expect_connected(curves);
+	}
+}
+
+TEST(Builder, ClearStartsOver)
+{
+	auto points = test::make_stroke(500, 1);
+	CurveBuilder builder { LIN_DIST, MAX_ERROR };
+	for (auto& p : points)
+		builder.AddPoint(p);
+	std::vector<CubicBezier> first { builder.Curves().begin(), builder.Curves().end() };
+	builder.Clear();
+	EXPECT_TRUE(builder.Curves().empty());
+	for (auto& p : points)
+		builder.AddPoint(p);
+	EXPECT_EQ(std::vector<CubicBezier>(builder.Curves().begin(), builder.Curves().end()), first);
+}
+
+// The points are spaced LIN_DIST apart along the stroke, so a curve over at most maxSegmentPoints points can't be longer than that
+TEST(Builder, MaxSegmentPointsLimitsCurves)
+{
+	constexpr int MAX_SEGMENT_POINTS = 10;
+	auto points = test::make_stroke(3000, 5);
+	CurveBuilder builder { LIN_DIST, MAX_ERROR };
+	CurveBuilder::StreamingOptions options;
+	options.maxSegmentPoints = MAX_SEGMENT_POINTS;
+	builder.SetStreamingOptions(options);
+	CurveBuilder::StreamingStats stats;
+	builder.SetStreamingStats(&stats);
+	std::vector<CubicBezier> curves;
+	for (auto& p : points)
+		apply(builder, builder.AddPoint(p), curves);
+
+	EXPECT_EQ(stats.GetCallCount(), points.size());
+	EXPECT_GT(stats.GetForcedSplitCount(), 0u);
+	EXPECT_LE(stats.GetP50(), stats.GetP99());
+	EXPECT_LE(stats.GetP99(), stats.GetMax());
+	expect_connected(curves);
+	for (auto& curve : curves)
+		EXPECT_LE(glm::distance(curve.p0, curve.p3), (MAX_SEGMENT_POINTS - 1) * LIN_DIST * FLOAT(1.001));
+}
+
+// Without the budget, a jump is resampled into one straight curve that is refitted over all of its points for each of them
+TEST(Builder, TimeBudgetBoundsRefitsOnLongJump)
+{
+	constexpr int JUMP_POINTS = 10000;
+	auto points = test::make_stroke(100, 7);
+	CurveBuilder builder { LIN_DIST, MAX_ERROR };
+	CurveBuilder::StreamingOptions options;
+	options.timeBudget = std::chrono::microseconds { 1 };
+	builder.SetStreamingOptions(options);
+	CurveBuilder::StreamingStats stats;
+	builder.SetStreamingStats(&stats);
+	std::vector<CubicBezier> curves;
+	for (auto& p : points)
+		apply(builder, builder.AddPoint(p), curves);
+	stats.Reset();
+
+	VECTOR dir = glm::normalize(points.back() - points[points.size() - 2]);
+	apply(builder, builder.AddPoint(points.back() + dir * (JUMP_POINTS * LIN_DIST)), curves);
+	EXPECT_EQ(stats.GetCallCount(), 1u);
+	EXPECT_GT(stats.GetForcedSplitCount(), 0u);
+	// The budget may run out only after a few points, but from then on every refit is short
+	EXPECT_LT(stats.GetMaxRefitPoints(), 100u);
+	EXPECT_GT(curves.size(), static_cast<size_t>(JUMP_POINTS / 100));
+	expect_connected(curves);
+}
@@ -0,0 +1,91 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :cubic_bezier;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	constexpr FLOAT TOLERANCE = FLOAT(1e-4);
+
+	void expect_near(const VECTOR& a, const VECTOR& b, FLOAT tolerance)
+	{
+		for (int c = 0; c < DIMENSION; c++)
+			EXPECT_NEAR(a[c], b[c], tolerance);
+	}
+}
+
+// The exact bounds contain every point of the curve, and every side is touched by it
+TEST(CubicBezier, BoundsMatchSampling)
+{
+	constexpr int STEPS = 10000;
+	test::Random random { 31 };
+	for (int i = 0; i < 200; i++)
+	{
+		CubicBezier curve = test::make_curve(random, 10);
+		BoundingBox bounds = curve.GetBounds();
+		BoundingBox sampled;
+		for (int j = 0; j <= STEPS; j++)
+			sampled.Include(curve.Sample(static_cast<FLOAT>(j) / STEPS));
+		expect_near(bounds.min, sampled.min, FLOAT(1e-3));
+		expect_near(bounds.max, sampled.max, FLOAT(1e-3));
+		for (int c = 0; c < DIMENSION; c++)
+		{
+			EXPECT_LE(bounds.min[c], sampled.min[c] + TOLERANCE);
+			EXPECT_GE(bounds.max[c], sampled.max[c] - TOLERANCE);
+		}
+
+		// The control points bound the curve as well, just not as tightly
+		BoundingBox control = curve.GetControlBounds();
+		for (int c = 0; c < DIMENSION; c++)
+		{
+			EXPECT_LE(control.min[c], bounds.min[c] + TOLERANCE);
+			EXPECT_GE(control.max[c], bounds.max[c] - TOLERANCE);
+		}
+	}
+}
+
+TEST(CubicBezier, PowerBasisMatchesSample)
+{
+	test::Random random { 37 };
+	for (int i = 0; i < 100; i++)
+	{
+		CubicBezier curve = test::make_curve(random, 10);
+		PowerBasis basis { curve };
+		for (int j = 0; j <= 100; j++)
+		{
+			FLOAT t = static_cast<FLOAT>(j) / 100;
+			expect_near(basis.Sample(t), curve.Sample(t), TOLERANCE * 10);
+			expect_near(basis.Derivative(t), curve.Derivative(t), TOLERANCE * 100);
+		}
+	}
+}
+
+// The differences are accumulated in double precision, so even long walks don't drift away from the curve
+TEST(CubicBezier, ForwardDifferencerMatchesSample)
+{
+	test::Random random { 41 };
+	for (int steps : { 1, 7, 100, 10000 })
+	{
+		for (int i = 0; i < 20; i++)
+		{
+			CubicBezier curve = test::make_curve(random, 10);
+			ForwardDifferencer differencer { curve, steps };
+			EXPECT_EQ(differencer.Get(), curve.p0);
+			for (int j = 1; j <= steps; j++)
+			{
+				differencer.Next();
+				expect_near(differencer.Get(), curve.Sample(static_cast<FLOAT>(j) / steps), TOLERANCE * 10);
+			}
+		}
+	}
+}
@@ -0,0 +1,200 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :curve_set;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	// Offsets into the header, see the layout described at CurveSetWriter
+	constexpr size_t VERSION_OFFSET = 4;
+	constexpr size_t FLAGS_OFFSET = 7;
+	constexpr size_t HEADER_SIZE = 24;
+
+	BatchResult make_batch()
+	{
+		std::vector<std::vector<VECTOR>> strokes;
+		for (uint32_t seed = 0; seed < 4; seed++)
+			strokes.push_back(test::make_stroke(200 + 150 * seed, seed));
+		// Strokes without curves have to survive the round trip as well
+		strokes.emplace_back();
+		return fit_batch(strokes, FLOAT(0.5));
+	}
+
+	std::pmr::vector<std::byte> write(const BatchResult& batch, CurveSetEncoding encoding)
+	{
+		CurveSetWriter writer { encoding };
+		writer.AddBatch(batch);
+		std::pmr::vector<std::byte> data;
+		writer.Write(data);
+		return data;
+	}
+}
+
+TEST(CurveSet, FloatRoundTripIsExact)
+{
+	BatchResult batch = make_batch();
+	auto data = write(batch, CurveSetEncoding::Float);
+	CurveSetView view { data };
+	ASSERT_EQ(view.GetEncoding(), CurveSetEncoding::Float);
+	ASSERT_EQ(view.GetStrokeCount(), batch.offsets.size() - 1);
+	ASSERT_EQ(view.GetCurveCount(), batch.curves.size());
+
+	BatchResult read = view.ToBatchResult();
+	EXPECT_EQ(read.offsets, batch.offsets);
+	EXPECT_EQ(read.curves, batch.curves);
+
+	// The points read in place are the same chains
+	for (size_t stroke = 0; stroke < view.GetStrokeCount(); stroke++)
+	{
+		auto points = view.GetPoints(stroke);
+		size_t first = batch.offsets[stroke];
+		size_t count = batch.offsets[stroke + 1] - first;
+		ASSERT_EQ(points.size(), count > 0 ? 3 * count + 1 : 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int j = 0; j < 4; j++)
+				EXPECT_EQ(points[3 * i + j], batch.curves[first + i][j]);
+		}
+	}
+}
+
+// Both AddStroke overloads share one appender, so they have to write the same bytes and reject the same gaps
+TEST(CurveSet, AddStrokeOverloadsMatch)
+{
+	BatchResult batch = make_batch();
+	CurveSetWriter writer;
+	for (size_t stroke = 0; stroke + 1 < batch.offsets.size(); stroke++)
+	{
+		std::vector<CubicBezier> curves;
+		for (size_t i = batch.offsets[stroke]; i < batch.offsets[stroke + 1]; i++)
+		{
+			auto& c = batch.curves[i];
+			curves.emplace_back(c[0], c[1], c[2], c[3]);
+		}
+		writer.AddStroke(curves);
+	}
+	std::pmr::vector<std::byte> data;
+	writer.Write(data);
+	EXPECT_EQ(data, write(batch, CurveSetEncoding::Float));
+
+	std::vector<std::array<VECTOR, 4>> gap { batch.curves[0], batch.curves[2] };
+	EXPECT_THROW(writer.AddStroke(std::span<const std::array<VECTOR, 4>> { gap }), std::invalid_argument);
+	std::vector<CubicBezier> curves;
+	for (auto& c : gap)
+		curves.emplace_back(c[0], c[1], c[2], c[3]);
+	EXPECT_THROW(writer.AddStroke(curves), std::invalid_argument);
+	EXPECT_EQ(writer.GetStrokeCount(), batch.offsets.size() - 1);
+}
+
+TEST(CurveSet, QuantizedRoundTripIsWithinBound)
+{
+	BatchResult batch = make_batch();
+	auto data = write(batch, CurveSetEncoding::Quantized16);
+	CurveSetView view { data };
+	ASSERT_EQ(view.GetEncoding(), CurveSetEncoding::Quantized16);
+	EXPECT_THROW(view.GetPoints(0), std::invalid_argument);
+
+	BatchResult read = view.ToBatchResult();
+	ASSERT_EQ(read.offsets, batch.offsets);
+	ASSERT_EQ(read.curves.size(), batch.curves.size());
+	for (size_t stroke = 0; stroke + 1 < batch.offsets.size(); stroke++)
+	{
+		BoundingBox bounds;
+		for (size_t i = batch.offsets[stroke]; i < batch.offsets[stroke + 1]; i++)
+		{
+			for (auto& p : batch.curves[i])
+				bounds.Include(p);
+		}
+		// Half a step of 1 / 65535 of the extent, with some room for the rounding of the step itself
+		VECTOR bound = (bounds.max - bounds.min) / FLOAT(65535);
+		for (size_t i = batch.offsets[stroke]; i < batch.offsets[stroke + 1]; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				for (int c = 0; c < DIMENSION; c++)
+					EXPECT_LE(std::abs(read.curves[i][j][c] - batch.curves[i][j][c]), bound[c] + FLOAT(1e-5)) << "stroke " << stroke << " curve " << i;
+			}
+		}
+	}
+}
+
+TEST(CurveSet, RejectsTruncatedData)
+{
+	BatchResult batch = make_batch();
+	for (auto encoding : { CurveSetEncoding::Float, CurveSetEncoding::Quantized16 })
+	{
+		auto data = write(batch, encoding);
+		std::span<const std::byte> bytes { data };
+		EXPECT_THROW(CurveSetView { bytes.first(0) }, std::invalid_argument);
+		EXPECT_THROW(CurveSetView { bytes.first(HEADER_SIZE - 1) }, std::invalid_argument);
+		EXPECT_THROW(CurveSetView { bytes.first(HEADER_SIZE) }, std::invalid_argument);
+		EXPECT_THROW(CurveSetView { bytes.first(data.size() - 8) }, std::invalid_argument);
+		EXPECT_NO_THROW(CurveSetView { bytes });
+	}
+}
+
+TEST(CurveSet, RejectsCorruptHeader)
+{
+	auto data = write(make_batch(), CurveSetEncoding::Float);
+
+	auto magic = data;
+	magic[0] = std::byte { 'X' };
+	EXPECT_THROW(CurveSetView { magic }, std::invalid_argument);
+
+	auto version = data;
+	version[VERSION_OFFSET] = std::byte { 0xff };
+	EXPECT_THROW(CurveSetView { version }, std::invalid_argument);
+
+	auto flags = data;
+	flags[FLAGS_OFFSET] |= std::byte { 0x80 };
+	EXPECT_THROW(CurveSetView { flags }, std::invalid_argument);
+
+	// The components have to match the ones the library is built with
+	auto precision = data;
+	precision[FLAGS_OFFSET] ^= std::byte { 1 };
+	EXPECT_THROW(CurveSetView { precision }, std::invalid_argument);
+
+	// Sections must start at multiples of 8 bytes
+	std::pmr::vector<std::byte> shifted(data.size() + 8);
+	std::memcpy(shifted.data() + 4, data.data(), data.size());
+	EXPECT_THROW(CurveSetView(std::span<const std::byte> { shifted }.subspan(4, data.size())), std::invalid_argument);
+}
+
+TEST(CurveSet, RejectsCorruptStrokeTable)
+{
+	BatchResult batch = make_batch();
+	auto data = write(batch, CurveSetEncoding::Float);
+	auto entries = [](std::pmr::vector<std::byte>& bytes) { return reinterpret_cast<uint32_t*>(bytes.data() + HEADER_SIZE); };
+	size_t strokeCount = batch.offsets.size() - 1;
+
+	// The last entry has to hold the totals, which is checked when opening
+	auto totals = data;
+	entries(totals)[2 * strokeCount] += 1;
+	EXPECT_THROW(CurveSetView { totals }, std::invalid_argument);
+
+	// The other entries are checked when their stroke is accessed
+	auto reversed = data;
+	entries(reversed)[2] = entries(reversed)[4] + 1;
+	CurveSetView view { reversed };
+	EXPECT_THROW(view.GetCurveCount(0), std::invalid_argument);
+	EXPECT_THROW(view.ToBatchResult(), std::invalid_argument);
+	EXPECT_NO_THROW(view.GetCurveCount(strokeCount - 1));
+
+	// A stroke of n curves has to have 3 * n + 1 points
+	auto points = data;
+	entries(points)[3] += 1;
+	CurveSetView pointsView { points };
+	EXPECT_THROW(pointsView.GetCurve(1, 0), std::invalid_argument);
+
+	EXPECT_THROW(CurveSetView { data }.GetCurveCount(strokeCount), std::out_of_range);
+}
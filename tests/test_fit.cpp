@@ -0,0 +1,162 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :fit_context;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	// Distance from p to the closest of the curves, found by sampling them densely
+	template<typename TCurve>
+	auto get_distance(std::span<const TCurve> curves, const typename TCurve::Vector& p)
+	{
+		constexpr int STEPS = 1000;
+		auto best = std::numeric_limits<decltype(p.x)>::infinity();
+		for (auto& curve : curves)
+		{
+			for (int i = 0; i <= STEPS; i++)
+				best = std::min(best, glm::distance(curve.Sample(static_cast<decltype(p.x)>(i) / STEPS), p));
+		}
+		return best;
+	}
+
+	// The sampling in get_distance overestimates the distance a little
+	constexpr FLOAT SAMPLING_SLACK = FLOAT(0.02);
+}
+
+// fit_parallel only changes where the independent parts are fitted, so the curves have to be bit-identical
+TEST(Fit, ParallelMatchesSerial)
+{
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(4000 + 1000 * seed, seed);
+		for (auto reducer : { Reducer::Rdp, Reducer::Visvalingam })
+		{
+			FitOptions options;
+			options.maxError = FLOAT(0.25);
+			options.reducer = reducer;
+			auto serial = fit(points, options);
+			for (unsigned int threadCount : { 1u, 2u, 0u })
+			{
+				auto parallel = fit_parallel(points, options, 64, threadCount);
+				EXPECT_EQ(parallel, serial) << "seed " << seed << ", threads " << threadCount;
+			}
+		}
+	}
+}
+
+TEST(Fit, BatchMatchesSerial)
+{
+	std::vector<std::vector<VECTOR>> strokes;
+	for (uint32_t seed = 0; seed < 8; seed++)
+		strokes.push_back(test::make_stroke(300 + 100 * seed, seed));
+	BatchResult batch = fit_batch(strokes, FLOAT(0.5));
+	ASSERT_EQ(batch.offsets.size(), strokes.size() + 1);
+	for (size_t i = 0; i < strokes.size(); i++)
+	{
+		auto curves = fit(strokes[i], FLOAT(0.5));
+		std::vector<std::array<VECTOR, 4>> stroke { batch.curves.begin() + batch.offsets[i], batch.curves.begin() + batch.offsets[i + 1] };
+		EXPECT_EQ(stroke, curves) << "stroke " << i;
+	}
+}
+
+TEST(Fit, PolicyStaysWithinError)
+{
+	auto points = test::make_stroke(300, 3);
+	FitPolicy policy;
+	policy.stagnationThreshold = FLOAT(0.1);
+	policy.splitErrorFactor = 4;
+	for (auto& p : { FitPolicy {}, policy })
+	{
+		CurveFit curveFit;
+		curveFit.SetPolicy(p);
+		auto curves = curveFit.Fit(points, FLOAT(0.25));
+		EXPECT_GT(curveFit.GetStats().segments, 0u);
+		for (auto& point : points)
+			EXPECT_LE(get_distance<CubicBezier>(curves, point), FLOAT(0.25) + SAMPLING_SLACK);
+	}
+}
+
+// The fused pass computes the same values as the three passes, only in a different order of the loops
+TEST(Fit, FusedMatchesThreePass)
+{
+	test::BackendScope scalar { FitKernels::Backend::Scalar };
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(1000, seed);
+		CurveFit threePass;
+		threePass.SetIterationMode(CurveFit::IterationMode::ThreePass);
+		CurveFit fused;
+		fused.SetIterationMode(CurveFit::IterationMode::Fused);
+		EXPECT_EQ(fused.Fit(points, FLOAT(0.25)), threePass.Fit(points, FLOAT(0.25))) << "seed " << seed;
+	}
+}
+
+TEST(FitContext, MatchesCurveFit)
+{
+	FitContext context;
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(500 + 300 * seed, seed);
+		CurveFit curveFit;
+		auto expected = curveFit.Fit(points, FLOAT(0.25));
+		auto curves = context.Fit(points, FLOAT(0.25));
+		EXPECT_EQ(std::vector<CubicBezier>(curves.begin(), curves.end()), expected) << "seed " << seed;
+	}
+}
+
+TEST(FitContext, PointBufferMatchesInterleaved)
+{
+	test::BackendScope scalar { FitKernels::Backend::Scalar };
+	FitContext context;
+	auto points = test::make_stroke(2000, 9);
+	auto curves = context.Fit(points, FLOAT(0.25));
+	std::vector<CubicBezier> expected { curves.begin(), curves.end() };
+	PointBuffer buffer { points };
+	curves = context.Fit(buffer, FLOAT(0.25));
+	EXPECT_EQ(std::vector<CubicBezier>(curves.begin(), curves.end()), expected);
+}
+
+// Once the buffers have grown to the largest stroke, refitting takes no memory from the resource
+TEST(FitContext, RefitsDoNotAllocate)
+{
+	test::CountingResource resource;
+	FitContext context { &resource };
+	context.Reserve(3000);
+	size_t allocations = resource.GetAllocationCount();
+	size_t contextAllocations = context.GetAllocationCount();
+	for (uint32_t seed = 0; seed < 8; seed++)
+	{
+		auto points = test::make_stroke(1000 + 250 * seed, seed);
+		EXPECT_FALSE(context.Fit(points, FLOAT(0.25)).empty());
+	}
+	EXPECT_EQ(resource.GetAllocationCount(), allocations);
+	EXPECT_EQ(context.GetAllocationCount(), contextAllocations);
+}
+
+// The templates work for any instantiation, not only the configured defaults
+TEST(Fit, DoubleIn3D)
+{
+	std::vector<glm::dvec3> points;
+	for (int i = 0; i < 400; i++)
+	{
+		double t = i * 0.05;
+		points.emplace_back(std::cos(t) * 10, std::sin(t) * 10, t * 2);
+	}
+	BasicCurveFit<double, 3> curveFit;
+	auto curves = curveFit.Fit(points, 0.1);
+	ASSERT_FALSE(curves.empty());
+	EXPECT_EQ(curves.front().p0, points.front());
+	EXPECT_EQ(curves.back().p3, points.back());
+	for (auto& point : points)
+		EXPECT_LE((get_distance<BasicCubicBezier<double, 3>>(curves, point)), 0.1 + SAMPLING_SLACK);
+}
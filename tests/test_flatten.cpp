@@ -0,0 +1,103 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :curve_flattener;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	// Distance from p to the closest segment of the polyline
+	FLOAT get_polyline_distance(std::span<const VECTOR> polyline, const VECTOR& p)
+	{
+		FLOAT best = std::numeric_limits<FLOAT>::infinity();
+		for (size_t i = 1; i < polyline.size(); i++)
+		{
+			VECTOR dir = polyline[i] - polyline[i - 1];
+			FLOAT lengthSq = glm::dot(dir, dir);
+			FLOAT t = lengthSq > 0 ? std::clamp(glm::dot(p - polyline[i - 1], dir) / lengthSq, FLOAT(0), FLOAT(1)) : FLOAT(0);
+			best = std::min(best, glm::distance(p, polyline[i - 1] + dir * t));
+		}
+		return best;
+	}
+}
+
+// The subdivision density is an approximation, so the polyline may exceed the tolerance slightly, but never by much
+TEST(Flatten, StaysWithinTolerance)
+{
+	constexpr int STEPS = 2000;
+	test::Random random { 17 };
+	std::pmr::vector<VECTOR> polyline;
+	for (FLOAT tolerance : { FLOAT(0.01), FLOAT(0.1), FLOAT(1) })
+	{
+		CurveFlattener flattener { tolerance };
+		for (int i = 0; i < 100; i++)
+		{
+			CubicBezier curve = test::make_curve(random, 10);
+			flattener.Flatten(curve, polyline);
+			ASSERT_GE(polyline.size(), 2u);
+			EXPECT_EQ(polyline.front(), curve.p0);
+			EXPECT_EQ(polyline.back(), curve.p3);
+			EXPECT_EQ(static_cast<int>(polyline.size()) - 1, flattener.GetSegmentCount(curve));
+			FLOAT maxDistance = 0;
+			for (int j = 0; j <= STEPS; j++)
+				maxDistance = std::max(maxDistance, get_polyline_distance(polyline, curve.Sample(static_cast<FLOAT>(j) / STEPS)));
+			EXPECT_LE(maxDistance, tolerance * FLOAT(1.2)) << curve.ToString();
+		}
+	}
+}
+
+// Halving the tolerance shouldn't need more than about sqrt(2) times the points
+TEST(Flatten, SegmentCountScalesWithTolerance)
+{
+	test::Random random { 23 };
+	CurveFlattener coarse { FLOAT(0.1) };
+	CurveFlattener fine { FLOAT(0.05) };
+	int coarseCount = 0;
+	int fineCount = 0;
+	for (int i = 0; i < 200; i++)
+	{
+		CubicBezier curve = test::make_curve(random, 10);
+		coarseCount += coarse.GetSegmentCount(curve);
+		fineCount += fine.GetSegmentCount(curve);
+	}
+	EXPECT_GT(fineCount, coarseCount);
+	EXPECT_LT(fineCount, coarseCount * FLOAT(1.6));
+}
+
+TEST(Flatten, BatchMatchesStrokes)
+{
+	std::vector<std::vector<VECTOR>> strokes;
+	for (uint32_t seed = 0; seed < 6; seed++)
+		strokes.push_back(test::make_stroke(200 + 50 * seed, seed));
+	strokes.push_back({});
+	BatchResult batch = fit_batch(strokes, FLOAT(0.5));
+
+	CurveFlattener flattener { FLOAT(0.05) };
+	std::pmr::vector<VECTOR> dst;
+	std::pmr::vector<size_t> offsets;
+	flattener.Flatten(batch, dst, offsets);
+	ASSERT_EQ(offsets.size(), batch.offsets.size());
+
+	std::pmr::vector<VECTOR> polyline;
+	for (size_t i = 0; i + 1 < batch.offsets.size(); i++)
+	{
+		std::vector<CubicBezier> curves;
+		for (size_t j = batch.offsets[i]; j < batch.offsets[i + 1]; j++)
+		{
+			auto& c = batch.curves[j];
+			curves.emplace_back(c[0], c[1], c[2], c[3]);
+		}
+		flattener.Flatten(curves, polyline);
+		std::vector<VECTOR> stroke { dst.begin() + offsets[i], dst.begin() + offsets[i + 1] };
+		EXPECT_EQ(stroke, std::vector<VECTOR>(polyline.begin(), polyline.end())) << "stroke " << i;
+	}
+}
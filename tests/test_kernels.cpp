@@ -0,0 +1,204 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :fit_kernels;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	using Kernels = BasicFitKernels<FLOAT, DIMENSION>;
+
+	// The vector kernels sum in a different order, so they only agree with the scalar code up to rounding
+	constexpr FLOAT TOLERANCE = FLOAT(1e-4);
+
+	// Points scattered around a curve with increasing parameters, in both layouts. The count isn't a multiple of any
+	// vector width, so the remainder loops are covered as well.
+	struct Input
+	{
+		CubicBezier curve;
+		std::vector<VECTOR> points;
+		std::vector<FLOAT> u;
+		std::array<std::vector<FLOAT>, DIMENSION> components;
+
+		Input(uint32_t seed, int count)
+		{
+			test::Random random { seed };
+			curve = test::make_curve(random, 10);
+			for (int i = 0; i < count; i++)
+			{
+				FLOAT t = static_cast<FLOAT>(i) / static_cast<FLOAT>(count - 1);
+				u.push_back(std::clamp(t + random.Next() * FLOAT(0.02), FLOAT(0), FLOAT(1)));
+				points.push_back(curve.Sample(t) + random.NextPoint(FLOAT(0.5)));
+			}
+			for (int c = 0; c < DIMENSION; c++)
+			{
+				for (auto& p : points)
+					components[c].push_back(p[c]);
+			}
+		}
+
+		Kernels::ComponentArrays GetComponents() const
+		{
+			Kernels::ComponentArrays arrays;
+			for (int c = 0; c < DIMENSION; c++)
+				arrays[c] = components[c].data();
+			return arrays;
+		}
+	};
+
+	void expect_near(FLOAT a, FLOAT b)
+	{
+		EXPECT_NEAR(a, b, TOLERANCE * std::max(FLOAT(1), std::abs(b)));
+	}
+
+	void expect_near(const Kernels::LeastSquaresSums& a, const Kernels::LeastSquaresSums& b)
+	{
+		expect_near(a.c00, b.c00);
+		expect_near(a.c01, b.c01);
+		expect_near(a.c11, b.c11);
+		expect_near(a.x0, b.x0);
+		expect_near(a.x1, b.x1);
+	}
+
+	void expect_near(std::span<const FLOAT> a, std::span<const FLOAT> b)
+	{
+		ASSERT_EQ(a.size(), b.size());
+		for (size_t i = 0; i < a.size(); i++)
+			expect_near(a[i], b[i]);
+	}
+
+	void expect_near(std::span<const VECTOR> a, std::span<const VECTOR> b)
+	{
+		ASSERT_EQ(a.size(), b.size());
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			for (int c = 0; c < DIMENSION; c++)
+				expect_near(a[i][c], b[i][c]);
+		}
+	}
+
+	// Results of every kernel with the selected backend
+	struct Results
+	{
+		Kernels::LeastSquaresSums sums;
+		Kernels::LeastSquaresSums sumsSoa;
+		std::vector<FLOAT> reparameterized;
+		std::vector<FLOAT> reparameterizedSoa;
+		FLOAT error;
+		FLOAT errorSoa;
+		int maxIndex = -1;
+		std::vector<FLOAT> fusedU;
+		Kernels::LeastSquaresSums fusedSums;
+		FLOAT fusedError;
+		std::vector<VECTOR> samples;
+		std::vector<VECTOR> tangents;
+
+		Results(const Input& input)
+		{
+			int count = static_cast<int>(input.points.size());
+			auto components = input.GetComponents();
+			VECTOR tanL = glm::normalize(input.curve.p1 - input.curve.p0);
+			VECTOR tanR = glm::normalize(input.curve.p2 - input.curve.p3);
+
+			sums = Kernels::AccumulateLeastSquares(input.points.data(), input.u.data(), count, input.curve.p0, input.curve.p3, tanL, tanR);
+			sumsSoa = Kernels::AccumulateLeastSquares(components, input.u.data(), count, input.curve.p0, input.curve.p3, tanL, tanR);
+
+			reparameterized = input.u;
+			Kernels::Reparameterize(input.points.data(), reparameterized.data(), count, input.curve);
+			reparameterizedSoa = input.u;
+			Kernels::Reparameterize(components, reparameterizedSoa.data(), count, input.curve);
+
+			error = Kernels::FindMaxSquaredError(input.points.data(), input.u.data(), count, input.curve, maxIndex);
+			int maxIndexSoa = -1;
+			errorSoa = Kernels::FindMaxSquaredError(components, input.u.data(), count, input.curve, maxIndexSoa);
+
+			fusedU = input.u;
+			int fusedIndex = -1;
+			fusedError = Kernels::FusedIteration(input.points.data(), fusedU.data(), count, input.curve, fusedIndex, tanL, tanR, fusedSums);
+
+			samples.resize(count);
+			Kernels::SampleCurve(input.curve, input.u.data(), count, samples.data());
+			tangents.resize(count);
+			Kernels::SampleTangents(input.curve, input.u.data(), count, tangents.data());
+		}
+	};
+}
+
+TEST(Kernels, BackendsMatchScalar)
+{
+	for (auto backend : { FitKernels::Backend::Simd, FitKernels::Backend::Avx2 })
+	{
+		if (!FitKernels::IsSupported(backend))
+			continue;
+		for (uint32_t seed = 0; seed < 8; seed++)
+		{
+			Input input { seed, 37 + static_cast<int>(seed) * 13 };
+			std::optional<Results> scalar;
+			{
+				test::BackendScope scope { FitKernels::Backend::Scalar };
+				scalar.emplace(input);
+			}
+			test::BackendScope scope { backend };
+			ASSERT_EQ(FitKernels::GetBackend(), backend);
+			Results vector { input };
+
+			expect_near(vector.sums, scalar->sums);
+			expect_near(vector.sumsSoa, scalar->sums);
+			expect_near(vector.reparameterized, scalar->reparameterized);
+			expect_near(vector.reparameterizedSoa, scalar->reparameterized);
+			expect_near(vector.error, scalar->error);
+			expect_near(vector.errorSoa, scalar->error);
+			expect_near(vector.fusedError, scalar->fusedError);
+			expect_near(vector.fusedSums, scalar->fusedSums);
+			expect_near(vector.fusedU, scalar->fusedU);
+			expect_near(vector.samples, scalar->samples);
+			expect_near(vector.tangents, scalar->tangents);
+			// Nearly equal errors may be ordered differently after rounding, but the point found must have the maximum error
+			ASSERT_GE(vector.maxIndex, 0);
+			VECTOR d = input.points[vector.maxIndex] - input.curve.Sample(input.u[vector.maxIndex]);
+			expect_near(glm::dot(d, d), scalar->error);
+		}
+	}
+}
+
+// The scalar kernels in both layouts and the fused pass compute exactly what the separate passes do
+TEST(Kernels, ScalarLayoutsAndFusedPassMatch)
+{
+	test::BackendScope scope { FitKernels::Backend::Scalar };
+	for (uint32_t seed = 0; seed < 8; seed++)
+	{
+		Input input { seed, 50 };
+		Results results { input };
+		EXPECT_EQ(results.sumsSoa.c00, results.sums.c00);
+		EXPECT_EQ(results.sumsSoa.x1, results.sums.x1);
+		EXPECT_EQ(results.reparameterizedSoa, results.reparameterized);
+		EXPECT_EQ(results.errorSoa, results.error);
+		EXPECT_EQ(results.fusedError, results.error);
+		EXPECT_EQ(results.fusedU, results.reparameterized);
+		// The sums of the fused pass belong to the new parameters
+		VECTOR tanL = glm::normalize(input.curve.p1 - input.curve.p0);
+		VECTOR tanR = glm::normalize(input.curve.p2 - input.curve.p3);
+		auto sums = Kernels::AccumulateLeastSquares(input.points.data(), results.reparameterized.data(), 50, input.curve.p0, input.curve.p3, tanL, tanR);
+		expect_near(results.fusedSums, sums);
+	}
+}
+
+TEST(Kernels, SetBackendFallsBack)
+{
+	test::BackendScope scope { FitKernels::Backend::Avx2 };
+	if (FitKernels::IsSupported(FitKernels::Backend::Avx2))
+		EXPECT_EQ(FitKernels::GetBackend(), FitKernels::Backend::Avx2);
+	else if (FitKernels::IsSupported(FitKernels::Backend::Simd))
+		EXPECT_EQ(FitKernels::GetBackend(), FitKernels::Backend::Simd);
+	else
+		EXPECT_EQ(FitKernels::GetBackend(), FitKernels::Backend::Scalar);
+}
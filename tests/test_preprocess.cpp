@@ -0,0 +1,261 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :curve_preprocess;
+import :preprocess_pipeline;
+import :online_simplifier;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	// The original recursive Ramer-Douglas-Peucker, which RdpReduce has to reproduce exactly
+	void rdp_reference(std::span<const VECTOR> points, int first, int last, FLOAT epsilon, std::vector<VECTOR>& dst)
+	{
+		VECTOR line = points[last] - points[first];
+		FLOAT length = glm::length(line);
+		FLOAT dmax = 0;
+		int index = first;
+		for (int i = first + 1; i < last; i++)
+		{
+			VECTOR v = points[i] - points[first];
+			FLOAT d;
+			if constexpr (DIMENSION == 2)
+				d = std::abs((v.x * line.y - line.x * v.y) / length);
+			else
+				d = glm::length(v - line * (glm::dot(v, line) / (length * length)));
+			if (d > dmax)
+			{
+				index = i;
+				dmax = d;
+			}
+		}
+		if (dmax > epsilon)
+		{
+			rdp_reference(points, first, index, epsilon, dst);
+			rdp_reference(points, index, last, epsilon, dst);
+		}
+		else
+			dst.push_back(points[last]);
+	}
+
+	std::vector<VECTOR> rdp_reference(std::span<const VECTOR> points, FLOAT epsilon)
+	{
+		std::vector<VECTOR> dst { points.front() };
+		rdp_reference(points, 0, static_cast<int>(points.size()) - 1, epsilon, dst);
+		return dst;
+	}
+
+	FLOAT get_triangle_area(const VECTOR& a, const VECTOR& b, const VECTOR& c)
+	{
+		VECTOR u = b - a;
+		VECTOR v = c - a;
+		if constexpr (DIMENSION == 2)
+			return std::abs(u.x * v.y - u.y * v.x) / 2;
+		else
+		{
+			FLOAT uv = glm::dot(u, v);
+			return std::sqrt(std::max(glm::dot(u, u) * glm::dot(v, v) - uv * uv, FLOAT(0))) / 2;
+		}
+	}
+
+	// Visvalingam-Whyatt by searching all remaining points for the smallest effective area in every step
+	std::vector<VECTOR> visvalingam_reference(std::span<const VECTOR> points, FLOAT minArea)
+	{
+		std::vector<int> remaining(points.size());
+		std::iota(remaining.begin(), remaining.end(), 0);
+		std::vector<FLOAT> areas(points.size(), std::numeric_limits<FLOAT>::infinity());
+		for (size_t i = 1; i + 1 < points.size(); i++)
+			areas[i] = get_triangle_area(points[i - 1], points[i], points[i + 1]);
+		for (;;)
+		{
+			size_t best = 0;
+			for (size_t i = 1; i + 1 < remaining.size(); i++)
+			{
+				if (best == 0 || areas[remaining[i]] < areas[remaining[best]])
+					best = i;
+			}
+			if (best == 0 || areas[remaining[best]] >= minArea)
+				break;
+			FLOAT area = areas[remaining[best]];
+			remaining.erase(remaining.begin() + best);
+			if (best > 1)
+				areas[remaining[best - 1]] = std::max(area, get_triangle_area(points[remaining[best - 2]], points[remaining[best - 1]], points[remaining[best]]));
+			if (best + 1 < remaining.size())
+				areas[remaining[best]] = std::max(area, get_triangle_area(points[remaining[best - 1]], points[remaining[best]], points[remaining[best + 1]]));
+		}
+		std::vector<VECTOR> dst;
+		for (int i : remaining)
+			dst.push_back(points[i]);
+		return dst;
+	}
+
+	// Distance from p to the segment a ... b
+	FLOAT get_segment_distance(const VECTOR& p, const VECTOR& a, const VECTOR& b)
+	{
+		VECTOR dir = b - a;
+		FLOAT lengthSq = glm::dot(dir, dir);
+		FLOAT t = lengthSq > 0 ? std::clamp(glm::dot(p - a, dir) / lengthSq, FLOAT(0), FLOAT(1)) : FLOAT(0);
+		return glm::distance(p, a + dir * t);
+	}
+
+	// Stroke with runs of repeated points, as input devices report them
+	std::vector<VECTOR> make_stroke_with_duplicates(size_t numPoints, uint32_t seed)
+	{
+		auto stroke = test::make_stroke(numPoints, seed);
+		std::vector<VECTOR> points;
+		for (size_t i = 0; i < stroke.size(); i++)
+		{
+			points.push_back(stroke[i]);
+			for (size_t j = 0; j < i % 3; j++)
+				points.push_back(stroke[i]);
+		}
+		return points;
+	}
+
+	std::vector<VECTOR> to_vector(std::span<const VECTOR> points) { return { points.begin(), points.end() }; }
+}
+
+TEST(Preprocess, RdpMatchesRecursive)
+{
+	std::pmr::vector<VECTOR> dst;
+	std::pmr::vector<CurvePreprocess::RdpRange> stack;
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(2000, seed);
+		for (FLOAT epsilon : { FLOAT(0.01), FLOAT(0.1), FLOAT(1) })
+		{
+			auto expected = rdp_reference(points, epsilon);
+			EXPECT_EQ(to_vector(CurvePreprocess::RdpReduce(points, epsilon)), expected);
+
+			CurvePreprocess::RdpReduce(points, epsilon, dst, stack);
+			EXPECT_EQ(to_vector(dst), expected);
+
+			std::pmr::vector<VECTOR> inPlace { points.begin(), points.end() };
+			CurvePreprocess::RdpReduceInPlace(inPlace, epsilon, stack);
+			EXPECT_EQ(to_vector(inPlace), expected);
+
+			PointBuffer buffer { points };
+			PointBuffer reduced;
+			CurvePreprocess::RdpReduce(buffer, epsilon, reduced, stack);
+			ASSERT_EQ(reduced.Size(), expected.size());
+			for (size_t i = 0; i < expected.size(); i++)
+				EXPECT_EQ(reduced[i], expected[i]);
+		}
+	}
+}
+
+TEST(Preprocess, VisvalingamMatchesNaive)
+{
+	std::pmr::vector<VECTOR> dst;
+	std::pmr::vector<CurvePreprocess::VisvalingamNode> nodes;
+	std::pmr::vector<int> heap;
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(1000, seed);
+		for (FLOAT minArea : { FLOAT(0.01), FLOAT(0.1), FLOAT(1) })
+		{
+			auto expected = visvalingam_reference(points, minArea);
+			EXPECT_EQ(expected.front(), points.front());
+			EXPECT_EQ(expected.back(), points.back());
+			EXPECT_LT(expected.size(), points.size());
+			EXPECT_EQ(to_vector(CurvePreprocess::VisvalingamReduce(points, minArea)), expected);
+
+			CurvePreprocess::VisvalingamReduce(points, minArea, dst, nodes, heap);
+			EXPECT_EQ(to_vector(dst), expected);
+
+			std::pmr::vector<VECTOR> inPlace { points.begin(), points.end() };
+			CurvePreprocess::VisvalingamReduceInPlace(inPlace, minArea, nodes, heap);
+			EXPECT_EQ(to_vector(inPlace), expected);
+		}
+	}
+}
+
+// The fused pipeline has to produce exactly what the separate stages produce, whether the points come at once or one by one
+TEST(Preprocess, PipelineMatchesStages)
+{
+	CurvePreprocess::Buffers buffers;
+	std::pmr::vector<VECTOR> dst;
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = make_stroke_with_duplicates(800, seed);
+		for (bool removeDuplicates : { false, true })
+		{
+			for (FLOAT linearizeDistance : { FLOAT(0), FLOAT(0.3), FLOAT(2) })
+			{
+				for (auto reducer : { Reducer::Rdp, Reducer::Visvalingam })
+				{
+					FitOptions options;
+					options.removeDuplicates = removeDuplicates;
+					options.linearizeDistance = linearizeDistance;
+					options.reducer = reducer;
+
+					std::vector<VECTOR> expected = points;
+					if (removeDuplicates)
+						expected = to_vector(CurvePreprocess::RemoveDuplicates(expected));
+					if (linearizeDistance > 0)
+						expected = to_vector(CurvePreprocess::Linearize(expected, linearizeDistance));
+					if (reducer == Reducer::Rdp)
+						expected = to_vector(CurvePreprocess::RdpReduce(expected, options.reduceTolerance));
+					else
+						expected = to_vector(CurvePreprocess::VisvalingamReduce(expected, options.reduceTolerance * options.reduceTolerance));
+
+					PreprocessPipeline pipeline { options };
+					pipeline.Run(points, dst);
+					EXPECT_EQ(to_vector(dst), expected);
+					EXPECT_EQ(to_vector(CurvePreprocess::Preprocess(points, options, buffers)), expected);
+
+					for (auto& p : points)
+						pipeline.Push(p);
+					EXPECT_EQ(to_vector(pipeline.Finish()), expected);
+				}
+			}
+		}
+	}
+}
+
+TEST(Preprocess, OnlineSimplifierStaysWithinTolerance)
+{
+	for (uint32_t seed = 0; seed < 4; seed++)
+	{
+		auto points = test::make_stroke(3000, seed);
+		for (FLOAT tolerance : { FLOAT(0.05), FLOAT(0.5) })
+		{
+			for (int maxLookahead : { 4, OnlineSimplifier::DEFAULT_MAX_LOOKAHEAD })
+			{
+				// A kept point is always the point before the one that was added, or the last point when finishing
+				OnlineSimplifier simplifier { tolerance, maxLookahead };
+				std::vector<size_t> kept;
+				VECTOR p;
+				for (size_t i = 0; i < points.size(); i++)
+				{
+					if (simplifier.Add(points[i], p))
+					{
+						size_t index = kept.empty() ? 0 : i - 1;
+						EXPECT_EQ(p, points[index]);
+						kept.push_back(index);
+					}
+					EXPECT_LE(simplifier.GetPendingCount(), maxLookahead);
+				}
+				ASSERT_TRUE(simplifier.Finish(p));
+				EXPECT_EQ(p, points.back());
+				kept.push_back(points.size() - 1);
+				EXPECT_LT(kept.size(), points.size());
+
+				for (size_t k = 1; k < kept.size(); k++)
+				{
+					for (size_t i = kept[k - 1] + 1; i < kept[k]; i++)
+						EXPECT_LE(get_segment_distance(points[i], points[kept[k - 1]], points[kept[k]]), tolerance * FLOAT(1.0001));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,124 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :curve_bvh;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	constexpr int BRUTE_FORCE_STEPS = 20000;
+
+	// Smallest distance from p to the curve at BRUTE_FORCE_STEPS + 1 evenly spaced parameters
+	FLOAT project_brute_force(const CubicBezier& curve, const VECTOR& p)
+	{
+		FLOAT best = std::numeric_limits<FLOAT>::infinity();
+		for (int i = 0; i <= BRUTE_FORCE_STEPS; i++)
+			best = std::min(best, glm::distance(curve.Sample(static_cast<FLOAT>(i) / BRUTE_FORCE_STEPS), p));
+		return best;
+	}
+}
+
+TEST(Projection, CurveMatchesBruteForce)
+{
+	test::Random random { 21 };
+	for (int i = 0; i < 300; i++)
+	{
+		CubicBezier curve = test::make_curve(random, 10);
+		VECTOR p = random.NextPoint(15);
+		FLOAT t;
+		FLOAT distance = curve.Project(p, t);
+		ASSERT_GE(t, 0);
+		ASSERT_LE(t, 1);
+		// The distance belongs to the returned parameter, and no sample of the curve is closer
+		EXPECT_NEAR(distance, glm::distance(curve.Sample(t), p), FLOAT(1e-4));
+		EXPECT_LE(distance, project_brute_force(curve, p) + FLOAT(1e-4)) << curve.ToString();
+	}
+}
+
+TEST(Projection, BvhMatchesAllCurves)
+{
+	test::Random random { 42 };
+	std::vector<CubicBezier> curves;
+	for (int i = 0; i < 200; i++)
+	{
+		VECTOR offset = random.NextPoint(100);
+		CubicBezier curve = test::make_curve(random, 5);
+		curves.emplace_back(curve.p0 + offset, curve.p1 + offset, curve.p2 + offset, curve.p3 + offset);
+	}
+	CurveBvh bvh { curves };
+
+	std::vector<VECTOR> points;
+	for (int i = 0; i < 300; i++)
+		points.push_back(random.NextPoint(110));
+	std::vector<CurveBvh::Projection> many(points.size());
+	bvh.ProjectMany(curves, points, many);
+
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		FLOAT best = std::numeric_limits<FLOAT>::infinity();
+		for (auto& curve : curves)
+		{
+			FLOAT t;
+			best = std::min(best, curve.Project(points[i], t));
+		}
+		auto projection = bvh.Project(curves, points[i]);
+		ASSERT_GE(projection.curve, 0);
+		EXPECT_NEAR(projection.distance, best, FLOAT(1e-4));
+		EXPECT_NEAR(many[i].distance, best, FLOAT(1e-4));
+
+		// Only curves within maxDistance are considered
+		auto limited = bvh.Project(curves, points[i], best * FLOAT(0.5));
+		EXPECT_EQ(limited.curve, -1);
+	}
+}
+
+// Culling with the hierarchy finds exactly the curves whose bounds intersect the box, also after incremental changes
+TEST(Projection, BvhQueryMatchesAllCurves)
+{
+	test::Random random { 47 };
+	auto make_offset_curve = [&random]() {
+		VECTOR offset = random.NextPoint(100);
+		CubicBezier curve = test::make_curve(random, 5);
+		return CubicBezier(curve.p0 + offset, curve.p1 + offset, curve.p2 + offset, curve.p3 + offset);
+	};
+	std::vector<CubicBezier> curves;
+	for (int i = 0; i < 300; i++)
+		curves.push_back(make_offset_curve());
+	CurveBvh bvh { curves };
+	for (int i = 0; i < 50; i++)
+	{
+		int index = static_cast<int>((random.Next() + 1) / 2 * 299);
+		curves[index] = make_offset_curve();
+		bvh.Update(index, curves[index]);
+		curves.push_back(make_offset_curve());
+		bvh.Add(curves.back());
+	}
+	ASSERT_EQ(bvh.GetCurveCount(), static_cast<int>(curves.size()));
+
+	std::pmr::vector<int> found;
+	for (int i = 0; i < 200; i++)
+	{
+		BoundingBox box;
+		box.Include(random.NextPoint(110));
+		box.Include(box.min + random.NextPoint(20));
+		bvh.Query(box, found);
+		std::vector<int> actual { found.begin(), found.end() };
+		std::sort(actual.begin(), actual.end());
+		std::vector<int> expected;
+		for (int j = 0; j < static_cast<int>(curves.size()); j++)
+		{
+			if (curves[j].GetBounds().Intersects(box))
+				expected.push_back(j);
+		}
+		EXPECT_EQ(actual, expected);
+	}
+}
@@ -0,0 +1,139 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :spline;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	constexpr int SAMPLES_PER_CURVE = 64;
+
+	// Connected random curves from start
+	std::vector<CubicBezier> make_curves(test::Random& random, size_t count, VECTOR start)
+	{
+		std::vector<CubicBezier> curves;
+		for (size_t i = 0; i < count; i++)
+		{
+			CubicBezier curve = test::make_curve(random, 10);
+			curve.p0 = start;
+			curves.push_back(curve);
+			start = curve.p3;
+		}
+		return curves;
+	}
+
+	// Reference for Spline::Sample: finds the curve by summing the lengths of the curves from the start, and the parameter
+	// within it with a spline of only that curve, so the lengths don't come from the Fenwick tree
+	VECTOR sample_linear(std::span<const CubicBezier> curves, FLOAT u, Spline::ArcLengthMode mode)
+	{
+		std::vector<Spline> single;
+		double total = 0;
+		for (auto& curve : curves)
+		{
+			single.emplace_back(std::span<const CubicBezier> { &curve, 1 }, SAMPLES_PER_CURVE, mode);
+			total += single.back().Length();
+		}
+		double target = u * total;
+		for (auto& spline : single)
+		{
+			double length = spline.Length();
+			if (target <= length || &spline == &single.back())
+				return spline.Sample(static_cast<FLOAT>(target / length));
+			target -= length;
+		}
+		return {};
+	}
+
+	void expect_near(const VECTOR& a, const VECTOR& b, FLOAT tolerance)
+	{
+		for (int c = 0; c < DIMENSION; c++)
+			EXPECT_NEAR(a[c], b[c], tolerance);
+	}
+}
+
+TEST(Spline, SampleMatchesLinearScan)
+{
+	test::Random random { 7 };
+	for (auto mode : { Spline::ArcLengthMode::Table, Spline::ArcLengthMode::Quadrature })
+	{
+		auto curves = make_curves(random, 37, random.NextPoint(10));
+		Spline spline { curves, SAMPLES_PER_CURVE, mode };
+		for (int i = 0; i <= 200; i++)
+		{
+			FLOAT u = static_cast<FLOAT>(i) / 200;
+			expect_near(spline.Sample(u), sample_linear(curves, u, mode), FLOAT(1e-2));
+		}
+	}
+}
+
+// Updating single curves only changes their entries of the tree, which has to stay consistent with the curves
+TEST(Spline, UpdateMatchesRebuild)
+{
+	test::Random random { 11 };
+	for (auto mode : { Spline::ArcLengthMode::Table, Spline::ArcLengthMode::Quadrature })
+	{
+		auto curves = make_curves(random, 50, random.NextPoint(10));
+		Spline spline { curves, SAMPLES_PER_CURVE, mode };
+		for (int update = 0; update < 100; update++)
+		{
+			int index = static_cast<int>((random.Next() + 1) / 2 * 49);
+			CubicBezier curve = test::make_curve(random, 10);
+			curve.p0 = curves[index].p0;
+			curve.p3 = curves[index].p3;
+			curves[index] = curve;
+			spline.Update(index, curve);
+		}
+		auto more = make_curves(random, 13, curves.back().p3);
+		for (auto& curve : more)
+		{
+			curves.push_back(curve);
+			spline.Add(curve);
+		}
+
+		Spline rebuilt { curves, SAMPLES_PER_CURVE, mode };
+		EXPECT_NEAR(spline.Length(), rebuilt.Length(), rebuilt.Length() * FLOAT(1e-5));
+		for (int i = 0; i <= 200; i++)
+		{
+			FLOAT u = static_cast<FLOAT>(i) / 200;
+			expect_near(spline.Sample(u), rebuilt.Sample(u), FLOAT(1e-3));
+			expect_near(spline.Sample(u), sample_linear(curves, u, mode), FLOAT(1e-2));
+		}
+	}
+}
+
+TEST(Spline, QuadratureMatchesFineTable)
+{
+	test::Random random { 3 };
+	auto curves = make_curves(random, 20, random.NextPoint(10));
+	Spline table { curves, Spline::MAX_SAMPLES_PER_CURVE, Spline::ArcLengthMode::Table };
+	Spline quadrature { curves, SAMPLES_PER_CURVE, Spline::ArcLengthMode::Quadrature };
+	EXPECT_NEAR(quadrature.Length(), table.Length(), table.Length() * FLOAT(1e-3));
+	for (int i = 0; i <= 100; i++)
+	{
+		FLOAT u = static_cast<FLOAT>(i) / 100;
+		expect_near(quadrature.Sample(u), table.Sample(u), table.Length() * FLOAT(1e-3));
+	}
+}
+
+TEST(Spline, SampleManyMatchesSample)
+{
+	test::Random random { 5 };
+	auto curves = make_curves(random, 25, random.NextPoint(10));
+	Spline spline { curves, SAMPLES_PER_CURVE };
+	std::vector<FLOAT> u;
+	for (int i = 0; i <= 500; i++)
+		u.push_back(static_cast<FLOAT>(i) / 500);
+	std::vector<VECTOR> out(u.size());
+	spline.SampleMany(u, out);
+	for (size_t i = 0; i < u.size(); i++)
+		expect_near(out[i], spline.Sample(u[i]), FLOAT(1e-4));
+}
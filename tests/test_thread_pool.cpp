@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <gtest/gtest.h>
+
+module bezierfit;
+
+import :thread_pool;
+
+#include "common.hpp"
+
+using namespace bezierfit;
+
+namespace {
+	constexpr unsigned int THREAD_COUNT = 4;
+
+	// Runs a job that counts how often every worker index was run
+	std::vector<int> run_counted(ThreadPool& pool, unsigned int maxThreads = 0)
+	{
+		std::vector<std::atomic<int>> counts(pool.GetThreadCount());
+		pool.Run([&counts](unsigned int workerIndex) { counts[workerIndex]++; }, maxThreads);
+		return { counts.begin(), counts.end() };
+	}
+}
+
+TEST(ThreadPool, RunsEveryIndexOnce)
+{
+	ThreadPool pool { THREAD_COUNT };
+	EXPECT_EQ(run_counted(pool), std::vector<int>(THREAD_COUNT, 1));
+	EXPECT_EQ(run_counted(pool, 2), std::vector<int>({ 1, 1, 0, 0 }));
+	EXPECT_EQ(run_counted(pool, 1), std::vector<int>({ 1, 0, 0, 0 }));
+}
+
+// Callers on different threads don't wait for each other's jobs
+TEST(ThreadPool, ConcurrentCallers)
+{
+	ThreadPool pool { THREAD_COUNT };
+	std::vector<std::thread> callers;
+	std::atomic<int> failures = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		callers.emplace_back([&pool, &failures]() {
+			for (int j = 0; j < 200; j++)
+			{
+				if (run_counted(pool) != std::vector<int>(THREAD_COUNT, 1))
+					failures++;
+			}
+		});
+	}
+	for (auto& caller : callers)
+		caller.join();
+	EXPECT_EQ(failures.load(), 0);
+}
+
+// A job that runs another job on the same pool, which used to deadlock
+TEST(ThreadPool, NestedRun)
+{
+	ThreadPool pool { THREAD_COUNT };
+	std::vector<std::vector<int>> inner(THREAD_COUNT);
+	pool.Run([&](unsigned int workerIndex) { inner[workerIndex] = run_counted(pool); });
+	for (auto& counts : inner)
+		EXPECT_EQ(counts, std::vector<int>(THREAD_COUNT, 1));
+}
+
+TEST(ThreadPool, RethrowsAfterAllIndicesReturned)
+{
+	ThreadPool pool { THREAD_COUNT };
+	std::atomic<int> finished = 0;
+	EXPECT_THROW(pool.Run([&finished](unsigned int workerIndex) {
+		if (workerIndex == 1)
+			throw std::runtime_error("worker failed");
+		finished++;
+	}), std::runtime_error);
+	EXPECT_EQ(finished.load(), static_cast<int>(THREAD_COUNT) - 1);
+	// The pool is still usable afterwards
+	EXPECT_EQ(run_counted(pool), std::vector<int>(THREAD_COUNT, 1));
+}